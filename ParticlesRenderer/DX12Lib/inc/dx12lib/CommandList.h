@@ -31,6 +31,7 @@
  *  The CommandList class provides additional functionality that makes working with
  *  DirectX 12 applications easier.
  */
+#include "StateFilter.h"
 #include "VertexTypes.h"
 
 #include <DirectXMath.h>
@@ -49,6 +50,7 @@ namespace dx12lib
 
 class Buffer;
 class ByteAddressBuffer;
+class CommandStream;
 class ConstantBuffer;
 class ConstantBufferView;
 class Device;
@@ -225,10 +227,13 @@ public:
      *
      * @param fileName The path to the scene file definition.
      * @param [loadingProgress] An optional callback function that can be used to report loading progress.
+     * @param [keepCollisionGeometry] Keep a CPU copy of the positions and indices of the meshes, see
+     * Mesh::SetCollisionGeometry. Off by default, the copy is only needed to query the geometry on the CPU.
      */
     std::shared_ptr<Scene>
         LoadSceneFromFile( const std::wstring&                 fileName,
-                           const std::function<bool( float )>& loadingProgres = std::function<bool( float )>() );
+                           const std::function<bool( float )>& loadingProgres = std::function<bool( float )>(),
+                           bool                                keepCollisionGeometry = false );
 
     /**
      * Load a scene from a string.
@@ -523,7 +528,34 @@ public:
      * Dispatch a compute shader.
      */
     void Dispatch( uint32_t numGroupsX, uint32_t numGroupsY = 1, uint32_t numGroupsZ = 1 );
-    void MeshShaderDraw(int nbX);
+
+    /**
+     * Dispatch a mesh shader.
+     *
+     * Note: Every dimension is limited to 65535 groups and a dispatch to 2^22 groups,
+     * larger amounts of groups must be split in several dispatches.
+     */
+    void DispatchMesh( uint32_t numGroupsX, uint32_t numGroupsY = 1, uint32_t numGroupsZ = 1 );
+
+    /**
+     * Record the high-level commands this command list receives in a stream, nullptr to stop.
+     * The stream is detached when the command list is reset, so it must be set again every
+     * time the command list is taken from the command queue.
+     */
+    void SetCommandStream( std::shared_ptr<CommandStream> commandStream )
+    {
+        m_CommandStream = std::move( commandStream );
+    }
+
+    /**
+     * The Set* calls which bind the state that is already bound are dropped before they
+     * reach the native command list. The counters of the filter cover the commands since
+     * the command list was reset.
+     */
+    const StateFilter& GetStateFilter() const
+    {
+        return m_StateFilter;
+    }
 
 protected:
     friend class CommandQueue;
@@ -619,8 +651,10 @@ private:
     // Keep track of the currently bound root signatures to minimize root
     // signature changes.
     ID3D12RootSignature* m_RootSignature;
-    // Keep track of the currently bond pipeline state object to minimize PSO changes.
-    ID3D12PipelineState* m_PipelineState;
+
+    // Shadow of the bound state (pipeline state, root signature, root parameters,
+    // input assembler, rasterizer and output merger) to drop redundant state changes.
+    StateFilter m_StateFilter;
 
     // Resource created in an upload heap. Useful for drawing of dynamic geometry
     // or for uploading constant buffer data that changes every draw call.
@@ -640,6 +674,9 @@ private:
     // heaps if they are different than the currently bound descriptor heaps.
     ID3D12DescriptorHeap* m_DescriptorHeaps[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 
+    // Optional recording of the commands, see CommandStream.h.
+    std::shared_ptr<CommandStream> m_CommandStream;
+
     // Pipeline state object for Mip map generation.
     std::unique_ptr<GenerateMipsPSO> m_GenerateMipsPSO;
     // Pipeline state object for converting panorama (equirectangular) to cubemaps
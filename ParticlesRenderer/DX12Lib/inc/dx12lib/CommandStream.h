@@ -0,0 +1,222 @@
+#pragma once
+
+/**
+ *  @file CommandStream.h
+ *
+ *  @brief A compact, serializable stream of the high-level commands a CommandList
+ *  receives, and the backends it can be replayed against.
+ *
+ *  The stream does not depend on Direct3D: a capture made on a Windows machine can be
+ *  loaded and replayed against the NullCommandBackend anywhere, to measure the
+ *  recording overhead, the redundant state changes and the cost of every command
+ *  without a GPU.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dx12lib
+{
+
+enum class CommandType : uint32_t
+{
+    SetPipelineState,
+    SetGraphicsRootSignature,
+    SetComputeRootSignature,
+    SetPrimitiveTopology,
+    SetViewports,
+    SetScissorRects,
+    SetRenderTarget,
+    SetVertexBuffers,
+    SetIndexBuffer,
+    SetGraphicsDynamicConstantBuffer,
+    SetGraphicsDynamicStructuredBuffer,
+    SetGraphics32BitConstants,
+    SetCompute32BitConstants,
+    SetConstantBufferView,
+    SetShaderResourceView,
+    SetUnorderedAccessView,
+    ClearTexture,
+    ClearDepthStencilTexture,
+    ResolveSubresource,
+    Draw,
+    DrawIndexed,
+    Dispatch,
+    DispatchMesh,
+    Close,  // End of a command list, the next commands start with no bound state.
+    NumCommandTypes
+};
+
+const char* GetCommandTypeName( CommandType type );
+
+/**
+ * Commands which bind a root parameter, the root signature unbinds them all.
+ */
+bool IsRootParameterCommand( CommandType type );
+
+/**
+ * A recorded command, followed in the stream by PayloadSize bytes of payload.
+ */
+struct RecordedCommand
+{
+    CommandType Type;
+    uint32_t    Slot;           // Root parameter index or first slot, 0 when the command has none.
+    uint32_t    Object;         // Id of the bound object in the stream, 0 for none.
+    uint32_t    Arguments[5];   // Counts and offsets of the command, in the order of its parameters.
+    uint32_t    PayloadSize;    // Bytes of payload stored after the command.
+    uint32_t    DataSize;       // Bytes of data the command received, more than the payload when not stored.
+    uint64_t    DataHash;       // FNV-1a hash of the data the command received.
+    uint32_t    Nanoseconds;    // CPU time of the command on the recording machine.
+    uint32_t    Reserved;
+};
+static_assert( sizeof( RecordedCommand ) == 56, "RecordedCommand is saved as is" );
+
+class CommandStream
+{
+public:
+    /**
+     * Data up to this size is stored in the stream (root constants, viewports, bound
+     * object ids). Larger data (dynamic buffers) only keeps its size and hash.
+     */
+    static constexpr uint32_t MaxStoredPayload = 256;
+
+    /**
+     * Records a command for the lifetime of the scope, the CPU time of the scope is the
+     * cost of the command. Does nothing without a stream, so a CommandList which does
+     * not record only pays for the null check.
+     */
+    class Scope
+    {
+    public:
+        Scope( CommandStream* stream, CommandType type, uint32_t slot = 0, const void* object = nullptr,
+               std::initializer_list<uint32_t> arguments = {}, const void* data = nullptr, size_t dataSize = 0 );
+        ~Scope();
+
+        Scope( const Scope& ) = delete;
+        Scope& operator=( const Scope& ) = delete;
+
+    private:
+        CommandStream*                                 m_Stream;
+        size_t                                         m_Offset;
+        std::chrono::high_resolution_clock::time_point m_Start;
+    };
+
+    /**
+     * Append a command, returns its offset in the stream.
+     */
+    size_t Record( CommandType type, uint32_t slot, const void* object, std::initializer_list<uint32_t> arguments,
+                   const void* data, size_t dataSize );
+
+    /**
+     * A stable id for an object pointer, in order of first use. 0 for nullptr.
+     */
+    uint32_t GetObjectId( const void* object );
+
+    void Clear();
+
+    size_t GetCommandCount() const
+    {
+        return m_CommandCount;
+    }
+    size_t GetSizeInBytes() const
+    {
+        return m_Data.size();
+    }
+
+    /**
+     * Visit every command in recording order. The payload pointer is only valid during the call.
+     */
+    template<typename Callback>
+    void ForEach( Callback&& callback ) const
+    {
+        size_t offset = 0;
+        while ( offset + sizeof( RecordedCommand ) <= m_Data.size() )
+        {
+            RecordedCommand command;
+            std::memcpy( &command, m_Data.data() + offset, sizeof( RecordedCommand ) );
+            offset += sizeof( RecordedCommand );
+
+            callback( command, m_Data.data() + offset );
+            offset += command.PayloadSize;
+        }
+    }
+
+    /**
+     * Save the stream to a file, load a saved stream.
+     * Returns false if the file could not be written or is not a command stream.
+     */
+    bool Save( const std::wstring& fileName ) const;
+    bool Load( const std::wstring& fileName );
+
+    static uint64_t Hash( const void* data, size_t size );
+
+private:
+    void SetNanoseconds( size_t offset, uint32_t nanoseconds );
+
+    std::vector<uint8_t>                      m_Data;
+    size_t                                    m_CommandCount = 0;
+    std::unordered_map<const void*, uint32_t> m_ObjectIds;
+};
+
+/**
+ * The receiver of the commands of a stream.
+ */
+class CommandBackend
+{
+public:
+    virtual ~CommandBackend() = default;
+
+    virtual void Execute( const RecordedCommand& command, const uint8_t* payload ) = 0;
+};
+
+/**
+ * Replay every command of the stream against the backend.
+ */
+void Replay( const CommandStream& stream, CommandBackend& backend );
+
+/**
+ * Executes nothing, only counts: the commands and the recorded CPU time per type, and
+ * the state changes which set the state that was already bound.
+ */
+class NullCommandBackend : public CommandBackend
+{
+public:
+    struct Statistics
+    {
+        uint64_t Count               = 0;
+        uint64_t Redundant           = 0;  // State changes to the bound state.
+        uint64_t RecordedNanoseconds = 0;
+        uint64_t DataBytes           = 0;
+    };
+
+    void Execute( const RecordedCommand& command, const uint8_t* payload ) override;
+
+    const Statistics& GetStatistics( CommandType type ) const
+    {
+        return m_Statistics[static_cast<size_t>( type )];
+    }
+    uint64_t GetCommandCount() const;
+    uint64_t GetRedundantCount() const;
+
+    /**
+     * One line per command type that was executed, then the totals.
+     */
+    void WriteReport( std::ostream& stream ) const;
+
+private:
+    static bool IsStateCommand( CommandType type );
+    static bool IsSameState( const RecordedCommand& a, const RecordedCommand& b );
+
+    std::array<Statistics, static_cast<size_t>( CommandType::NumCommandTypes )> m_Statistics {};
+    // Per command type and binding, the last state set since the last Close.
+    std::unordered_map<uint64_t, RecordedCommand> m_BoundState;
+};
+
+}  // namespace dx12lib
@@ -36,6 +36,7 @@
 
 #include <map>     // For std::map
 #include <memory>  // For std::shared_ptr
+#include <vector>  // For std::vector
 
 namespace dx12lib
 {
@@ -88,6 +89,21 @@ public:
     void                        SetAABB( const DirectX::BoundingBox& aabb );
     const DirectX::BoundingBox& GetAABB() const;
 
+    /**
+     * Keep a CPU copy of the vertex positions and triangle indices of the mesh.
+     * The GPU buffers cannot be read back, this copy is used for collision and distance queries.
+     * Only set for the scenes loaded with keepCollisionGeometry, see CommandList::LoadSceneFromFile.
+     */
+    void SetCollisionGeometry( std::vector<DirectX::XMFLOAT3> positions, std::vector<uint32_t> indices );
+    const std::vector<DirectX::XMFLOAT3>& GetCollisionPositions() const
+    {
+        return m_CollisionPositions;
+    }
+    const std::vector<uint32_t>& GetCollisionIndices() const
+    {
+        return m_CollisionIndices;
+    }
+
     /**
      * Draw the mesh to a CommandList.
      *
@@ -108,5 +124,8 @@ private:
     std::shared_ptr<Material>    m_Material;
     D3D12_PRIMITIVE_TOPOLOGY     m_PrimitiveTopology;
     DirectX::BoundingBox         m_AABB;
+
+    std::vector<DirectX::XMFLOAT3> m_CollisionPositions;
+    std::vector<uint32_t>          m_CollisionIndices;
 };
 }  // namespace dx12lib
\ No newline at end of file
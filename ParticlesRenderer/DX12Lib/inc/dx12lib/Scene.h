@@ -85,9 +85,10 @@ protected:
 
     /**
      * Load a scene from a file on disc.
+     * With keepCollisionGeometry, the meshes keep a CPU copy of their positions and indices.
      */
     bool LoadSceneFromFile( CommandList& commandList, const std::wstring& fileName,
-                            const std::function<bool( float )>& loadingProgress );
+                            const std::function<bool( float )>& loadingProgress, bool keepCollisionGeometry = false );
 
     /**
      * Load a scene from a string.
@@ -117,5 +118,7 @@ private:
     std::shared_ptr<SceneNode> m_RootNode;
 
     std::wstring m_SceneFile;
+
+    bool m_KeepCollisionGeometry = false;
 };
 }  // namespace dx12lib
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+/**
+ *  @file StateFilter.h
+ *
+ *  @brief Shadows the state bound on a command list, so the calls which set the
+ *  state that is already bound can be dropped before they reach the native list.
+ *
+ *  The filter only compares bytes and does not depend on Direct3D. The CommandList
+ *  decides what identifies a state (a pipeline state pointer, a descriptor handle,
+ *  the data of root constants) and tells the filter when the native list loses it.
+ */
+
+#include <dx12lib/CommandStream.h>  // For CommandType
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace dx12lib
+{
+
+class StateFilter
+{
+public:
+    /**
+     * Larger data is never filtered, comparing it would cost more than setting it again.
+     */
+    static constexpr size_t MaxFilteredSize = 1024;
+
+    struct Counters
+    {
+        uint64_t Calls    = 0;
+        uint64_t Filtered = 0;  // Calls dropped because their state was bound.
+    };
+
+    /**
+     * Bind the state of a binding: a slot of the command type and an element of the slot
+     * (the descriptor offset in a descriptor table, 0 otherwise).
+     * All root parameter commands share the root parameter slots, and the graphics and
+     * compute root signatures share one binding, like the descriptor heaps of the list do.
+     *
+     * Returns false if the state was already bound: the call can be dropped.
+     */
+    bool Set( CommandType type, uint32_t slot, uint32_t element, const void* data, size_t sizeInBytes );
+
+    template<typename T>
+    bool Set( CommandType type, uint32_t slot, const T& state )
+    {
+        static_assert( std::is_trivially_copyable<T>::value, "The state is compared as bytes." );
+        return Set( type, slot, 0, &state, sizeof( T ) );
+    }
+
+    /**
+     * Bind consecutive slots from firstSlot, one element of the array each, counted as one call.
+     * Returns false if the state of every slot was already bound.
+     */
+    bool SetRange( CommandType type, uint32_t firstSlot, const void* data, size_t elementSize, size_t numElements );
+
+    /**
+     * The binding was changed without the filter, the next Set of it is not filtered.
+     */
+    void Invalidate( CommandType type, uint32_t slot, uint32_t element = 0 );
+
+    /**
+     * Forget the state of every root parameter, when the root signature changes.
+     */
+    void InvalidateRootParameters();
+
+    /**
+     * Nothing is bound, for a new command list. Also resets the counters.
+     */
+    void Reset();
+
+    const Counters& GetCounters( CommandType type ) const
+    {
+        return m_Counters[static_cast<size_t>( type )];
+    }
+    uint64_t GetCallCount() const;
+    uint64_t GetFilteredCount() const;
+
+    /**
+     * One line per command type that was filtered, then the totals.
+     */
+    void WriteReport( std::ostream& stream ) const;
+
+private:
+    struct BoundState
+    {
+        CommandType          Type;
+        std::vector<uint8_t> Data;
+    };
+
+    static uint64_t GetBinding( CommandType type, uint32_t slot, uint32_t element );
+
+    // Returns true if the state of the binding changed.
+    bool Bind( CommandType type, uint32_t slot, uint32_t element, const void* data, size_t sizeInBytes );
+
+    std::array<Counters, static_cast<size_t>( CommandType::NumCommandTypes )> m_Counters {};
+    std::unordered_map<uint64_t, BoundState>                                  m_BoundState;
+};
+
+}  // namespace dx12lib
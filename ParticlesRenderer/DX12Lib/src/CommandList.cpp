@@ -4,6 +4,7 @@
 
 #include <dx12lib/ByteAddressBuffer.h>
 #include <dx12lib/CommandQueue.h>
+#include <dx12lib/CommandStream.h>
 #include <dx12lib/ConstantBuffer.h>
 #include <dx12lib/ConstantBufferView.h>
 #include <dx12lib/Device.h>
@@ -47,7 +48,6 @@ CommandList::CommandList( Device& device, D3D12_COMMAND_LIST_TYPE type )
 : m_Device( device )
 , m_d3d12CommandListType( type )
 , m_RootSignature( nullptr )
-, m_PipelineState( nullptr )
 {
     auto d3d12Device = m_Device.GetD3D12Device();
 
@@ -171,6 +171,9 @@ void CommandList::ResolveSubresource( const std::shared_ptr<Resource>& dstRes, c
 {
     assert( dstRes && srcRes );
 
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::ResolveSubresource, 0, dstRes.get(),
+                                    { dstSubresource, srcSubresource } );
+
     TransitionBarrier( dstRes, D3D12_RESOURCE_STATE_RESOLVE_DEST, dstSubresource );
     TransitionBarrier( srcRes, D3D12_RESOURCE_STATE_RESOLVE_SOURCE, srcSubresource );
 
@@ -286,7 +289,13 @@ std::shared_ptr<StructuredBuffer> CommandList::CopyStructuredBuffer( size_t numE
 
 void CommandList::SetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY primitiveTopology )
 {
-    m_d3d12CommandList->IASetPrimitiveTopology( primitiveTopology );
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetPrimitiveTopology, 0, nullptr,
+                                    { static_cast<uint32_t>( primitiveTopology ) } );
+
+    if ( m_StateFilter.Set( CommandType::SetPrimitiveTopology, 0, primitiveTopology ) )
+    {
+        m_d3d12CommandList->IASetPrimitiveTopology( primitiveTopology );
+    }
 }
 
 std::shared_ptr<Texture> CommandList::LoadTextureFromFile( const std::wstring& fileName, bool sRGB )
@@ -598,6 +607,10 @@ void CommandList::GenerateMips_UAV( const std::shared_ptr<Texture>& texture, boo
         {
             m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
                 GenerateMips::OutMip, mipCount, 4 - mipCount, m_GenerateMipsPSO->GetDefaultUAV() );
+            for ( uint32_t mip = mipCount; mip < 4; ++mip )
+            {
+                m_StateFilter.Invalidate( CommandType::SetUnorderedAccessView, GenerateMips::OutMip, mip );
+            }
         }
 
         Dispatch( Math::DivideByMultiple( dstWidth, 8 ), Math::DivideByMultiple( dstHeight, 8 ) );
@@ -702,6 +715,10 @@ void CommandList::PanoToCubemap( const std::shared_ptr<Texture>& cubemapTexture,
             // Pad unused mips. This keeps DX12 runtime happy.
             m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
                 PanoToCubemapRS::DstMips, panoToCubemapCB.NumMips, 5 - numMips, m_PanoToCubemapPSO->GetDefaultUAV() );
+            for ( uint32_t mip = numMips; mip < 5; ++mip )
+            {
+                m_StateFilter.Invalidate( CommandType::SetUnorderedAccessView, PanoToCubemapRS::DstMips, mip );
+            }
         }
 
         Dispatch( Math::DivideByMultiple( panoToCubemapCB.CubemapSize, 16 ),
@@ -717,11 +734,12 @@ void CommandList::PanoToCubemap( const std::shared_ptr<Texture>& cubemapTexture,
 }
 
 std::shared_ptr<Scene> CommandList::LoadSceneFromFile( const std::wstring&                 fileName,
-                                                       const std::function<bool( float )>& loadingProgress )
+                                                       const std::function<bool( float )>& loadingProgress,
+                                                       bool                                keepCollisionGeometry )
 {
     auto scene = std::make_shared<Scene>();
 
-    if ( scene->LoadSceneFromFile( *this, fileName, loadingProgress ) )
+    if ( scene->LoadSceneFromFile( *this, fileName, loadingProgress, keepCollisionGeometry ) )
     {
         return scene;
     }
@@ -1157,6 +1175,9 @@ void CommandList::ClearTexture( const std::shared_ptr<Texture>& texture, const f
 {
     assert( texture );
 
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::ClearTexture, 0, texture.get(), {}, clearColor,
+                                    4 * sizeof( float ) );
+
     TransitionBarrier( texture, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, true );
     m_d3d12CommandList->ClearRenderTargetView( texture->GetRenderTargetView(), clearColor, 0, nullptr );
 
@@ -1168,6 +1189,9 @@ void CommandList::ClearDepthStencilTexture( const std::shared_ptr<Texture>& text
 {
     assert( texture );
 
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::ClearDepthStencilTexture, 0, texture.get(),
+                                    { static_cast<uint32_t>( clearFlags ), stencil }, &depth, sizeof( float ) );
+
     TransitionBarrier( texture, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, true );
     m_d3d12CommandList->ClearDepthStencilView( texture->GetDepthStencilView(), clearFlags, depth, stencil, 0, nullptr );
 
@@ -1209,6 +1233,14 @@ void CommandList::CopyTextureSubresource( const std::shared_ptr<Texture>& textur
 void CommandList::SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes,
                                                     const void* bufferData )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetGraphicsDynamicConstantBuffer,
+                                    rootParameterIndex, nullptr, {}, bufferData, sizeInBytes );
+
+    // The data of the bound buffer is still in the upload buffer.
+    if ( !m_StateFilter.Set( CommandType::SetGraphicsDynamicConstantBuffer, rootParameterIndex, 0, bufferData,
+                             sizeInBytes ) )
+        return;
+
     // Constant buffers must be 256-byte aligned.
     auto heapAllococation = m_UploadBuffer->Allocate( sizeInBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT );
     memcpy( heapAllococation.CPU, bufferData, sizeInBytes );
@@ -1218,17 +1250,43 @@ void CommandList::SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex,
 
 void CommandList::SetGraphics32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants, const void* constants )
 {
-    m_d3d12CommandList->SetGraphicsRoot32BitConstants( rootParameterIndex, numConstants, constants, 0 );
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetGraphics32BitConstants, rootParameterIndex,
+                                    nullptr, { numConstants }, constants, numConstants * sizeof( uint32_t ) );
+
+    if ( m_StateFilter.Set( CommandType::SetGraphics32BitConstants, rootParameterIndex, 0, constants,
+                            numConstants * sizeof( uint32_t ) ) )
+    {
+        m_d3d12CommandList->SetGraphicsRoot32BitConstants( rootParameterIndex, numConstants, constants, 0 );
+    }
 }
 
 void CommandList::SetCompute32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants, const void* constants )
 {
-    m_d3d12CommandList->SetComputeRoot32BitConstants( rootParameterIndex, numConstants, constants, 0 );
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetCompute32BitConstants, rootParameterIndex,
+                                    nullptr, { numConstants }, constants, numConstants * sizeof( uint32_t ) );
+
+    if ( m_StateFilter.Set( CommandType::SetCompute32BitConstants, rootParameterIndex, 0, constants,
+                            numConstants * sizeof( uint32_t ) ) )
+    {
+        m_d3d12CommandList->SetComputeRoot32BitConstants( rootParameterIndex, numConstants, constants, 0 );
+    }
 }
 
 void CommandList::SetVertexBuffers( uint32_t                                          startSlot,
                                     const std::vector<std::shared_ptr<VertexBuffer>>& vertexBuffers )
 {
+    // The buffers are recorded by id, their pointers mean nothing outside of this run.
+    std::vector<uint32_t> vertexBufferIds;
+    if ( m_CommandStream )
+    {
+        for ( const auto& vertexBuffer: vertexBuffers )
+        {
+            vertexBufferIds.push_back( m_CommandStream->GetObjectId( vertexBuffer.get() ) );
+        }
+    }
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetVertexBuffers, startSlot, nullptr, {},
+                                    vertexBufferIds.data(), vertexBufferIds.size() * sizeof( uint32_t ) );
+
     std::vector<D3D12_VERTEX_BUFFER_VIEW> views;
     views.reserve( vertexBuffers.size() );
 
@@ -1243,7 +1301,12 @@ void CommandList::SetVertexBuffers( uint32_t
         }
     }
 
-    m_d3d12CommandList->IASetVertexBuffers( startSlot, views.size(), views.data() );
+    // Filtered per slot, the slots of a range can be changed by another range.
+    if ( m_StateFilter.SetRange( CommandType::SetVertexBuffers, startSlot, views.data(),
+                                 sizeof( D3D12_VERTEX_BUFFER_VIEW ), views.size() ) )
+    {
+        m_d3d12CommandList->IASetVertexBuffers( startSlot, views.size(), views.data() );
+    }
 }
 
 void CommandList::SetVertexBuffer( uint32_t slot, const std::shared_ptr<VertexBuffer>& vertexBuffer )
@@ -1265,15 +1328,23 @@ void CommandList::SetDynamicVertexBuffer( uint32_t slot, size_t numVertices, siz
     vertexBufferView.StrideInBytes            = static_cast<UINT>( vertexSize );
 
     m_d3d12CommandList->IASetVertexBuffers( slot, 1, &vertexBufferView );
+    m_StateFilter.Invalidate( CommandType::SetVertexBuffers, slot );
 }
 
 void CommandList::SetIndexBuffer( const std::shared_ptr<IndexBuffer>& indexBuffer )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetIndexBuffer, 0, indexBuffer.get() );
+
     if ( indexBuffer )
     {
         TransitionBarrier( indexBuffer, D3D12_RESOURCE_STATE_INDEX_BUFFER );
         TrackResource( indexBuffer );
-        m_d3d12CommandList->IASetIndexBuffer( &( indexBuffer->GetIndexBufferView() ) );
+
+        const D3D12_INDEX_BUFFER_VIEW indexBufferView = indexBuffer->GetIndexBufferView();
+        if ( m_StateFilter.Set( CommandType::SetIndexBuffer, 0, indexBufferView ) )
+        {
+            m_d3d12CommandList->IASetIndexBuffer( &indexBufferView );
+        }
     }
 }
 
@@ -1291,13 +1362,23 @@ void CommandList::SetDynamicIndexBuffer( size_t numIndicies, DXGI_FORMAT indexFo
     indexBufferView.Format                  = indexFormat;
 
     m_d3d12CommandList->IASetIndexBuffer( &indexBufferView );
+    m_StateFilter.Invalidate( CommandType::SetIndexBuffer, 0 );
 }
 
 void CommandList::SetGraphicsDynamicStructuredBuffer( uint32_t slot, size_t numElements, size_t elementSize,
                                                       const void* bufferData )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetGraphicsDynamicStructuredBuffer, slot,
+                                    nullptr,
+                                    { static_cast<uint32_t>( numElements ), static_cast<uint32_t>( elementSize ) },
+                                    bufferData, numElements * elementSize );
+
     size_t bufferSize = numElements * elementSize;
 
+    // Only small buffers are compared, see StateFilter::MaxFilteredSize.
+    if ( !m_StateFilter.Set( CommandType::SetGraphicsDynamicStructuredBuffer, slot, 0, bufferData, bufferSize ) )
+        return;
+
     auto heapAllocation = m_UploadBuffer->Allocate( bufferSize, elementSize );
 
     memcpy( heapAllocation.CPU, bufferData, bufferSize );
@@ -1311,8 +1392,15 @@ void CommandList::SetViewport( const D3D12_VIEWPORT& viewport )
 
 void CommandList::SetViewports( const std::vector<D3D12_VIEWPORT>& viewports )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetViewports, 0, nullptr, {}, viewports.data(),
+                                    viewports.size() * sizeof( D3D12_VIEWPORT ) );
+
     assert( viewports.size() < D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE );
-    m_d3d12CommandList->RSSetViewports( static_cast<UINT>( viewports.size() ), viewports.data() );
+    if ( m_StateFilter.Set( CommandType::SetViewports, 0, 0, viewports.data(),
+                            viewports.size() * sizeof( D3D12_VIEWPORT ) ) )
+    {
+        m_d3d12CommandList->RSSetViewports( static_cast<UINT>( viewports.size() ), viewports.data() );
+    }
 }
 
 void CommandList::SetScissorRect( const D3D12_RECT& scissorRect )
@@ -1322,19 +1410,26 @@ void CommandList::SetScissorRect( const D3D12_RECT& scissorRect )
 
 void CommandList::SetScissorRects( const std::vector<D3D12_RECT>& scissorRects )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetScissorRects, 0, nullptr, {},
+                                    scissorRects.data(), scissorRects.size() * sizeof( D3D12_RECT ) );
+
     assert( scissorRects.size() < D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE );
-    m_d3d12CommandList->RSSetScissorRects( static_cast<UINT>( scissorRects.size() ), scissorRects.data() );
+    if ( m_StateFilter.Set( CommandType::SetScissorRects, 0, 0, scissorRects.data(),
+                            scissorRects.size() * sizeof( D3D12_RECT ) ) )
+    {
+        m_d3d12CommandList->RSSetScissorRects( static_cast<UINT>( scissorRects.size() ), scissorRects.data() );
+    }
 }
 
 void CommandList::SetPipelineState( const std::shared_ptr<PipelineStateObject>& pipelineState )
 {
     assert( pipelineState );
 
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetPipelineState, 0, pipelineState.get() );
+
     auto d3d12PipelineStateObject = pipelineState->GetD3D12PipelineState().Get();
-    if ( m_PipelineState != d3d12PipelineStateObject )
+    if ( m_StateFilter.Set( CommandType::SetPipelineState, 0, d3d12PipelineStateObject ) )
     {
-        m_PipelineState = d3d12PipelineStateObject;
-
         m_d3d12CommandList->SetPipelineState( d3d12PipelineStateObject );
 
         TrackResource( d3d12PipelineStateObject );
@@ -1345,8 +1440,11 @@ void CommandList::SetGraphicsRootSignature( const std::shared_ptr<RootSignature>
 {
     assert( rootSignature );
 
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetGraphicsRootSignature, 0,
+                                    rootSignature.get() );
+
     auto d3d12RootSignature = rootSignature->GetD3D12RootSignature().Get();
-    if ( m_RootSignature != d3d12RootSignature )
+    if ( m_StateFilter.Set( CommandType::SetGraphicsRootSignature, 0, d3d12RootSignature ) )
     {
         m_RootSignature = d3d12RootSignature;
 
@@ -1354,6 +1452,7 @@ void CommandList::SetGraphicsRootSignature( const std::shared_ptr<RootSignature>
         {
             m_DynamicDescriptorHeap[i]->ParseRootSignature( rootSignature );
         }
+        m_StateFilter.InvalidateRootParameters();
 
         m_d3d12CommandList->SetGraphicsRootSignature( m_RootSignature );
 
@@ -1365,8 +1464,11 @@ void CommandList::SetComputeRootSignature( const std::shared_ptr<RootSignature>&
 {
     assert( rootSignature );
 
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetComputeRootSignature, 0,
+                                    rootSignature.get() );
+
     auto d3d12RootSignature = rootSignature->GetD3D12RootSignature().Get();
-    if ( m_RootSignature != d3d12RootSignature )
+    if ( m_StateFilter.Set( CommandType::SetComputeRootSignature, 0, d3d12RootSignature ) )
     {
         m_RootSignature = d3d12RootSignature;
 
@@ -1374,6 +1476,7 @@ void CommandList::SetComputeRootSignature( const std::shared_ptr<RootSignature>&
         {
             m_DynamicDescriptorHeap[i]->ParseRootSignature( rootSignature );
         }
+        m_StateFilter.InvalidateRootParameters();
 
         m_d3d12CommandList->SetComputeRootSignature( m_RootSignature );
 
@@ -1384,13 +1487,21 @@ void CommandList::SetComputeRootSignature( const std::shared_ptr<RootSignature>&
 void CommandList::SetConstantBufferView( uint32_t rootParameterIndex, const std::shared_ptr<ConstantBuffer>& buffer,
                                          D3D12_RESOURCE_STATES stateAfter, size_t bufferOffset )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetConstantBufferView,
+                                    rootParameterIndex, buffer.get(),
+                                    { 0, static_cast<uint32_t>( bufferOffset ), static_cast<uint32_t>( stateAfter ) } );
+
     if ( buffer )
     {
         auto d3d12Resource = buffer->GetD3D12Resource();
         TransitionBarrier( d3d12Resource, stateAfter );
 
-        m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineCBV(
-            rootParameterIndex, d3d12Resource->GetGPUVirtualAddress() + bufferOffset );
+        const D3D12_GPU_VIRTUAL_ADDRESS bufferLocation = d3d12Resource->GetGPUVirtualAddress() + bufferOffset;
+        if ( m_StateFilter.Set( CommandType::SetConstantBufferView, rootParameterIndex, bufferLocation ) )
+        {
+            m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineCBV( rootParameterIndex,
+                                                                                             bufferLocation );
+        }
 
         TrackResource( buffer );
     }
@@ -1398,13 +1509,21 @@ void CommandList::SetConstantBufferView( uint32_t rootParameterIndex, const std:
 
 void CommandList::SetShaderResourceView( uint32_t rootParameterIndex, const std::shared_ptr<Buffer>& buffer, D3D12_RESOURCE_STATES stateAfter, size_t bufferOffset )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetShaderResourceView,
+                                    rootParameterIndex, buffer.get(),
+                                    { 0, static_cast<uint32_t>( bufferOffset ), static_cast<uint32_t>( stateAfter ) } );
+
     if ( buffer )
     {
         auto d3d12Resource = buffer->GetD3D12Resource();
         TransitionBarrier( d3d12Resource, stateAfter );
 
-        m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineSRV(
-            rootParameterIndex, d3d12Resource->GetGPUVirtualAddress() + bufferOffset );
+        const D3D12_GPU_VIRTUAL_ADDRESS bufferLocation = d3d12Resource->GetGPUVirtualAddress() + bufferOffset;
+        if ( m_StateFilter.Set( CommandType::SetShaderResourceView, rootParameterIndex, bufferLocation ) )
+        {
+            m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineSRV( rootParameterIndex,
+                                                                                             bufferLocation );
+        }
 
         TrackResource( buffer );
     }
@@ -1413,13 +1532,21 @@ void CommandList::SetShaderResourceView( uint32_t rootParameterIndex, const std:
 void CommandList::SetUnorderedAccessView( uint32_t rootParameterIndex, const std::shared_ptr<Buffer>& buffer,
                                           D3D12_RESOURCE_STATES stateAfter, size_t bufferOffset )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetUnorderedAccessView,
+                                    rootParameterIndex, buffer.get(),
+                                    { 0, static_cast<uint32_t>( bufferOffset ), static_cast<uint32_t>( stateAfter ) } );
+
     if ( buffer )
     {
         auto d3d12Resource = buffer->GetD3D12Resource();
         TransitionBarrier( d3d12Resource, stateAfter );
 
-        m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineUAV(
-            rootParameterIndex, d3d12Resource->GetGPUVirtualAddress() + bufferOffset );
+        const D3D12_GPU_VIRTUAL_ADDRESS bufferLocation = d3d12Resource->GetGPUVirtualAddress() + bufferOffset;
+        if ( m_StateFilter.Set( CommandType::SetUnorderedAccessView, rootParameterIndex, bufferLocation ) )
+        {
+            m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageInlineUAV( rootParameterIndex,
+                                                                                             bufferLocation );
+        }
 
         TrackResource( buffer );
     }
@@ -1431,6 +1558,11 @@ void CommandList::SetShaderResourceView( uint32_t rootParameterIndex, uint32_t d
 {
     assert( srv );
 
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetShaderResourceView,
+                                    rootParameterIndex, srv.get(),
+                                    { descriptorOffset, firstSubresource, numSubresources,
+                                      static_cast<uint32_t>( stateAfter ) } );
+
     auto resource = srv->GetResource();
     if ( resource )
     {
@@ -1449,14 +1581,24 @@ void CommandList::SetShaderResourceView( uint32_t rootParameterIndex, uint32_t d
         TrackResource( resource );
     }
 
-    m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
-        rootParameterIndex, descriptorOffset, 1, srv->GetDescriptorHandle() );
+    const D3D12_CPU_DESCRIPTOR_HANDLE descriptor = srv->GetDescriptorHandle();
+    if ( m_StateFilter.Set( CommandType::SetShaderResourceView, rootParameterIndex, descriptorOffset, &descriptor,
+                            sizeof( descriptor ) ) )
+    {
+        m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
+            rootParameterIndex, descriptorOffset, 1, descriptor );
+    }
 }
 
 void CommandList::SetShaderResourceView( int32_t rootParameterIndex, uint32_t descriptorOffset,
                                          const std::shared_ptr<Texture>& texture, D3D12_RESOURCE_STATES stateAfter,
                                          UINT firstSubresource, UINT numSubresources )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetShaderResourceView,
+                                    static_cast<uint32_t>( rootParameterIndex ), texture.get(),
+                                    { descriptorOffset, firstSubresource, numSubresources,
+                                      static_cast<uint32_t>( stateAfter ) } );
+
     if ( texture )
     {
         if ( numSubresources < D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES )
@@ -1473,8 +1615,13 @@ void CommandList::SetShaderResourceView( int32_t rootParameterIndex, uint32_t de
 
         TrackResource( texture );
 
-        m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
-            rootParameterIndex, descriptorOffset, 1, texture->GetShaderResourceView() );
+        const D3D12_CPU_DESCRIPTOR_HANDLE descriptor = texture->GetShaderResourceView();
+        if ( m_StateFilter.Set( CommandType::SetShaderResourceView, static_cast<uint32_t>( rootParameterIndex ),
+                                descriptorOffset, &descriptor, sizeof( descriptor ) ) )
+        {
+            m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
+                rootParameterIndex, descriptorOffset, 1, descriptor );
+        }
     }
 }
 
@@ -1485,6 +1632,11 @@ void CommandList::SetUnorderedAccessView( uint32_t rootParameterIndex, uint32_t
 {
     assert( uav );
 
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetUnorderedAccessView,
+                                    rootParameterIndex, uav.get(),
+                                    { descriptorOffset, firstSubresource, numSubresources,
+                                      static_cast<uint32_t>( stateAfter ) } );
+
     auto resource = uav->GetResource();
     if ( resource )
     {
@@ -1503,8 +1655,13 @@ void CommandList::SetUnorderedAccessView( uint32_t rootParameterIndex, uint32_t
         TrackResource( resource );
     }
 
-    m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
-        rootParameterIndex, descriptorOffset, 1, uav->GetDescriptorHandle() );
+    const D3D12_CPU_DESCRIPTOR_HANDLE descriptor = uav->GetDescriptorHandle();
+    if ( m_StateFilter.Set( CommandType::SetUnorderedAccessView, rootParameterIndex, descriptorOffset, &descriptor,
+                            sizeof( descriptor ) ) )
+    {
+        m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
+            rootParameterIndex, descriptorOffset, 1, descriptor );
+    }
 }
 
 void CommandList::SetUnorderedAccessView( uint32_t rootParameterIndex, uint32_t descriptorOffset,
@@ -1512,6 +1669,11 @@ void CommandList::SetUnorderedAccessView( uint32_t rootParameterIndex, uint32_t
                                           D3D12_RESOURCE_STATES stateAfter, UINT firstSubresource,
                                           UINT numSubresources )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetUnorderedAccessView,
+                                    rootParameterIndex, texture.get(),
+                                    { descriptorOffset, firstSubresource, numSubresources,
+                                      static_cast<uint32_t>( stateAfter ), mip } );
+
     if ( texture )
     {
         if ( numSubresources < D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES )
@@ -1528,8 +1690,13 @@ void CommandList::SetUnorderedAccessView( uint32_t rootParameterIndex, uint32_t
 
         TrackResource( texture );
 
-        m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
-            rootParameterIndex, descriptorOffset, 1, texture->GetUnorderedAccessView( mip ) );
+        const D3D12_CPU_DESCRIPTOR_HANDLE descriptor = texture->GetUnorderedAccessView( mip );
+        if ( m_StateFilter.Set( CommandType::SetUnorderedAccessView, rootParameterIndex, descriptorOffset, &descriptor,
+                                sizeof( descriptor ) ) )
+        {
+            m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
+                rootParameterIndex, descriptorOffset, 1, descriptor );
+        }
     }
 }
 
@@ -1539,6 +1706,9 @@ void CommandList::SetConstantBufferView( uint32_t rootParameterIndex, uint32_t d
 {
     assert( cbv );
 
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetConstantBufferView, rootParameterIndex,
+                                    cbv.get(), { descriptorOffset, 0, 0, static_cast<uint32_t>( stateAfter ) } );
+
     auto constantBuffer = cbv->GetConstantBuffer();
     if ( constantBuffer )
     {
@@ -1546,12 +1716,29 @@ void CommandList::SetConstantBufferView( uint32_t rootParameterIndex, uint32_t d
         TrackResource( constantBuffer );
     }
 
-    m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
-        rootParameterIndex, descriptorOffset, 1, cbv->GetDescriptorHandle() );
+    const D3D12_CPU_DESCRIPTOR_HANDLE descriptor = cbv->GetDescriptorHandle();
+    if ( m_StateFilter.Set( CommandType::SetConstantBufferView, rootParameterIndex, descriptorOffset, &descriptor,
+                            sizeof( descriptor ) ) )
+    {
+        m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(
+            rootParameterIndex, descriptorOffset, 1, descriptor );
+    }
 }
 
 void CommandList::SetRenderTarget( const RenderTarget& renderTarget )
 {
+    // The attachments are recorded by id, a render target can change its textures.
+    std::vector<uint32_t> textureIds;
+    if ( m_CommandStream )
+    {
+        for ( const auto& texture: renderTarget.GetTextures() )
+        {
+            textureIds.push_back( m_CommandStream->GetObjectId( texture.get() ) );
+        }
+    }
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::SetRenderTarget, 0, &renderTarget, {},
+                                    textureIds.data(), textureIds.size() * sizeof( uint32_t ) );
+
     std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> renderTargetDescriptors;
     renderTargetDescriptors.reserve( AttachmentPoint::NumAttachmentPoints );
 
@@ -1584,12 +1771,22 @@ void CommandList::SetRenderTarget( const RenderTarget& renderTarget )
 
     D3D12_CPU_DESCRIPTOR_HANDLE* pDSV = depthStencilDescriptor.ptr != 0 ? &depthStencilDescriptor : nullptr;
 
-    m_d3d12CommandList->OMSetRenderTargets( static_cast<UINT>( renderTargetDescriptors.size() ),
-                                            renderTargetDescriptors.data(), FALSE, pDSV );
+    // The bound descriptors, the depth stencil descriptor last.
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> boundDescriptors( renderTargetDescriptors );
+    boundDescriptors.push_back( depthStencilDescriptor );
+    if ( m_StateFilter.Set( CommandType::SetRenderTarget, 0, 0, boundDescriptors.data(),
+                            boundDescriptors.size() * sizeof( D3D12_CPU_DESCRIPTOR_HANDLE ) ) )
+    {
+        m_d3d12CommandList->OMSetRenderTargets( static_cast<UINT>( renderTargetDescriptors.size() ),
+                                                renderTargetDescriptors.data(), FALSE, pDSV );
+    }
 }
 
 void CommandList::Draw( uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::Draw, 0, nullptr,
+                                    { vertexCount, instanceCount, startVertex, startInstance } );
+
     FlushResourceBarriers();
 
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
@@ -1603,6 +1800,10 @@ void CommandList::Draw( uint32_t vertexCount, uint32_t instanceCount, uint32_t s
 void CommandList::DrawIndexed( uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex,
                                uint32_t startInstance )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::DrawIndexed, 0, nullptr,
+                                    { indexCount, instanceCount, startIndex, static_cast<uint32_t>( baseVertex ),
+                                      startInstance } );
+
     FlushResourceBarriers();
 
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
@@ -1616,6 +1817,9 @@ void CommandList::DrawIndexed( uint32_t indexCount, uint32_t instanceCount, uint
 
 void CommandList::Dispatch( uint32_t numGroupsX, uint32_t numGroupsY, uint32_t numGroupsZ )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::Dispatch, 0, nullptr,
+                                    { numGroupsX, numGroupsY, numGroupsZ } );
+
     FlushResourceBarriers();
 
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
@@ -1626,8 +1830,11 @@ void CommandList::Dispatch( uint32_t numGroupsX, uint32_t numGroupsY, uint32_t n
     m_d3d12CommandList->Dispatch( numGroupsX, numGroupsY, numGroupsZ );
 }
 
-void CommandList::MeshShaderDraw(int nbX)
+void CommandList::DispatchMesh( uint32_t numGroupsX, uint32_t numGroupsY, uint32_t numGroupsZ )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::DispatchMesh, 0, nullptr,
+                                    { numGroupsX, numGroupsY, numGroupsZ } );
+
     FlushResourceBarriers();
 
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
@@ -1635,19 +1842,14 @@ void CommandList::MeshShaderDraw(int nbX)
         m_DynamicDescriptorHeap[i]->CommitStagedDescriptorsForDraw( *this );
     }
 
-    int nbY { 1 };
-    if (nbX > 65535)
-    {
-        //nbY += nbX - 65535;
-        nbX = 65535;
-    }
-
     m_d3d12CommandList->SetGraphicsRootSignature( m_RootSignature );
-    m_d3d12CommandList->DispatchMesh( nbX, nbY, 1 );
+    m_d3d12CommandList->DispatchMesh( numGroupsX, numGroupsY, numGroupsZ );
 }
 
 bool CommandList::Close( const std::shared_ptr<CommandList>& pendingCommandList )
 {
+    CommandStream::Scope recording( m_CommandStream.get(), CommandType::Close );
+
     // Flush any remaining barriers.
     FlushResourceBarriers();
 
@@ -1684,8 +1886,9 @@ void CommandList::Reset()
     }
 
     m_RootSignature      = nullptr;
-    m_PipelineState      = nullptr;
     m_ComputeCommandList = nullptr;
+    m_CommandStream      = nullptr;
+    m_StateFilter.Reset();
 }
 
 void CommandList::TrackResource( Microsoft::WRL::ComPtr<ID3D12Object> object )
@@ -0,0 +1,327 @@
+// Built without the precompiled header, the command stream does not depend on Direct3D.
+#include <dx12lib/CommandStream.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <ostream>
+
+using namespace dx12lib;
+
+namespace
+{
+// File header: magic, version, command count and stream size.
+constexpr char     StreamMagic[4] = { 'D', 'X', 'C', 'S' };
+constexpr uint32_t StreamVersion  = 1;
+
+const char* CommandTypeNames[] = {
+    "SetPipelineState",
+    "SetGraphicsRootSignature",
+    "SetComputeRootSignature",
+    "SetPrimitiveTopology",
+    "SetViewports",
+    "SetScissorRects",
+    "SetRenderTarget",
+    "SetVertexBuffers",
+    "SetIndexBuffer",
+    "SetGraphicsDynamicConstantBuffer",
+    "SetGraphicsDynamicStructuredBuffer",
+    "SetGraphics32BitConstants",
+    "SetCompute32BitConstants",
+    "SetConstantBufferView",
+    "SetShaderResourceView",
+    "SetUnorderedAccessView",
+    "ClearTexture",
+    "ClearDepthStencilTexture",
+    "ResolveSubresource",
+    "Draw",
+    "DrawIndexed",
+    "Dispatch",
+    "DispatchMesh",
+    "Close",
+};
+static_assert( std::size( CommandTypeNames ) == static_cast<size_t>( CommandType::NumCommandTypes ),
+               "Every command type needs a name" );
+}  // namespace
+
+const char* dx12lib::GetCommandTypeName( CommandType type )
+{
+    return type < CommandType::NumCommandTypes ? CommandTypeNames[static_cast<size_t>( type )] : "Unknown";
+}
+
+bool dx12lib::IsRootParameterCommand( CommandType type )
+{
+    switch ( type )
+    {
+    case CommandType::SetGraphicsDynamicConstantBuffer:
+    case CommandType::SetGraphicsDynamicStructuredBuffer:
+    case CommandType::SetGraphics32BitConstants:
+    case CommandType::SetCompute32BitConstants:
+    case CommandType::SetConstantBufferView:
+    case CommandType::SetShaderResourceView:
+    case CommandType::SetUnorderedAccessView:
+        return true;
+    default:
+        return false;
+    }
+}
+
+CommandStream::Scope::Scope( CommandStream* stream, CommandType type, uint32_t slot, const void* object,
+                             std::initializer_list<uint32_t> arguments, const void* data, size_t dataSize )
+: m_Stream( stream )
+, m_Offset( 0 )
+{
+    if ( m_Stream )
+    {
+        m_Offset = m_Stream->Record( type, slot, object, arguments, data, dataSize );
+        m_Start  = std::chrono::high_resolution_clock::now();
+    }
+}
+
+CommandStream::Scope::~Scope()
+{
+    if ( m_Stream )
+    {
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - m_Start );
+        m_Stream->SetNanoseconds( m_Offset,
+                                  static_cast<uint32_t>( std::min<int64_t>( duration.count(), UINT32_MAX ) ) );
+    }
+}
+
+size_t CommandStream::Record( CommandType type, uint32_t slot, const void* object,
+                              std::initializer_list<uint32_t> arguments, const void* data, size_t dataSize )
+{
+    RecordedCommand command {};
+    command.Type   = type;
+    command.Slot   = slot;
+    command.Object = GetObjectId( object );
+    std::copy_n( arguments.begin(), std::min<size_t>( arguments.size(), std::size( command.Arguments ) ),
+                 command.Arguments );
+    command.DataSize    = static_cast<uint32_t>( dataSize );
+    command.DataHash    = data ? Hash( data, dataSize ) : 0;
+    command.PayloadSize = data && dataSize <= MaxStoredPayload ? static_cast<uint32_t>( dataSize ) : 0;
+
+    const size_t offset = m_Data.size();
+    m_Data.resize( offset + sizeof( RecordedCommand ) + command.PayloadSize );
+    std::memcpy( m_Data.data() + offset, &command, sizeof( RecordedCommand ) );
+    if ( command.PayloadSize > 0 )
+    {
+        std::memcpy( m_Data.data() + offset + sizeof( RecordedCommand ), data, command.PayloadSize );
+    }
+
+    ++m_CommandCount;
+    return offset;
+}
+
+uint32_t CommandStream::GetObjectId( const void* object )
+{
+    if ( !object )
+        return 0;
+
+    // Ids start at 1, 0 is no object.
+    auto id = m_ObjectIds.try_emplace( object, static_cast<uint32_t>( m_ObjectIds.size() + 1 ) );
+    return id.first->second;
+}
+
+void CommandStream::SetNanoseconds( size_t offset, uint32_t nanoseconds )
+{
+    std::memcpy( m_Data.data() + offset + offsetof( RecordedCommand, Nanoseconds ), &nanoseconds, sizeof( uint32_t ) );
+}
+
+void CommandStream::Clear()
+{
+    m_Data.clear();
+    m_CommandCount = 0;
+    m_ObjectIds.clear();
+}
+
+bool CommandStream::Save( const std::wstring& fileName ) const
+{
+    std::ofstream file( std::filesystem::path( fileName ), std::ios::binary | std::ios::trunc );
+    if ( !file )
+        return false;
+
+    const uint64_t commandCount = m_CommandCount;
+    const uint64_t size         = m_Data.size();
+    file.write( StreamMagic, sizeof( StreamMagic ) );
+    file.write( reinterpret_cast<const char*>( &StreamVersion ), sizeof( StreamVersion ) );
+    file.write( reinterpret_cast<const char*>( &commandCount ), sizeof( commandCount ) );
+    file.write( reinterpret_cast<const char*>( &size ), sizeof( size ) );
+    file.write( reinterpret_cast<const char*>( m_Data.data() ), static_cast<std::streamsize>( size ) );
+
+    return static_cast<bool>( file );
+}
+
+bool CommandStream::Load( const std::wstring& fileName )
+{
+    std::ifstream file( std::filesystem::path( fileName ), std::ios::binary );
+    if ( !file )
+        return false;
+
+    char     magic[4] = {};
+    uint32_t version  = 0;
+    uint64_t commandCount = 0;
+    uint64_t size         = 0;
+    file.read( magic, sizeof( magic ) );
+    file.read( reinterpret_cast<char*>( &version ), sizeof( version ) );
+    file.read( reinterpret_cast<char*>( &commandCount ), sizeof( commandCount ) );
+    file.read( reinterpret_cast<char*>( &size ), sizeof( size ) );
+    if ( !file || !std::equal( std::begin( magic ), std::end( magic ), StreamMagic ) || version != StreamVersion )
+        return false;
+
+    std::vector<uint8_t> data( static_cast<size_t>( size ) );
+    file.read( reinterpret_cast<char*>( data.data() ), static_cast<std::streamsize>( size ) );
+    if ( !file )
+        return false;
+
+    // The object pointers of the recording are gone, only their ids remain.
+    m_Data         = std::move( data );
+    m_CommandCount = static_cast<size_t>( commandCount );
+    m_ObjectIds.clear();
+
+    return true;
+}
+
+uint64_t CommandStream::Hash( const void* data, size_t size )
+{
+    // FNV-1a
+    uint64_t       hash  = 14695981039346656037ull;
+    const uint8_t* bytes = static_cast<const uint8_t*>( data );
+    for ( size_t i = 0; i < size; ++i )
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void dx12lib::Replay( const CommandStream& stream, CommandBackend& backend )
+{
+    stream.ForEach( [&backend]( const RecordedCommand& command, const uint8_t* payload ) {
+        backend.Execute( command, payload );
+    } );
+}
+
+bool NullCommandBackend::IsStateCommand( CommandType type )
+{
+    switch ( type )
+    {
+    case CommandType::SetPipelineState:
+    case CommandType::SetGraphicsRootSignature:
+    case CommandType::SetComputeRootSignature:
+    case CommandType::SetPrimitiveTopology:
+    case CommandType::SetViewports:
+    case CommandType::SetScissorRects:
+    case CommandType::SetRenderTarget:
+    case CommandType::SetVertexBuffers:
+    case CommandType::SetIndexBuffer:
+    case CommandType::SetGraphicsDynamicConstantBuffer:
+    case CommandType::SetGraphicsDynamicStructuredBuffer:
+    case CommandType::SetGraphics32BitConstants:
+    case CommandType::SetCompute32BitConstants:
+    case CommandType::SetConstantBufferView:
+    case CommandType::SetShaderResourceView:
+    case CommandType::SetUnorderedAccessView:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool NullCommandBackend::IsSameState( const RecordedCommand& a, const RecordedCommand& b )
+{
+    return a.Object == b.Object && std::equal( std::begin( a.Arguments ), std::end( a.Arguments ), b.Arguments ) &&
+           a.DataSize == b.DataSize && a.DataHash == b.DataHash;
+}
+
+void NullCommandBackend::Execute( const RecordedCommand& command, const uint8_t* )
+{
+    if ( command.Type >= CommandType::NumCommandTypes )
+        return;
+
+    Statistics& statistics = m_Statistics[static_cast<size_t>( command.Type )];
+    ++statistics.Count;
+    statistics.RecordedNanoseconds += command.Nanoseconds;
+    statistics.DataBytes += command.DataSize;
+
+    if ( command.Type == CommandType::Close )
+    {
+        // A new command list starts with nothing bound.
+        m_BoundState.clear();
+        return;
+    }
+    if ( !IsStateCommand( command.Type ) )
+        return;
+
+    // Descriptor table views are bound per root parameter and descriptor offset (the first argument).
+    const bool isDescriptorView = command.Type == CommandType::SetConstantBufferView ||
+                                  command.Type == CommandType::SetShaderResourceView ||
+                                  command.Type == CommandType::SetUnorderedAccessView;
+    const uint64_t binding = static_cast<uint64_t>( command.Type ) << 56 | static_cast<uint64_t>( command.Slot ) << 24 |
+                             ( isDescriptorView ? command.Arguments[0] & 0xFFFFFF : 0 );
+
+    auto bound = m_BoundState.try_emplace( binding, command );
+    if ( !bound.second && IsSameState( bound.first->second, command ) )
+    {
+        ++statistics.Redundant;
+        return;
+    }
+    bound.first->second = command;
+
+    // A new root signature leaves every root parameter unbound.
+    if ( command.Type == CommandType::SetGraphicsRootSignature || command.Type == CommandType::SetComputeRootSignature )
+    {
+        for ( auto state = m_BoundState.begin(); state != m_BoundState.end(); )
+        {
+            state = IsRootParameterCommand( state->second.Type ) ? m_BoundState.erase( state ) : std::next( state );
+        }
+    }
+}
+
+uint64_t NullCommandBackend::GetCommandCount() const
+{
+    uint64_t count = 0;
+    for ( const Statistics& statistics: m_Statistics )
+    {
+        count += statistics.Count;
+    }
+    return count;
+}
+
+uint64_t NullCommandBackend::GetRedundantCount() const
+{
+    uint64_t count = 0;
+    for ( const Statistics& statistics: m_Statistics )
+    {
+        count += statistics.Redundant;
+    }
+    return count;
+}
+
+void NullCommandBackend::WriteReport( std::ostream& stream ) const
+{
+    uint64_t totalNanoseconds = 0;
+    stream << std::left << std::setw( 36 ) << "command" << std::right << std::setw( 10 ) << "count" << std::setw( 12 )
+           << "redundant" << std::setw( 14 ) << "recorded us" << std::setw( 12 ) << "ns/command" << std::setw( 14 )
+           << "data bytes" << "\n";
+
+    for ( size_t type = 0; type < m_Statistics.size(); ++type )
+    {
+        const Statistics& statistics = m_Statistics[type];
+        if ( statistics.Count == 0 )
+            continue;
+
+        totalNanoseconds += statistics.RecordedNanoseconds;
+        stream << std::left << std::setw( 36 ) << GetCommandTypeName( static_cast<CommandType>( type ) ) << std::right
+               << std::setw( 10 ) << statistics.Count << std::setw( 12 ) << statistics.Redundant << std::setw( 14 )
+               << statistics.RecordedNanoseconds / 1000 << std::setw( 12 )
+               << statistics.RecordedNanoseconds / statistics.Count << std::setw( 14 ) << statistics.DataBytes << "\n";
+    }
+
+    stream << "total: " << GetCommandCount() << " commands, " << GetRedundantCount() << " redundant state changes, "
+           << totalNanoseconds / 1000 << " us recorded\n";
+}
@@ -116,3 +116,8 @@ const DirectX::BoundingBox& dx12lib::Mesh::GetAABB() const {
     return m_AABB;
 }
 
+void Mesh::SetCollisionGeometry( std::vector<DirectX::XMFLOAT3> positions, std::vector<uint32_t> indices )
+{
+    m_CollisionPositions = std::move( positions );
+    m_CollisionIndices   = std::move( indices );
+}
@@ -51,8 +51,9 @@ inline DirectX::BoundingBox CreateBoundingBox( const aiAABB& aabb )
 }
 
 bool Scene::LoadSceneFromFile( CommandList& commandList, const std::wstring& fileName,
-                               const std::function<bool( float )>& loadingProgress )
+                               const std::function<bool( float )>& loadingProgress, bool keepCollisionGeometry )
 {
+    m_KeepCollisionGeometry = keepCollisionGeometry;
 
     fs::path filePath   = fileName;
     fs::path exportPath = fs::path( filePath ).replace_extension( "assbin" );
@@ -347,9 +348,9 @@ void Scene::ImportMesh( CommandList& commandList, const aiMesh& aiMesh )
     mesh->SetVertexBuffer( 0, vertexBuffer );
 
     // Extract the index buffer.
+    std::vector<unsigned int> indices;
     if ( aiMesh.HasFaces() )
     {
-        std::vector<unsigned int> indices;
         for ( i = 0; i < aiMesh.mNumFaces; ++i )
         {
             const aiFace& face = aiMesh.mFaces[i];
@@ -373,6 +374,16 @@ void Scene::ImportMesh( CommandList& commandList, const aiMesh& aiMesh )
     // Set the AABB from the AI Mesh's AABB.
     mesh->SetAABB( CreateBoundingBox( aiMesh.mAABB ) );
 
+    if ( m_KeepCollisionGeometry )
+    {
+        std::vector<XMFLOAT3> positions( vertexData.size() );
+        for ( i = 0; i < vertexData.size(); ++i )
+        {
+            positions[i] = vertexData[i].Position;
+        }
+        mesh->SetCollisionGeometry( std::move( positions ), std::move( indices ) );
+    }
+
     m_Meshes.push_back( mesh );
 }
 
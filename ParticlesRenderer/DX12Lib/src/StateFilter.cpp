@@ -0,0 +1,144 @@
+// Built without the precompiled header, the state filter does not depend on Direct3D.
+#include <dx12lib/StateFilter.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+#include <ostream>
+
+using namespace dx12lib;
+
+namespace
+{
+// Binding spaces after the command types.
+constexpr uint64_t RootParameterSpace = static_cast<uint64_t>( CommandType::NumCommandTypes );
+constexpr uint64_t RootSignatureSpace = RootParameterSpace + 1;
+}  // namespace
+
+uint64_t StateFilter::GetBinding( CommandType type, uint32_t slot, uint32_t element )
+{
+    uint64_t space = static_cast<uint64_t>( type );
+    if ( IsRootParameterCommand( type ) )
+    {
+        space = RootParameterSpace;
+    }
+    else if ( type == CommandType::SetGraphicsRootSignature || type == CommandType::SetComputeRootSignature )
+    {
+        space = RootSignatureSpace;
+    }
+
+    return space << 56 | static_cast<uint64_t>( slot & 0xFFFFFF ) << 32 | element;
+}
+
+bool StateFilter::Bind( CommandType type, uint32_t slot, uint32_t element, const void* data, size_t sizeInBytes )
+{
+    const uint64_t binding = GetBinding( type, slot, element );
+    if ( sizeInBytes > MaxFilteredSize )
+    {
+        m_BoundState.erase( binding );
+        return true;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>( data );
+    auto           bound = m_BoundState.try_emplace( binding );
+    BoundState&    state = bound.first->second;
+    if ( !bound.second && state.Type == type && state.Data.size() == sizeInBytes &&
+         std::equal( bytes, bytes + sizeInBytes, state.Data.begin() ) )
+    {
+        return false;
+    }
+
+    state.Type = type;
+    state.Data.assign( bytes, bytes + sizeInBytes );
+    return true;
+}
+
+bool StateFilter::Set( CommandType type, uint32_t slot, uint32_t element, const void* data, size_t sizeInBytes )
+{
+    Counters& counters = m_Counters[static_cast<size_t>( type )];
+    ++counters.Calls;
+
+    if ( Bind( type, slot, element, data, sizeInBytes ) )
+        return true;
+
+    ++counters.Filtered;
+    return false;
+}
+
+bool StateFilter::SetRange( CommandType type, uint32_t firstSlot, const void* data, size_t elementSize,
+                            size_t numElements )
+{
+    Counters& counters = m_Counters[static_cast<size_t>( type )];
+    ++counters.Calls;
+
+    // Every slot is bound, even after the first change.
+    bool           isChanged = false;
+    const uint8_t* bytes     = static_cast<const uint8_t*>( data );
+    for ( size_t i = 0; i < numElements; ++i )
+    {
+        isChanged |= Bind( type, firstSlot + static_cast<uint32_t>( i ), 0, bytes + i * elementSize, elementSize );
+    }
+
+    if ( isChanged || numElements == 0 )
+        return true;
+
+    ++counters.Filtered;
+    return false;
+}
+
+void StateFilter::Invalidate( CommandType type, uint32_t slot, uint32_t element )
+{
+    m_BoundState.erase( GetBinding( type, slot, element ) );
+}
+
+void StateFilter::InvalidateRootParameters()
+{
+    for ( auto state = m_BoundState.begin(); state != m_BoundState.end(); )
+    {
+        state = state->first >> 56 == RootParameterSpace ? m_BoundState.erase( state ) : std::next( state );
+    }
+}
+
+void StateFilter::Reset()
+{
+    m_BoundState.clear();
+    m_Counters = {};
+}
+
+uint64_t StateFilter::GetCallCount() const
+{
+    uint64_t count = 0;
+    for ( const Counters& counters: m_Counters )
+    {
+        count += counters.Calls;
+    }
+    return count;
+}
+
+uint64_t StateFilter::GetFilteredCount() const
+{
+    uint64_t count = 0;
+    for ( const Counters& counters: m_Counters )
+    {
+        count += counters.Filtered;
+    }
+    return count;
+}
+
+void StateFilter::WriteReport( std::ostream& stream ) const
+{
+    stream << std::left << std::setw( 36 ) << "command" << std::right << std::setw( 10 ) << "calls" << std::setw( 12 )
+           << "filtered" << "\n";
+
+    for ( size_t type = 0; type < m_Counters.size(); ++type )
+    {
+        const Counters& counters = m_Counters[type];
+        if ( counters.Calls == 0 )
+            continue;
+
+        stream << std::left << std::setw( 36 ) << GetCommandTypeName( static_cast<CommandType>( type ) ) << std::right
+               << std::setw( 10 ) << counters.Calls << std::setw( 12 ) << counters.Filtered << "\n";
+    }
+
+    stream << "total: " << GetCallCount() << " state calls, " << GetFilteredCount() << " filtered\n";
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// Finds the fastest values of a set of tuning parameters on the current machine.
+// Every combination of the parameter values is a candidate, the first values of all the parameters are the
+// baseline. The candidates are measured in rounds, every round runs one trial of each candidate in a shuffled
+// order so slow drifts of the machine (clocks, temperature, background work) spread over all of them. A trial
+// is the mean frame time of a block of frames, measured by the caller.
+// Once every round is done, the fastest candidate is only adopted when Welch's t-test says it differs from the
+// baseline at the significance level, Bonferroni corrected over the candidates, and when it is faster by at
+// least MinImprovement. Otherwise the baseline is kept: a win inside the noise is not a win.
+class Autotuner
+{
+public:
+    struct Parameter
+    {
+        std::string      Name;
+        std::vector<int> Values;  // the first value is the baseline
+    };
+
+    // Value of every parameter by name.
+    using Configuration = std::map<std::string, int>;
+
+    struct Settings
+    {
+        uint32_t WarmupRounds;    // rounds measured and thrown away
+        uint32_t Rounds;          // trials kept per candidate, at least 2
+        double   Significance;    // 0.05 for 95% confidence
+        double   MinImprovement;  // fraction of the baseline mean
+    };
+
+    struct Result
+    {
+        Configuration Candidate;
+        double        MeanMilliseconds;
+        double        StandardDeviation;
+        double        StandardError;
+        double        PValue;  // two-sided, against the baseline, 1 for the baseline itself
+        bool          IsSignificant;
+    };
+
+    Autotuner( std::vector<Parameter> parameters, const Settings& settings, uint32_t seed = 1 );
+
+    // The candidate the next trial measures.
+    const Configuration& GetCurrentConfiguration() const
+    {
+        return m_Candidates[m_Order[m_OrderCursor]];
+    }
+    // Records a trial of the current candidate and moves to the next one, ignored once done.
+    void AddTrial( double milliseconds );
+
+    bool IsDone() const
+    {
+        return m_IsDone;
+    }
+    size_t GetTrialCount() const
+    {
+        return m_Candidates.size() * ( m_Settings.WarmupRounds + m_Settings.Rounds );
+    }
+
+    // Valid once done, the results follow the order of the candidates.
+    const std::vector<Result>& GetResults() const
+    {
+        return m_Results;
+    }
+    // The baseline when no candidate is a significant win.
+    const Configuration& GetBestConfiguration() const
+    {
+        return m_Candidates[m_BestCandidate];
+    }
+
+    void WriteReport( const std::string& fileName, const std::string& machine ) const;
+
+    // Configuration file of key=value lines. A file tuned on another machine is not loaded.
+    static bool SaveConfiguration( const std::string& fileName, const std::string& machine, const Configuration& configuration );
+    static bool LoadConfiguration( const std::string& fileName, const std::string& machine, Configuration& configuration );
+
+    // Two-sided p-value of Welch's t-test between two samples of at least 2 values.
+    static double WelchTest( double meanA, double varianceA, size_t countA, double meanB, double varianceB, size_t countB );
+
+private:
+    void ShuffleRound();
+    void ComputeResults();
+
+    std::vector<Parameter>     m_Parameters;
+    Settings                   m_Settings;
+    std::vector<Configuration> m_Candidates {};
+
+    std::vector<std::vector<double>> m_Trials {};  // per candidate, without the warmup rounds
+    std::vector<size_t>              m_Order {};   // candidates of the current round
+    size_t                           m_OrderCursor { 0 };
+    uint32_t                         m_Round { 0 };
+    std::mt19937                     m_Random;
+    bool                             m_IsDone { false };
+
+    std::vector<Result> m_Results {};
+    size_t              m_BestCandidate { 0 };
+};
@@ -104,7 +104,7 @@ protected:
 
     // This data must be aligned otherwise the SSE intrinsics fail
     // and throw exceptions.
-    __declspec(align(16)) struct AlignedData
+    struct alignas( 16 ) AlignedData
     {
         // World-space position of the camera.
         DirectX::XMVECTOR m_Translation;
@@ -0,0 +1,29 @@
+#pragma once
+#include "InstancedDraw.h"
+#include "RenderQueue.h"
+
+#include <cstdint>
+
+namespace dx12lib
+{
+    class CommandList;
+    class Scene;
+}
+
+// Draws the particle point scene on a command list through a render queue, the offset is a root constant.
+class CommandListInstancedDrawBackend : public InstancedDrawBackend
+{
+public:
+    CommandListInstancedDrawBackend( dx12lib::CommandList& commandList, dx12lib::Scene& scene, uint32_t offsetRootParameterIndex,
+                                     const RenderQueue::Bindings& bindings );
+
+    void SetInstanceOffset( uint32_t offset ) override;
+    void DrawInstanced( uint32_t instanceCount ) override;
+
+private:
+    dx12lib::CommandList& m_CommandList;
+    dx12lib::Scene&       m_Scene;
+    uint32_t              m_OffsetRootParameterIndex;
+    RenderQueue::Bindings m_Bindings;
+    RenderQueue           m_RenderQueue {};
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include "TileCoverage.h"
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+class Particle;
+class Profiler;
+
+// Estimates on the CPU how many pixels a particle system covers and where its overdraw is.
+// Every drawn particle is projected as a screen aligned square, the tile coverage adds the squares to its tiles.
+class CoverageEstimator : public TileCoverage
+{
+public:
+    // Scales are indexed like the particles, nullptr when the particles are not scaled.
+    void Estimate( const std::vector<Particle>& particles, const std::vector<uint32_t>& drawList, const float* scales,
+                   float particleSize, DirectX::FXMMATRIX viewMatrix, DirectX::CXMMATRIX projectionMatrix, Profiler& profiler );
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include "InstanceBufferRing.h"
+
+#include <memory>
+#include <vector>
+
+namespace dx12lib
+{
+    class CommandQueue;
+    class Device;
+    class StructuredBuffer;
+}
+
+// Upload heap buffers mapped once at creation and read by the GPU in place, fenced on the direct queue.
+class D3D12InstanceBufferBackend : public InstanceBufferBackend
+{
+public:
+    D3D12InstanceBufferBackend( dx12lib::Device& device, dx12lib::CommandQueue& commandQueue );
+
+    Buffer Create( size_t size ) override;
+    void   Destroy( const Buffer& buffer ) override;
+    void   Bind( dx12lib::CommandList& commandList, uint32_t rootParameterIndex, const Buffer& buffer ) override;
+
+    uint64_t Signal() override;
+    bool     IsComplete( uint64_t fenceValue ) override;
+    void     Wait( uint64_t fenceValue ) override;
+
+private:
+    dx12lib::Device&       m_Device;
+    dx12lib::CommandQueue& m_CommandQueue;
+
+    // Indexed by buffer id - 1, destroyed buffers are reset and their ids reused
+    std::vector<std::shared_ptr<dx12lib::StructuredBuffer>> m_Buffers {};
+    std::vector<uint32_t>                                   m_FreeIds {};
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+class Camera;
+class Particle;
+class Profiler;
+
+enum class DepthSortMode
+{
+    Off,
+    Full,
+    Incremental
+};
+
+// Sorts particle indices back to front along the view direction so alpha blending composes correctly.
+// The view depths are quantized to 16 bits between the closest and the furthest particle and sorted with a
+// parallel radix sort. The incremental mode starts from the order of the previous frame and repairs it with a
+// bounded insertion sort per chunk followed by merges of the chunks. It falls back to the radix sort when the
+// camera moved, the previous order was invalidated or the repair needs too many moves.
+class DepthSort
+{
+public:
+    void SetMode( DepthSortMode mode )
+    {
+        m_Mode = mode;
+    }
+    DepthSortMode GetMode() const
+    {
+        return m_Mode;
+    }
+
+    // Sorts the indices of the particles to draw in place, back to front.
+    void Sort( const std::vector<Particle>& particles, const Camera& camera, std::vector<uint32_t>& indices, Profiler& profiler );
+
+    // The particle storage was moved, the indices of the previous order do not point to the same particles anymore.
+    void Invalidate()
+    {
+        m_PreviousOrder.clear();
+    }
+
+private:
+    void ComputeKeys( const std::vector<Particle>& particles, const Camera& camera, const std::vector<uint32_t>& indices );
+    void SortFull( std::vector<uint32_t>& indices );
+    bool SortIncremental( std::vector<uint32_t>& indices );
+
+    // Previous order restricted to the indices to draw, the indices that were not drawn last frame are appended.
+    void BuildCandidateOrder( const std::vector<uint32_t>& indices, size_t particleCount );
+    bool HasCameraMoved( const Camera& camera ) const;
+
+    static constexpr uint32_t m_KeyBits { 16 };
+    static constexpr size_t   m_ChunkSize { 4096 };
+    static constexpr size_t   m_MaxShiftsPerParticle { 8 };
+    static constexpr float    m_MaxCameraMovement { 0.05f };
+    static constexpr float    m_MinCameraRotationDot { 0.9999f };
+
+    DepthSortMode m_Mode { DepthSortMode::Off };
+
+    std::vector<float>    m_Depths {};
+    std::vector<uint32_t> m_Keys {};
+    std::vector<uint32_t> m_TempKeys {};
+    std::vector<uint32_t> m_TempIndices {};
+    std::vector<uint64_t> m_Entries {};  // Key in the high bits, index in the low bits
+    std::vector<uint32_t> m_Candidate {};
+    std::vector<uint8_t>  m_IsToDraw {};
+
+    std::vector<uint32_t> m_PreviousOrder {};
+    DirectX::XMFLOAT3     m_PreviousCameraPosition {};
+    DirectX::XMFLOAT4     m_PreviousCameraRotation {};
+};
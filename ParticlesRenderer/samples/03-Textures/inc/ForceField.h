@@ -0,0 +1,134 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class Particle;
+class Profiler;
+class VectorFieldVolume;
+
+enum class ForceFieldType : uint32_t
+{
+    Attractor,
+    Vortex,
+    Drag,
+    Wind,
+    CurlNoise,
+    Volume,
+    Count
+};
+
+// Pulls particles towards Position (pushes them away with a negative strength).
+// Radius softens the field so particles close to the center are not shot away.
+struct PointAttractor
+{
+    DirectX::XMFLOAT3 Position;
+    float             Strength;
+    float             Radius;
+};
+
+// Swirls particles around the axis going through Center.
+struct Vortex
+{
+    DirectX::XMFLOAT3 Center;
+    DirectX::XMFLOAT3 Axis;
+    float             Strength;
+    float             Radius;
+};
+
+struct LinearDrag
+{
+    float Coefficient;
+};
+
+// Pulls the particle velocity towards the wind velocity.
+struct Wind
+{
+    DirectX::XMFLOAT3 Velocity;
+    float             Coefficient;
+};
+
+// Divergence free turbulence, evaluated as the curl of an animated periodic potential.
+struct CurlNoise
+{
+    float Frequency;
+    float Strength;
+    float Speed;
+};
+
+// Moves particles through a baked vector field volume placed at Origin and scaled by Scale.
+// With a tightness of 0 the sampled vectors are accelerations, otherwise the particle velocity is pulled
+// towards the sampled vectors.
+struct VolumeField
+{
+    std::shared_ptr<const VectorFieldVolume> Volume;
+    DirectX::XMFLOAT3                        Origin;
+    float                                    Scale;
+    float                                    Intensity;
+    float                                    Tightness;
+};
+
+// Set of force fields applied to the particle velocities before they are integrated.
+// Particles are gathered in fixed size SoA batches and every field is evaluated 4 particles at a time.
+// Only the field types that are in use are instantiated in the batch loop.
+class ForceFieldSet
+{
+public:
+    static constexpr size_t BatchSize { 1024 };
+
+    void AddAttractor( const PointAttractor& attractor );
+    void AddVortex( const Vortex& vortex );
+    void AddDrag( const LinearDrag& drag );
+    void AddWind( const Wind& wind );
+    void AddCurlNoise( const CurlNoise& curlNoise );
+    void AddVolume( const VolumeField& volume );
+    void Clear();
+
+    bool IsEmpty() const
+    {
+        return GetActiveMask() == 0;
+    }
+
+    void Advance( float deltaTime );
+    void Apply( Particle* particles, size_t count, float deltaTime ) const;
+
+    // Adds the time spent in every field type since the last call to the profiler.
+    void ReportTimings( Profiler& profiler ) const;
+
+private:
+    static constexpr uint32_t FieldTypeCount { static_cast<uint32_t>( ForceFieldType::Count ) };
+
+    static constexpr uint32_t GetBit( ForceFieldType type )
+    {
+        return 1u << static_cast<uint32_t>( type );
+    }
+
+    using BatchFunction = void ( ForceFieldSet::* )( Particle*, size_t, float ) const;
+
+    template<size_t... Masks>
+    static std::array<BatchFunction, sizeof...( Masks )> MakeBatchTable( std::index_sequence<Masks...> );
+
+    template<uint32_t Mask>
+    void ApplyBatch( Particle* particles, size_t count, float deltaTime ) const;
+
+    template<typename Func>
+    void TimedPass( ForceFieldType type, Func&& func ) const;
+
+    uint32_t GetActiveMask() const;
+
+    std::vector<PointAttractor> m_Attractors {};
+    std::vector<Vortex>         m_Vortices {};
+    std::vector<Wind>           m_Winds {};
+    std::vector<CurlNoise>      m_CurlNoises {};
+    std::vector<VolumeField>    m_Volumes {};
+    float                       m_DragCoefficient { 0.0f };
+
+    float m_Time { 0.0f };
+
+    mutable std::array<std::atomic<long long>, FieldTypeCount> m_Nanoseconds {};
+};
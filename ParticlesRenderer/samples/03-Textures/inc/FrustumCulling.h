@@ -0,0 +1,68 @@
+#pragma once
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class Particle;
+class Profiler;
+
+// Normalized planes of a view frustum, pointing inside.
+struct FrustumPlanes
+{
+    DirectX::XMFLOAT4 Planes[6];
+
+    static FrustumPlanes FromViewProjection( DirectX::FXMMATRIX viewProjectionMatrix );
+
+    DirectX::ContainmentType Contains( const DirectX::BoundingBox& box ) const;
+};
+
+// View projection matrices of the 6 faces of a cubemap centered on position, in the +X, -X, +Y, -Y, +Z, -Z
+// face order of D3D12 texture cubes.
+std::array<DirectX::XMMATRIX, 6> GetCubemapViewProjections( DirectX::FXMVECTOR position, float nearZ, float farZ );
+
+// Culls the bounding spheres of the particles against up to MaxViews frusta in a single sweep, 4 particles
+// at a time, so the particle data is only read once whatever the number of views.
+// Every particle gets a bitmask of the views it is visible in. Every chunk of the parallel update also writes
+// the visible particles of every view to its own lists, which are then compacted in one list of indices per view.
+class ParticleCuller
+{
+public:
+    static constexpr size_t MaxViews { 8 };
+
+    void Begin( const std::vector<FrustumPlanes>& views, float radius, size_t particleCount, size_t chunkSize );
+    void CullChunk( const Particle* particles, size_t chunk, size_t begin, size_t end );
+    void End( Profiler& profiler );
+
+    size_t GetViewCount() const
+    {
+        return m_Views.size();
+    }
+    std::vector<uint32_t>& GetVisibleIndices( size_t view )
+    {
+        return m_VisibleIndices[view];
+    }
+    const std::vector<uint32_t>& GetVisibleIndices( size_t view ) const
+    {
+        return m_VisibleIndices[view];
+    }
+    // Bit v of a particle mask is set when the particle is visible in view v.
+    const std::vector<uint8_t>& GetVisibilityMasks() const
+    {
+        return m_VisibilityMasks;
+    }
+
+private:
+    std::vector<FrustumPlanes> m_Views {};
+    float                      m_Radius { 0.0f };
+    size_t                     m_ParticleCount { 0 };
+
+    std::vector<uint8_t> m_VisibilityMasks {};
+
+    // Indexed by view, then by chunk
+    std::array<std::vector<std::vector<uint32_t>>, MaxViews> m_ChunkVisibleIndices {};
+    std::array<std::vector<uint32_t>, MaxViews>              m_VisibleIndices {};
+    std::vector<size_t>                                      m_ChunkOffsets {};
+};
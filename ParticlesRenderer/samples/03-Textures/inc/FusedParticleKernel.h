@@ -0,0 +1,114 @@
+#pragma once
+#include "ParticlePacker.h"
+
+#include <DirectXMath.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class InstanceBufferRing;
+class Particle;
+class Profiler;
+struct FrustumPlanes;
+
+// Destination of the packed records, usually a persistently mapped upload buffer.
+class PackedParticleTarget
+{
+public:
+    virtual ~PackedParticleTarget() = default;
+
+    // Returns room for at least capacity records, written by several threads until Unmap.
+    virtual PackedParticle* Map( size_t capacity ) = 0;
+    // The first count records of the mapped memory were written.
+    virtual void Unmap( size_t count ) = 0;
+};
+
+// Plain host memory destination, to test the kernel without a device.
+class HostPackedParticleTarget : public PackedParticleTarget
+{
+public:
+    PackedParticle* Map( size_t capacity ) override;
+    void            Unmap( size_t count ) override;
+
+    const PackedParticle* GetData() const
+    {
+        return reinterpret_cast<const PackedParticle*>( m_Storage.data() );
+    }
+    size_t GetCount() const
+    {
+        return m_Count;
+    }
+
+private:
+    std::vector<DirectX::XMVECTOR> m_Storage {};  // 2 records per vector, keeps the records 16 byte aligned
+    size_t                         m_Count { 0 };
+};
+
+// Instance buffer of the current frame of a ring, the records are written straight in the memory the GPU reads.
+class RingPackedParticleTarget : public PackedParticleTarget
+{
+public:
+    explicit RingPackedParticleTarget( InstanceBufferRing& ring )
+    : m_Ring { ring }
+    {}
+
+    PackedParticle* Map( size_t capacity ) override;
+    void            Unmap( size_t count ) override
+    {
+        m_Count = count;
+    }
+
+    size_t GetCount() const
+    {
+        return m_Count;
+    }
+
+private:
+    InstanceBufferRing& m_Ring;
+    size_t              m_Count { 0 };
+};
+
+// Fused last stage of the particle update: interpolates the render position, culls it against the camera and
+// encodes it straight into the mapped target, without render matrices or draw list in between.
+// Every chunk of the update fills a 64 record block on its own, one mesh shader group, and reserves its place in
+// the target with one atomic add per block. Full blocks are written with non-temporal stores so the write combined
+// upload memory is never read back, the last block of a chunk is padded with empty records (Size 0), which the
+// mesh shader draws as degenerate quads. The records of a frame are in no particular order.
+class FusedParticleKernel
+{
+public:
+    static constexpr size_t BlockSize { 64 };
+
+    // The frustum is nullptr when every particle is visible. The records are quantized in bounds, which must
+    // contain every particle of the frame.
+    void Begin( PackedParticleTarget& target, size_t particleCount, size_t chunkSize, const FrustumPlanes* frustum, float radius,
+                const PackedParticleEncoder& encoder );
+    void WriteChunk( const Particle* particles, size_t begin, size_t end, float interpolation );
+    // Returns the amount of records written, padding included, always a multiple of BlockSize.
+    size_t End( Profiler& profiler );
+
+    size_t GetRecordCount() const
+    {
+        return m_RecordCount;
+    }
+    const PackedParticleHeader& GetHeader() const
+    {
+        return m_Encoder.GetHeader();
+    }
+
+private:
+    void FlushBlock( const PackedParticle* block );
+
+    PackedParticleTarget* m_Target { nullptr };
+    PackedParticle*       m_Destination { nullptr };
+    size_t                m_Capacity { 0 };
+    bool                  m_IsCulling { false };
+    DirectX::XMFLOAT4     m_Planes[6] {};
+    float                 m_Radius { 0.0f };
+    PackedParticleEncoder m_Encoder {};
+
+    std::atomic<size_t> m_Cursor { 0 };
+    std::atomic<size_t> m_VisibleCount { 0 };
+    size_t              m_RecordCount { 0 };
+};
@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace dx12lib
+{
+    class CommandList;
+}
+class Profiler;
+
+// Persistently mapped buffers and the fences of the frames using them.
+class InstanceBufferBackend
+{
+public:
+    struct Buffer
+    {
+        uint32_t Id;
+        void*    Data;  // mapped for the whole life of the buffer
+        size_t   Size;
+    };
+
+    virtual ~InstanceBufferBackend() = default;
+
+    virtual Buffer Create( size_t size ) = 0;
+    virtual void   Destroy( const Buffer& buffer ) = 0;
+    // Binds the buffer as an inline SRV of the root signature.
+    virtual void Bind( dx12lib::CommandList& commandList, uint32_t rootParameterIndex, const Buffer& buffer ) = 0;
+
+    // Returns a fence value reached once the work submitted so far is done.
+    virtual uint64_t Signal() = 0;
+    virtual bool     IsComplete( uint64_t fenceValue ) = 0;
+    virtual void     Wait( uint64_t fenceValue ) = 0;
+};
+
+// Host memory buffers and fences completed by hand, for headless tests. With the automatic completion every
+// fence is done as soon as it is signaled, like a GPU which is never behind.
+class HostInstanceBufferBackend : public InstanceBufferBackend
+{
+public:
+    explicit HostInstanceBufferBackend( bool isCompletingAutomatically = true )
+    : m_IsCompletingAutomatically { isCompletingAutomatically }
+    {}
+
+    Buffer Create( size_t size ) override;
+    void   Destroy( const Buffer& buffer ) override;
+    void   Bind( dx12lib::CommandList&, uint32_t, const Buffer& buffer ) override
+    {
+        m_BoundId = buffer.Id;
+    }
+
+    uint64_t Signal() override;
+    bool     IsComplete( uint64_t fenceValue ) override
+    {
+        return fenceValue <= m_CompletedValue;
+    }
+    void Wait( uint64_t fenceValue ) override;
+
+    // The GPU finished the work up to fenceValue.
+    void Complete( uint64_t fenceValue );
+
+    size_t GetLiveBufferCount() const
+    {
+        return m_LiveBufferCount;
+    }
+    uint32_t GetBoundId() const
+    {
+        return m_BoundId;
+    }
+
+private:
+    std::vector<std::unique_ptr<uint8_t[]>> m_Buffers {};
+    size_t                                  m_LiveBufferCount { 0 };
+    uint32_t                                m_BoundId { 0 };
+    uint64_t                                m_SignaledValue { 0 };
+    uint64_t                                m_CompletedValue { 0 };
+    bool                                    m_IsCompletingAutomatically;
+};
+
+// Ring of instance buffers, one per frame in flight, which replaces a new upload resource every frame.
+// The buffer of a frame is only written again once the fence signaled after that frame was reached. A buffer
+// too small is replaced by one twice as large (or as large as needed), a buffer four times larger than the
+// largest use of the last ShrinkWindowFrames frames is replaced by one twice as large as that use.
+class InstanceBufferRing
+{
+public:
+    static constexpr uint32_t FramesInFlight { 3 };
+    static constexpr size_t   MinSize { 64 * 1024 };
+    static constexpr uint32_t ShrinkWindowFrames { 300 };
+
+    ~InstanceBufferRing();
+
+    // Releases the buffers of the previous backend once the GPU is done with them, nullptr to only release.
+    void SetBackend( std::unique_ptr<InstanceBufferBackend> backend );
+    bool HasBackend() const
+    {
+        return m_Backend != nullptr;
+    }
+
+    // Mapped memory of the current frame, at least size bytes. Called at most once per frame, the data of the
+    // previous call of the frame is lost.
+    void* Allocate( size_t size );
+    // Binds the buffer of the current frame as an inline SRV.
+    void Bind( dx12lib::CommandList& commandList, uint32_t rootParameterIndex ) const;
+    // After the command list of the frame is executed, signals the fence of the frame and moves to the next buffer.
+    void EndFrame();
+
+    // Logs and clears the counters since the last report.
+    void Report( Profiler& profiler );
+
+private:
+    struct Slot
+    {
+        InstanceBufferBackend::Buffer Storage {};  // Size 0 until the first allocation
+        uint64_t                      FenceValue { 0 };
+        size_t                        UsedSize { 0 };
+    };
+
+    void Release();
+
+    std::unique_ptr<InstanceBufferBackend> m_Backend {};
+    Slot                                   m_Slots[FramesInFlight] {};
+    uint32_t                               m_CurrentSlot { 0 };
+
+    size_t   m_WindowPeakSize { 0 };
+    size_t   m_ShrinkSize { 0 };  // largest use of the last full window
+    bool     m_HasShrinkSize { false };
+    uint32_t m_WindowFrames { 0 };
+
+    //counters since the last report
+    uint32_t m_Grows { 0 };
+    uint32_t m_Shrinks { 0 };
+    uint32_t m_FenceWaits { 0 };
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Commands of the instanced particle draws, the instance stream is bound by the caller.
+class InstancedDrawBackend
+{
+public:
+    virtual ~InstancedDrawBackend() = default;
+
+    // Index in the instance stream of the first instance of the next draws.
+    virtual void SetInstanceOffset( uint32_t offset ) = 0;
+    virtual void DrawInstanced( uint32_t instanceCount ) = 0;
+};
+
+// Keeps the commands instead of recording them, to count them without a device.
+class RecordingInstancedDrawBackend : public InstancedDrawBackend
+{
+public:
+    enum class CommandType
+    {
+        SetInstanceOffset,
+        DrawInstanced
+    };
+
+    struct Command
+    {
+        CommandType Type;
+        uint32_t    Value;  // offset or instance count
+    };
+
+    void SetInstanceOffset( uint32_t offset ) override
+    {
+        m_Commands.emplace_back( Command { CommandType::SetInstanceOffset, offset } );
+    }
+    void DrawInstanced( uint32_t instanceCount ) override
+    {
+        m_Commands.emplace_back( Command { CommandType::DrawInstanced, instanceCount } );
+    }
+
+    const std::vector<Command>& GetCommands() const
+    {
+        return m_Commands;
+    }
+    size_t GetCount( CommandType type ) const;
+    size_t GetInstanceCount() const;
+    void   Clear()
+    {
+        m_Commands.clear();
+    }
+
+private:
+    std::vector<Command> m_Commands {};
+};
+
+// Draws the first instanceCount instances of the stream in draws of at most maxInstancesPerDraw instances,
+// returns the amount of draws.
+size_t SubmitInstancedDraws( InstancedDrawBackend& backend, size_t instanceCount, size_t maxInstancesPerDraw );
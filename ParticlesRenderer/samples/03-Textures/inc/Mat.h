@@ -31,4 +31,5 @@ struct Vec3
 namespace Math
 {
 	float GetRandomInRange( float min, float max );
+	void XM_CALLCONV ComputeMatrices( const DirectX::FXMMATRIX& model, DirectX::CXMMATRIX view, DirectX::CXMMATRIX viewProjection, Mat& mat );
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Root constants of a mesh dispatch, register( b4 ) of the mesh shaders. Every group finds its linear index
+//     GroupOffset + ( SV_GroupID.z * GroupsY + SV_GroupID.y ) * GroupsX + SV_GroupID.x
+// and draws the items [ index * itemsPerGroup, min( ( index + 1 ) * itemsPerGroup, ItemEnd ) ). Groups past the end
+// of their dispatch draw nothing, their items belong to the next dispatch.
+struct MeshDispatchConstants
+{
+    uint32_t GroupOffset;
+    uint32_t GroupsX;
+    uint32_t GroupsY;
+    uint32_t ItemEnd;
+};
+
+struct MeshDispatch
+{
+    uint32_t              X;
+    uint32_t              Y;
+    uint32_t              Z;
+    MeshDispatchConstants Constants;
+};
+
+// D3D12 limits of DispatchMesh
+static constexpr uint32_t MaxMeshGroupsPerDimension { 65535 };
+static constexpr uint32_t MaxMeshGroupsPerDispatch { 1u << 22 };
+
+// Dispatches drawing itemCount items, itemsPerGroup per group. The groups are ceil( itemCount / itemsPerGroup ),
+// tiled in X, then Y, then Z, and split in several dispatches past maxGroupsPerDispatch. The tile of a dispatch
+// may have a few more groups than the dispatch.
+std::vector<MeshDispatch> PlanMeshDispatches( uint64_t itemCount, uint32_t itemsPerGroup,
+                                              uint32_t maxGroupsPerDimension = MaxMeshGroupsPerDimension,
+                                              uint32_t maxGroupsPerDispatch  = MaxMeshGroupsPerDispatch );
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class Particle;
+class Profiler;
+
+// Sorts the particle storage by the Morton code of the particle positions every Interval frames, so particles
+// that are close in space are also close in memory. The work is spread over 3 frames: the codes are computed
+// on the first one, radix sorted on the second one and the particles are moved on the third one.
+// The particles are permuted in place, a second copy of the particles would double their memory.
+class MortonReorder
+{
+public:
+    // Frames between two reorders, 0 disables the reordering.
+    void SetInterval( int frames )
+    {
+        m_Interval = frames;
+    }
+
+    // Returns true when the particles were moved this frame, GetOrder() then gives the previous index of every particle.
+    bool Update( std::vector<Particle>& particles, Profiler& profiler );
+
+    const std::vector<uint32_t>& GetOrder() const
+    {
+        return m_Order;
+    }
+
+private:
+    enum class Stage
+    {
+        Idle,
+        Sort,
+        Apply
+    };
+
+    void ComputeCodes( const std::vector<Particle>& particles );
+    void Sort();
+    void Apply( std::vector<Particle>& particles );
+
+    static constexpr size_t   m_ChunkSize { 4096 };
+    static constexpr uint32_t m_BitsPerAxis { 10 };
+
+    int   m_Interval { 0 };
+    int   m_FrameCounter { 0 };
+    Stage m_Stage { Stage::Idle };
+
+    std::vector<uint32_t> m_Codes {};
+    std::vector<uint32_t> m_Order {};
+    std::vector<uint32_t> m_TempCodes {};
+    std::vector<uint32_t> m_TempOrder {};
+    std::vector<bool>     m_IsMoved {};  // Particles already at their sorted place while the cycles are followed
+
+    // Average distance between particles that follow each other in memory, before and after the reorder
+    double m_NeighbourDistanceBefore { 0.0 };
+    double m_NeighbourDistanceAfter { 0.0 };
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <vector>
+
+namespace Parallel
+{
+    inline size_t GetChunkCount( size_t count, size_t chunkSize )
+    {
+        return ( count + chunkSize - 1 ) / chunkSize;
+    }
+
+    // Splits [0, count) in contiguous chunks and runs func( chunkIndex, begin, end ) for each chunk in parallel.
+    // The chunk index is stable for a given count and chunk size so it can be used to address per-chunk outputs.
+    template<typename Func>
+    void ForEachChunk( size_t count, size_t chunkSize, Func&& func )
+    {
+        std::vector<size_t> chunks( GetChunkCount( count, chunkSize ) );
+        std::iota( chunks.begin(), chunks.end(), size_t { 0 } );
+
+        std::for_each
+        (
+            std::execution::par,
+            chunks.begin(),
+            chunks.end(),
+            [count, chunkSize, &func]( size_t chunk )
+            {
+                const size_t begin { chunk * chunkSize };
+                func( chunk, begin, std::min( begin + chunkSize, count ) );
+            }
+        );
+    }
+}
@@ -17,7 +17,10 @@ class Particle
 public:
     Particle( Vec3 startPos, float size = 0.1f);
 
-    void Update( float deltaTime, const Camera& camera, bool isAccelerationEnabled, bool isPerpendicularEnabled );
+    void Update( float deltaTime, bool isAccelerationEnabled, bool isPerpendicularEnabled );
+
+    // Render matrices at the interpolation between the two last simulated positions, 1 for the last one.
+    void UpdateMatrices( const Camera& camera, float interpolation );
 
     Mat GetMatrices() const
     {
@@ -28,7 +31,58 @@ public:
         return m_Matrices.ModelViewProjectionMatrix;
     }
 
+    // Position between the two last simulated positions, 1 for the last one.
+    DirectX::XMVECTOR GetInterpolatedPosition( float interpolation ) const;
+
+    // Position the particle is rendered at, set by UpdateMatrices.
+    DirectX::XMVECTOR GetRenderPosition() const
+    {
+        return m_Matrices.ModelMatrix.r[3];
+    }
+
     DirectX::XMFLOAT3 GetPosition() const;
+    void              SetPosition( const DirectX::XMFLOAT3& position );
+    // Position before the last simulation step, the interpolated positions lie between it and the position.
+    DirectX::XMFLOAT3 GetPreviousPosition() const
+    {
+        return m_PreviousPosition;
+    }
+
+    DirectX::XMFLOAT3 GetVelocity() const
+    {
+        return m_Velocity;
+    }
+    void SetVelocity( const DirectX::XMFLOAT3& velocity )
+    {
+        m_Velocity = velocity;
+    }
+
+    // After a collision, removes the part of the motion of the particle going into the surface of the normal,
+    // so the next steps slide along it instead of moving into the collider again.
+    void RemoveInwardMotion( const DirectX::XMFLOAT3& normal );
+
+    float GetSize() const
+    {
+        return m_Size;
+    }
+
+    uint32_t GetId() const
+    {
+        return m_Id;
+    }
+    void SetId( uint32_t id )
+    {
+        m_Id = id;
+    }
+
+    uint64_t GetDeathTick() const
+    {
+        return m_DeathTick;
+    }
+    void SetDeathTick( uint64_t deathTick )
+    {
+        m_DeathTick = deathTick;
+    }
 
 private:
 
@@ -50,6 +104,16 @@ private:
     float m_AccumulatedPerpendicularTime {};
     float m_perpendicularSpeed {};
 
+    //position before the last simulation step, used to render between simulation steps
+    DirectX::XMFLOAT3 m_PreviousPosition {};
+
+    //velocity given by the force fields
+    DirectX::XMFLOAT3 m_Velocity {};
+
+    //stable id, the index in the particle system changes when particles are moved
+    uint32_t m_Id {};
+    uint64_t m_DeathTick {};
+
 
     Mat m_Matrices;
 
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class Camera;
+struct FrustumPlanes;
+class ParticleSystem;
+class Profiler;
+
+// Shares a global particle budget between the registered particle systems. The budget is the lowest of the
+// particle limit, of the particles the CPU time limit allows at the measured cost per particle and of the
+// particles the overdraw limit allows at the measured overdraw per particle (only for the systems estimating
+// their coverage).
+// Every frame the budget is split by weight: a higher priority doubles the weight, distance and being out of
+// view lower it. A system asking for less than its share gives the rest to the others. The allocation is the
+// capacity of the system: above it the system stops spawning and shrinks as its particles expire, and it only
+// grows by a bounded amount every frame so refilling never spikes the frame time.
+class ParticleBudgetManager
+{
+public:
+    struct Budget
+    {
+        size_t MaxParticles;
+        double MaxUpdateMilliseconds;  // summed update time of the systems, 0 for no limit
+        double MaxOverdraw;            // summed average overdraw of the systems on the screen, 0 for no limit
+    };
+
+    struct Allocation
+    {
+        std::string Name;
+        int         Priority;
+        float       Weight;
+        size_t      Requested;
+        size_t      Allocated;
+        size_t      ParticleCount;
+        double      UpdateMilliseconds;
+        double      Overdraw;
+    };
+
+    void SetBudget( const Budget& budget )
+    {
+        m_Budget = budget;
+    }
+
+    void Register( ParticleSystem& system, std::string name, int priority = 0 );
+    void Unregister( const ParticleSystem& system );
+
+    // Must be called before the systems are updated, the cost per particle comes from their last update.
+    void Update( const Camera& camera, Profiler& profiler );
+
+    // One allocation per registered system, in registration order.
+    const std::vector<Allocation>& GetReport() const
+    {
+        return m_Report;
+    }
+
+    size_t GetEffectiveBudget() const
+    {
+        return m_EffectiveBudget;
+    }
+
+private:
+    struct Entry
+    {
+        ParticleSystem* System;
+        std::string     Name;
+        int             Priority;
+    };
+
+    void  UpdateCost();
+    float ComputeWeight( const Entry& entry, const Camera& camera, const FrustumPlanes& view ) const;
+    void  Distribute();
+
+    Budget                  m_Budget { 1000000, 0.0, 0.0 };
+    std::vector<Entry>      m_Entries {};
+    std::vector<Allocation> m_Report {};
+    std::vector<size_t>     m_Pending {};
+
+    size_t m_EffectiveBudget { 0 };
+    double m_MillisecondsPerParticle { 0.0 };  // smoothed over the frames
+    double m_OverdrawPerParticle { 0.0 };      // smoothed over the frames
+
+    static constexpr double m_CostSmoothing { 0.1 };
+    static constexpr float  m_HiddenWeight { 0.25f };
+    static constexpr float  m_ReferenceDistance { 50.0f };  // distance at which the weight is halved
+    static constexpr double m_MaxGrowthPerFrame { 0.05 };   // fraction of the budget a system can gain per frame
+};
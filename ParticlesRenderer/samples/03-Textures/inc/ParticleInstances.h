@@ -0,0 +1,86 @@
+#pragma once
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+class Camera;
+class Particle;
+class Profiler;
+
+// Draws one simulated particle set at many placements, each with its own transform and time offset.
+// Every frame the particles are recorded once in a snapshot, snapshots are kept as long as a placement looks
+// that far back in time, so the simulation and the memory do not grow with the number of placements.
+// Every placement is culled against the camera frustum moved in its own space, first with the bounds of its
+// snapshot and then particle by particle, and its visible particles are packed straight into the render matrices.
+class ParticleInstances
+{
+public:
+    struct Placement
+    {
+        DirectX::XMFLOAT4X4 Transform;
+        float               TimeOffset;  // seconds in the past
+    };
+
+    size_t Add( const Placement& placement );
+    void   Set( size_t index, const Placement& placement );
+    void   Clear();
+
+    bool IsEmpty() const
+    {
+        return m_Placements.empty();
+    }
+    size_t GetCount() const
+    {
+        return m_Placements.size();
+    }
+
+    // Records the simulated particles, then culls and packs every placement.
+    void Update( const std::vector<Particle>& particles, float deltaTime, const Camera& camera, float cullingRadius, Profiler& profiler );
+
+    // Model view projection matrices of the visible particles of every placement, placement after placement.
+    const std::vector<DirectX::XMMATRIX>& GetMatrices() const
+    {
+        return m_Matrices;
+    }
+
+private:
+    struct Snapshot
+    {
+        std::vector<DirectX::XMFLOAT4> Particles;  // position and size
+        DirectX::BoundingBox           Bounds;
+        float                          Age;
+    };
+
+    // Range of the particles of a placement culled and packed as one task
+    struct Task
+    {
+        uint32_t Placement;
+        uint32_t Begin;
+        uint32_t End;
+    };
+
+    struct VisiblePlacement
+    {
+        const Snapshot*   Source;
+        DirectX::XMMATRIX Transform;
+        DirectX::XMFLOAT4 Planes[6];
+        bool              IsCulled;  // false when the placement is entirely inside the frustum
+    };
+
+    void Record( const std::vector<Particle>& particles, float deltaTime );
+    const Snapshot& FindSnapshot( float timeOffset ) const;
+
+    static constexpr size_t m_TaskSize { 4096 };
+    static constexpr size_t m_MaxSnapshots { 256 };
+
+    std::vector<Placement> m_Placements {};
+    std::vector<Snapshot>  m_Snapshots {};
+
+    std::vector<VisiblePlacement>      m_VisiblePlacements {};
+    std::vector<Task>                  m_Tasks {};
+    std::vector<std::vector<uint32_t>> m_TaskVisibleIndices {};
+    std::vector<size_t>                m_TaskOffsets {};
+    std::vector<DirectX::XMMATRIX>     m_Matrices {};
+};
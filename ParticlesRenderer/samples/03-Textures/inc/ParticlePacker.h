@@ -0,0 +1,93 @@
+#pragma once
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+class Particle;
+class Profiler;
+
+// Compact instance format of the packed mesh shader, 8 bytes per particle instead of a 64 byte matrix.
+// Decoding, implemented by ParticlePacker::Decode and shaders/MeshShaderPacked.hlsl:
+//     position = BoundsMin + float3( X, Y, Z ) * BoundsStep
+//     scale    = Size / 255 * MaxScale
+//     life     = Life / 255, remaining fraction of the longest lifetime, 1 for immortal particles
+// Read as a uint2 in the shader: x = X | Y << 16, y = Z | Size << 16 | Life << 24.
+struct PackedParticle
+{
+    uint16_t X;
+    uint16_t Y;
+    uint16_t Z;
+    uint8_t  Size;
+    uint8_t  Life;
+};
+static_assert( sizeof( PackedParticle ) == 8, "the shader reads a packed particle as a uint2" );
+
+// Constant buffer of the packed mesh shader.
+struct PackedParticleHeader
+{
+    DirectX::XMMATRIX ViewProjection;
+    DirectX::XMFLOAT3 BoundsMin;
+    float             MaxScale;
+    DirectX::XMFLOAT3 BoundsStep;  // size of a 16 bit position step on every axis
+    float             Padding;
+};
+
+// Encoding constants of a frame, shared by ParticlePacker and FusedParticleKernel.
+// Every particle scale must be under maxScale. A lifetime of 0 is for immortal particles.
+class PackedParticleEncoder
+{
+public:
+    PackedParticleEncoder() = default;
+    PackedParticleEncoder( float maxScale, const DirectX::BoundingBox& bounds, DirectX::FXMMATRIX viewProjectionMatrix,
+                           uint64_t currentTick, uint64_t maxLifetimeTicks );
+
+    PackedParticle Encode( DirectX::FXMVECTOR position, float scale, uint64_t deathTick ) const;
+
+    const PackedParticleHeader& GetHeader() const
+    {
+        return m_Header;
+    }
+
+private:
+    PackedParticleHeader m_Header {};
+    DirectX::XMVECTOR    m_BoundsMin {};
+    DirectX::XMVECTOR    m_InverseExtent {};
+    float                m_SizeFactor { 0.0f };
+    float                m_LifeFactor { 0.0f };
+    uint64_t             m_CurrentTick { 0 };
+    uint64_t             m_MaxLifetimeTicks { 0 };
+};
+
+// Encodes the drawn particles in the packed format, positions relative to the bounds of the system.
+class ParticlePacker
+{
+public:
+    // Scales are indexed like the particles, nullptr when the particles are not scaled.
+    void Pack( const std::vector<Particle>& particles, const std::vector<uint32_t>& drawList, const float* scales, float maxScale,
+               const DirectX::BoundingBox& bounds, DirectX::FXMMATRIX viewProjectionMatrix, uint64_t currentTick,
+               uint64_t maxLifetimeTicks, Profiler& profiler );
+
+    // Decodes every packed particle and compares it to its particle, the largest error must stay under half a step.
+    void Validate( const std::vector<Particle>& particles, const std::vector<uint32_t>& drawList, const float* scales,
+                   Profiler& profiler ) const;
+
+    // Reference decoder, returns the position and writes the scale.
+    static DirectX::XMVECTOR Decode( const PackedParticle& particle, const PackedParticleHeader& header, float& scale );
+
+    const std::vector<PackedParticle>& GetParticles() const
+    {
+        return m_Particles;
+    }
+    const PackedParticleHeader& GetHeader() const
+    {
+        return m_Encoder.GetHeader();
+    }
+
+private:
+    static constexpr size_t m_ChunkSize { 4096 };
+
+    std::vector<PackedParticle> m_Particles {};
+    PackedParticleEncoder       m_Encoder {};
+};
@@ -1,4 +1,22 @@
 #pragma once
+#include "CoverageEstimator.h"
+#include "DepthSort.h"
+#include "ForceField.h"
+#include "FrustumCulling.h"
+#include "FusedParticleKernel.h"
+#include "InstanceBufferRing.h"
+#include "MortonReorder.h"
+#include "ParticleInstances.h"
+#include "ParticlePacker.h"
+#include "RenderLOD.h"
+#include "RenderQueue.h"
+#include "TimingWheel.h"
+
+#include <DirectXCollision.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
 #include <vector>
 
 
@@ -10,42 +28,306 @@ namespace dx12lib
     class Texture;
 }
 class Particle;
-class SceneVisitor;
 class Camera;
+class Profiler;
+class SignedDistanceField;
+
+// How expired particles are found, the age scan is kept to compare against
+enum class ExpirationMode
+{
+    TimingWheel,
+    AgeScan
+};
 
 class ParticleSystem
 {
 public:
-    ParticleSystem( float particleSize, bool isAccelerationEnabled, bool isPerpendicularEnabled );
+    // A lifetime of 0 makes the particles immortal. Expired particles are replaced by new ones at the emitter.
+    ParticleSystem( float particleSize, bool isAccelerationEnabled, bool isPerpendicularEnabled, float particleLifetime = 0.0f,
+                    ExpirationMode expirationMode = ExpirationMode::TimingWheel );
     ~ParticleSystem();
 
     void Initialize( dx12lib::CommandList& commandList );
 
-    void Update(float deltaTime, const Camera& camera, FPSCounter& fpsCounter, const MemoryCounter& memCounter);
-    void Render( dx12lib::Device& device, dx12lib::CommandList& commandList, SceneVisitor& visitor, const Camera& camera, bool isMeshShader ) const;
+    void Update(float deltaTime, const Camera& camera, FPSCounter& fpsCounter, const MemoryCounter& memCounter, Profiler& profiler);
+    void Render( dx12lib::Device& device, dx12lib::CommandList& commandList, const Camera& camera, bool isMeshShader, Profiler& profiler );
+
+    // The mesh shader path writes its instances in a ring of persistent buffers instead of a new upload buffer
+    // every frame, nullptr to go back to the upload buffers. EndFrame must follow the execution of every frame.
+    void SetInstanceBufferBackend( std::unique_ptr<InstanceBufferBackend> backend )
+    {
+        m_InstanceRing.SetBackend( std::move( backend ) );
+    }
+    void EndFrame()
+    {
+        m_InstanceRing.EndFrame();
+    }
+
+    // The geometry shader path draws the matrices of the visible particles as an instance stream, in draws of
+    // Tuning::InstancesPerDraw instances, instead of one draw per particle. The pipeline must use the instanced shaders.
+    void SetInstancedDrawsEnabled( bool isEnabled )
+    {
+        m_IsUsingInstancedDraws = isEnabled;
+    }
+
+    // Values swept by the autotuner, see Autotuner.h.
+    struct Tuning
+    {
+        size_t   UpdateChunkSize { ForceFieldSet::BatchSize };  // particles per parallel chunk of the update
+        uint32_t ParticlesPerGroup { 64 };                       // MAX_PARTICLES_PER_GROUP of the bound mesh shader
+        size_t   InstancesPerDraw { 1 << 18 };                   // instances per draw of the geometry shader path
+    };
+    void SetTuning( const Tuning& tuning );
+    const Tuning& GetTuning() const
+    {
+        return m_Tuning;
+    }
 
     void AddParticle();
     void AddParticleAmount( int amount );
 
-    
+    // The test doubles the particles at the end of every sample, off to measure at a fixed particle count.
+    void SetSampleGrowthEnabled( bool isEnabled )
+    {
+        m_IsSampleGrowthEnabled = isEnabled;
+    }
+
+    ForceFieldSet& GetForceFields()
+    {
+        return m_ForceFields;
+    }
+
+    // Particles collide with the field and slide along its surface, nullptr to disable.
+    void SetCollider( std::shared_ptr<const SignedDistanceField> collider );
+
+    // Frames between two Morton reorders of the particle storage, 0 to disable.
+    void SetReorderInterval( int frames )
+    {
+        m_Reorder.SetInterval( frames );
+    }
+
+    void SetDepthSortMode( DepthSortMode mode )
+    {
+        m_DepthSort.SetMode( mode );
+    }
+
+    // Only the particles inside the camera frustum are uploaded and drawn.
+    void SetCullingEnabled( bool isEnabled )
+    {
+        m_IsCullingEnabled = isEnabled;
+    }
+
+    // Other views culled in the same sweep as the camera (split-screen, cubemap faces, shadow cascades).
+    // At most ParticleCuller::MaxViews - 1 views are used.
+    void SetAdditionalViews( std::vector<FrustumPlanes> views )
+    {
+        m_AdditionalViews = std::move( views );
+    }
+
+    // View 0 is the camera, the additional views follow.
+    const std::vector<uint32_t>& GetVisibleIndices( size_t view ) const
+    {
+        return view == 0 ? m_DrawList : m_Culler.GetVisibleIndices( view );
+    }
+    const std::vector<uint8_t>& GetVisibilityMasks() const
+    {
+        return m_Culler.GetVisibilityMasks();
+    }
+
+    void SetRenderLOD( const RenderLOD::Settings& settings )
+    {
+        m_RenderLOD.SetSettings( settings );
+    }
+    void SetViewportSize( float width, float height )
+    {
+        m_RenderLOD.SetViewportHeight( height );
+        m_Coverage.SetViewportSize( width, height );
+    }
+
+    // Estimates the screen coverage and overdraw of the drawn particles every update.
+    void SetCoverageEnabled( bool isEnabled )
+    {
+        m_IsCoverageEnabled = isEnabled;
+    }
+    const CoverageEstimator& GetCoverage() const
+    {
+        return m_Coverage;
+    }
+
+    // Frames between two computations of the bounds, the bounds are grown in between to stay conservative.
+    void SetBoundsInterval( int frames )
+    {
+        m_BoundsInterval = std::max( frames, 1 );
+    }
+
+    // Called by the simulation scheduler before Update: the system simulates every period frames and only
+    // updates its render matrices on the other frames.
+    void ScheduleSimulation( uint32_t period, bool isSimulationFrame )
+    {
+        m_SimulationPeriod  = std::max( period, 1u );
+        m_IsSimulationFrame = isSimulationFrame;
+    }
+
+    size_t GetParticleCount() const
+    {
+        return m_Particles.size();
+    }
+
+    // Particles the test asked for, the system holds fewer when its capacity is lower.
+    size_t GetRequestedParticleCount() const
+    {
+        return m_RequestedParticleCount;
+    }
+
+    // Set by the budget manager before Update. Above its capacity the system stops spawning and shrinks as
+    // its particles expire, under it the missing particles are spawned again.
+    void SetParticleCapacity( size_t capacity )
+    {
+        m_ParticleCapacity = capacity;
+    }
+
+    // CPU time of the last Update.
+    double GetLastUpdateMilliseconds() const
+    {
+        return m_LastUpdateMilliseconds;
+    }
+
+    // The mesh shader path uploads the particles in the packed format instead of matrices, the pipeline
+    // must use the packed mesh shader. Instanced systems keep uploading matrices.
+    void SetPackingEnabled( bool isEnabled, bool isValidating = false )
+    {
+        m_IsPacking           = isEnabled;
+        m_IsValidatingPacking = isValidating;
+    }
+
+    // Packed particles are culled and encoded in the update chunks themselves, without render matrices or draw
+    // list. Only used while the draw list has nothing else to do: no render LOD, depth sort, placements,
+    // additional views or coverage, the regular packing is used otherwise.
+    void SetFusedKernelEnabled( bool isEnabled )
+    {
+        m_IsFusedKernelEnabled = isEnabled;
+    }
+
+    // With placements the particles are drawn once per placement instead of at the emitter, the simulation
+    // is shared by all the placements. The camera culling, render LOD and depth sort of the system are skipped.
+    size_t AddInstance( const DirectX::XMFLOAT4X4& transform, float timeOffset = 0.0f )
+    {
+        return m_Instances.Add( ParticleInstances::Placement { transform, timeOffset } );
+    }
+    void ClearInstances()
+    {
+        m_Instances.Clear();
+    }
+
+    // Conservative bounds of the particles and of the emitter.
+    DirectX::BoundingBox    GetBounds() const;
+    DirectX::BoundingSphere GetBoundingSphere() const;
 
 private:
 
     std::vector<DirectX::XMFLOAT3> GetAllPos() const;
+    size_t GetDrawCount() const;
     std::vector<DirectX::XMMATRIX> GetAllMatrices() const;
+    DirectX::XMMATRIX GetRenderMatrix( uint32_t index ) const;
+
+    void CollideParticles( size_t begin, size_t end );
+
+    void ExpireParticles( float deltaTime, Profiler& profiler );
+    void PackDrawList( const Camera& camera, Profiler& profiler );
+    bool IsUsingFusedKernel() const;
+    uint64_t GetMaxLifetimeTicks() const;
+    void SpawnParticles( Profiler& profiler );
+    void RemoveParticle( uint32_t id );
+    void UpdateParticleIndices();
+    void UpdateDrawList( DirectX::ContainmentType systemVisibility, const Camera& camera, Profiler& profiler );
+    DirectX::ContainmentType GetSystemVisibility( const Camera& camera );
+    void ComputeChunkBounds( size_t chunk, size_t begin, size_t end );
+    void ReduceBounds();
+    float GetCullingRadius() const;
 
-    void TraditionalRender( dx12lib::CommandList& commandList, SceneVisitor& visitor, const Camera& camera ) const;
-    void MeshShaderRender( dx12lib::Device& device, dx12lib::CommandList& commandList) const;
+    void TraditionalRender( dx12lib::Device& device, dx12lib::CommandList& commandList, const Camera& camera, Profiler& profiler );
+    void MeshShaderRender( dx12lib::Device& device, dx12lib::CommandList& commandList );
+    void BindInstanceStream( dx12lib::Device& device, dx12lib::CommandList& commandList, const void* data, size_t dataSize );
 
     Vec3 m_Pos { 0, 3, 0 };
     std::vector<Particle> m_Particles;
 
+    ForceFieldSet m_ForceFields {};
+    Tuning        m_Tuning {};
+
+    std::shared_ptr<const SignedDistanceField> m_Collider {};
+    static constexpr float                     m_CollisionBounce { 0.0f };
+    static constexpr float                     m_CollisionFriction { 0.1f };
+
+    MortonReorder m_Reorder {};
+
+    //expiration
+    float                 m_ParticleLifetime;
+    ExpirationMode        m_ExpirationMode;
+    TimingWheel           m_ExpirationWheel {};
+    uint64_t              m_CurrentTick { 0 };
+    float                 m_AccumulatedTickTime { 0.0f };
+    std::vector<uint32_t> m_ExpiredIds {};
+    static constexpr float m_TickDuration { 1.0f / 60.0f };
+
+    //budget
+    size_t m_RequestedParticleCount { 0 };
+    size_t m_ParticleCapacity { std::numeric_limits<size_t>::max() };
+    double m_LastUpdateMilliseconds { 0.0 };
+
+    //particle slots, ids of removed particles are reused by the next added particles
+    std::vector<uint32_t> m_ParticleIndices {};  // index in m_Particles of every id
+    std::vector<uint32_t> m_FreeIds {};
+
+    //indices of the particles to draw, in drawing order
+    std::vector<uint32_t> m_DrawList {};
+    ParticleCuller             m_Culler {};
+    bool                       m_IsCullingEnabled { false };
+    std::vector<FrustumPlanes> m_AdditionalViews {};
+    std::vector<FrustumPlanes> m_CullingViews {};
+
+    //simulation rate
+    uint32_t m_SimulationPeriod { 1 };
+    bool     m_IsSimulationFrame { true };
+    uint32_t m_FramesSinceSimulation { 0 };
+    float    m_AccumulatedSimulationTime { 0.0f };
+
+    //bounds
+    DirectX::BoundingBox           m_Bounds {};
+    bool                           m_HasBounds { false };
+    int                            m_BoundsInterval { 1 };
+    int                            m_FramesSinceBounds { 0 };
+    uint32_t                       m_SimulatedFramesSinceBounds { 0 };  // frames of simulated time since the bounds
+    uint32_t                       m_LastStepFrames { 1 };              // frames of simulated time of the last step
+    float                          m_BoundsGrowthPerFrame { 0.0f };     // per frame of simulated time
+    std::vector<DirectX::XMFLOAT3> m_ChunkBoundsMin {};
+    std::vector<DirectX::XMFLOAT3> m_ChunkBoundsMax {};
+    DepthSort             m_DepthSort {};
+    RenderLOD             m_RenderLOD {};
+    std::vector<float>    m_RenderScales {};
+    CoverageEstimator     m_Coverage {};
+    ParticleInstances     m_Instances {};
+    ParticlePacker        m_Packer {};
+    bool                  m_IsPacking { false };
+    bool                  m_IsValidatingPacking { false };
+    float                 m_MaxParticleSize { 0.0f };
+    bool                  m_IsCoverageEnabled { false };
+    InstanceBufferRing       m_InstanceRing {};
+    FusedParticleKernel      m_FusedKernel {};
+    HostPackedParticleTarget m_FusedTarget {};
+    RingPackedParticleTarget m_FusedRingTarget { m_InstanceRing };
+    bool                     m_IsUsingInstancedDraws { false };
+    bool                     m_IsFusedKernelEnabled { false };
+    bool                     m_IsFusedFrame { false };  // the records of the last update come from the fused kernel
+    RenderQueue              m_RenderQueue {};
+
 
     std::shared_ptr<dx12lib::Scene>   m_Plane;
     std::shared_ptr<dx12lib::Texture> m_DefaultTexture;
 
     float accumulatedTime{0};
     float intervalTime = 10.0f;
+    bool  m_IsSampleGrowthEnabled { true };
 
     float m_ParticlesSize;
     bool  m_IsAccelerationEnabled;
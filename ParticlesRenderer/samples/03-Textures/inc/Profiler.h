@@ -0,0 +1,55 @@
+#pragma once
+#include <chrono>
+#include <map>
+#include <string>
+
+// Accumulates named CPU timings and counters per frame and writes their
+// per-frame averages to a log file every time a test sample ends.
+class Profiler
+{
+public:
+    Profiler();
+
+    void AddTime( const std::string& name, double milliseconds );
+    void AddCount( const std::string& name, double value );
+    // Written as is instead of averaged over the frames of the sample, the last value wins.
+    void SetValue( const std::string& name, double value );
+
+    void EndFrame();
+    void WriteSample( int sampleCount );
+
+private:
+    enum class EntryType
+    {
+        Time,
+        Count,
+        Value
+    };
+
+    struct Entry
+    {
+        double    Total { 0.0 };
+        EntryType Type { EntryType::Time };
+    };
+
+    std::map<std::string, Entry> m_Entries {};
+    int                          m_FramesThisSample { 0 };
+
+    std::string m_FileLocation { "logProfiler.txt" };
+};
+
+// Adds the time spent between construction and destruction to the profiler.
+class ScopedTimer
+{
+public:
+    ScopedTimer( Profiler& profiler, const char* name );
+    ~ScopedTimer();
+
+    ScopedTimer( const ScopedTimer& )            = delete;
+    ScopedTimer& operator=( const ScopedTimer& ) = delete;
+
+private:
+    Profiler&                                      m_Profiler;
+    const char*                                    m_Name;
+    std::chrono::high_resolution_clock::time_point m_Start;
+};
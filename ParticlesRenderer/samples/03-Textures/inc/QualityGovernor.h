@@ -0,0 +1,74 @@
+#pragma once
+#include "DepthSort.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Profiler;
+
+// Steers the quality knobs toward a target CPU frame time.
+// The frame time is measured as a high percentile over a window of frames, smoothed from window to window, so
+// single spikes are ignored but a steady share of slow frames is not. The quality moves one level at a time:
+// down when the measure is above the target plus the hysteresis, up when it is below the target minus the
+// hysteresis. Every change is followed by a cooldown so the next decision measures its effect, and a level
+// that had to be left right after going up to it waits twice as long before being tried again.
+// Every decision is appended to a log file, started by the first Update.
+class QualityGovernor
+{
+public:
+    struct Settings
+    {
+        double   TargetFrameMilliseconds;
+        double   Percentile;      // 0.9 for the 90th percentile
+        double   Hysteresis;      // fraction of the target
+        uint32_t WindowFrames;    // frames per percentile measure
+        uint32_t CooldownFrames;  // frames after a change before the next decision
+    };
+
+    // The values of the knobs at a quality level.
+    struct Knobs
+    {
+        double        BudgetScale;  // fraction of the particle budget
+        bool          IsSimulationLODEnabled;
+        uint32_t      SimulationLODBias;
+        bool          IsRenderLODEnabled;
+        float         RenderLODMinPixelSize;
+        DepthSortMode SortMode;
+    };
+
+    explicit QualityGovernor( const Settings& settings );
+
+    // Returns true when the quality level changed, the new knobs are then to be applied.
+    bool Update( double frameMilliseconds, Profiler& profiler );
+
+    const Knobs& GetKnobs() const;
+    uint32_t     GetLevel() const
+    {
+        return m_Level;
+    }
+
+private:
+    void   StartLog() const;
+    double MeasurePercentile();
+    void   ChangeLevel( uint32_t level, const char* reason );
+
+    Settings m_Settings;
+
+    std::vector<double> m_Window {};
+    std::vector<double> m_Sorted {};
+    size_t              m_WindowCursor { 0 };
+    double              m_SmoothedMilliseconds { 0.0 };
+    bool                m_HasMeasure { false };
+
+    uint32_t              m_Level { 0 };
+    uint64_t              m_Frame { 0 };
+    uint64_t              m_LastChangeFrame { 0 };
+    bool                  m_IsLastChangeRaise { false };
+    std::vector<uint32_t> m_RaiseCooldowns {};  // per level, frames before going up to it again
+
+    static constexpr double   m_Smoothing { 0.5 };
+    static constexpr uint32_t m_MaxCooldownScale { 16 };
+
+    std::string m_FileLocation { "logGovernor.txt" };
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include "ParallelFor.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Parallel
+{
+    // Stable LSD radix sort of keys and their values, 8 bits per pass over the lowest keyBits bits.
+    // Every pass counts the digits of each chunk in parallel, turns the counts into per-chunk offsets
+    // and scatters each chunk to its own offsets in parallel. The temp vectors are reused between calls.
+    template<typename Key, typename Value>
+    void RadixSort( std::vector<Key>& keys, std::vector<Value>& values, std::vector<Key>& tempKeys,
+                    std::vector<Value>& tempValues, uint32_t keyBits = sizeof( Key ) * 8, size_t chunkSize = 16384 )
+    {
+        constexpr size_t radix { 256 };
+
+        const size_t count { keys.size() };
+        const size_t chunkCount { GetChunkCount( count, chunkSize ) };
+        tempKeys.resize( count );
+        tempValues.resize( count );
+
+        std::vector<size_t> offsets( chunkCount * radix );
+        for ( uint32_t shift { 0 }; shift < keyBits; shift += 8 )
+        {
+            std::fill( offsets.begin(), offsets.end(), size_t { 0 } );
+            ForEachChunk( count, chunkSize, [&keys, &offsets, shift]( size_t chunk, size_t begin, size_t end ) {
+                size_t* histogram { offsets.data() + chunk * radix };
+                for ( size_t i { begin }; i < end; ++i )
+                {
+                    ++histogram[( keys[i] >> shift ) & 0xFF];
+                }
+            } );
+
+            // A pass where every key has the same digit would not move anything
+            bool isSingleDigit { false };
+            for ( size_t digit { 0 }; digit < radix && !isSingleDigit; ++digit )
+            {
+                size_t digitCount { 0 };
+                for ( size_t chunk { 0 }; chunk < chunkCount; ++chunk )
+                {
+                    digitCount += offsets[chunk * radix + digit];
+                }
+                isSingleDigit = digitCount == count;
+            }
+            if ( isSingleDigit ) continue;
+
+            // Digit major so equal digits keep the order of their chunks
+            size_t offset { 0 };
+            for ( size_t digit { 0 }; digit < radix; ++digit )
+            {
+                for ( size_t chunk { 0 }; chunk < chunkCount; ++chunk )
+                {
+                    const size_t digitCount { offsets[chunk * radix + digit] };
+                    offsets[chunk * radix + digit] = offset;
+                    offset += digitCount;
+                }
+            }
+
+            ForEachChunk( count, chunkSize, [&]( size_t chunk, size_t begin, size_t end ) {
+                size_t* chunkOffsets { offsets.data() + chunk * radix };
+                for ( size_t i { begin }; i < end; ++i )
+                {
+                    const size_t destination { chunkOffsets[( keys[i] >> shift ) & 0xFF]++ };
+                    tempKeys[destination]   = keys[i];
+                    tempValues[destination] = values[i];
+                }
+            } );
+
+            keys.swap( tempKeys );
+            values.swap( tempValues );
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class Camera;
+class Particle;
+class Profiler;
+
+// Drops distant particles from the draw list and scales up the ones that are kept so the covered area stays
+// the same. A particle smaller than MinPixelSize on screen is kept with a probability of (size / MinPixelSize)^2
+// and drawn MinPixelSize / size times bigger. The choice comes from a hash of the particle id, so the kept
+// particles are the same from frame to frame and a particle kept at some distance is also kept when closer.
+class RenderLOD
+{
+public:
+    struct Settings
+    {
+        bool  IsEnabled;
+        float MinPixelSize;
+        float MaxScale;  // Particles are never scaled more than this, which bounds how many are dropped
+    };
+
+    void SetSettings( const Settings& settings )
+    {
+        m_Settings = settings;
+    }
+    bool IsEnabled() const
+    {
+        return m_Settings.IsEnabled;
+    }
+    // Largest scale given to a particle.
+    float GetMaxScale() const
+    {
+        return m_Settings.IsEnabled ? m_Settings.MaxScale : 1.0f;
+    }
+    void SetViewportHeight( float height )
+    {
+        m_ViewportHeight = height;
+    }
+
+    // Removes the dropped particles from the draw list and writes the render scale of every kept particle,
+    // scales are indexed like the particles and only written when the LOD is enabled.
+    void Apply( const std::vector<Particle>& particles, const Camera& camera, float particleSize,
+                std::vector<uint32_t>& drawList, std::vector<float>& scales, Profiler& profiler );
+
+private:
+    static constexpr size_t m_ChunkSize { 4096 };
+
+    Settings m_Settings { false, 2.0f, 4.0f };
+    float    m_ViewportHeight { 720.0f };
+
+    std::vector<std::vector<uint32_t>> m_ChunkKept {};
+    std::vector<size_t>                m_ChunkOffsets {};
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace dx12lib
+{
+    class CommandList;
+    class Material;
+    class Mesh;
+    class PipelineStateObject;
+}
+
+// Passes of the render queue, in drawing order.
+enum class RenderPass : uint8_t
+{
+    Opaque,      // grouped by state, front to back inside a group
+    Transparent  // back to front, the state only orders the draws at the same depth
+};
+
+// The draws of a frame as 64-bit sort keys and compact payloads. Traversal only emits the draws, Sort orders them
+// with a parallel radix sort by pass, pipeline state, material, mesh and depth, and Submit records them in that
+// order so the state only changes between groups of draws.
+// Submit records any range of the sorted draws and every range binds the state of its first draw, so the ranges of
+// Split can be recorded on several command lists in parallel.
+class RenderQueue
+{
+public:
+    // Bits of the key fields, from the most significant: pass, pipeline, material, mesh and depth.
+    // The transparent pass moves the depth, reversed, right after the pass.
+    static constexpr uint32_t PassBits { 4 };
+    static constexpr uint32_t PipelineBits { 10 };
+    static constexpr uint32_t MaterialBits { 12 };
+    static constexpr uint32_t MeshBits { 14 };
+    static constexpr uint32_t DepthBits { 24 };
+    static_assert( PassBits + PipelineBits + MaterialBits + MeshBits + DepthBits == 64, "The fields fill the key" );
+
+    static constexpr uint32_t NoTransform { UINT32_MAX };
+
+    struct Draw
+    {
+        dx12lib::Mesh* Mesh;
+        uint32_t       Pipeline;       // id of AddPipeline, 0 keeps the bound pipeline state
+        uint32_t       Material;       // id of AddMaterial, 0 keeps the bound material
+        uint32_t       Transform;      // index of AddTransform, NoTransform when an instance stream holds them
+        uint32_t       InstanceCount;
+    };
+
+    // Root parameters the payloads are bound to.
+    struct Bindings
+    {
+        uint32_t TransformRootParameterIndex;
+        uint32_t MaterialRootParameterIndex;
+    };
+
+    struct Range
+    {
+        size_t Begin;
+        size_t End;
+    };
+
+    // Forgets the draws of the previous frame, keeps the memory.
+    void Clear();
+
+    // Ids of the state of the draws, in order of first use in the frame. 0 for nullptr.
+    uint32_t AddPipeline( const std::shared_ptr<dx12lib::PipelineStateObject>& pipeline );
+    uint32_t AddMaterial( const std::shared_ptr<dx12lib::Material>& material );
+    uint32_t AddTransform( const DirectX::XMMATRIX& transform );
+
+    // The depth is the view depth of the draw, only its order matters.
+    void Emit( RenderPass pass, const Draw& draw, float depth );
+
+    void Sort();
+
+    // Contiguous ranges of about the same amount of sorted draws, at most rangeCount.
+    std::vector<Range> Split( size_t rangeCount ) const;
+
+    void Submit( dx12lib::CommandList& commandList, const Bindings& bindings ) const
+    {
+        Submit( commandList, bindings, Range { 0, m_Order.size() } );
+    }
+    void Submit( dx12lib::CommandList& commandList, const Bindings& bindings, const Range& range ) const;
+
+    size_t GetDrawCount() const
+    {
+        return m_Draws.size();
+    }
+    // The draws in submission order once sorted, in emission order before.
+    const Draw& GetDraw( size_t index ) const
+    {
+        return m_Draws[m_Order[index]];
+    }
+    uint64_t GetKey( size_t index ) const
+    {
+        return m_Keys[index];
+    }
+
+    static uint64_t MakeSortKey( RenderPass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth );
+
+private:
+    uint32_t GetMeshId( const dx12lib::Mesh* mesh );
+
+    std::vector<Draw>              m_Draws {};
+    std::vector<uint64_t>          m_Keys {};   // key of every draw, sorted with the order
+    std::vector<uint32_t>          m_Order {};  // index in m_Draws of every key
+    std::vector<uint64_t>          m_TempKeys {};
+    std::vector<uint32_t>          m_TempOrder {};
+    std::vector<DirectX::XMMATRIX> m_Transforms {};
+
+    std::vector<std::shared_ptr<dx12lib::PipelineStateObject>> m_Pipelines {};
+    std::vector<std::shared_ptr<dx12lib::Material>>            m_Materials {};
+    std::unordered_map<const void*, uint32_t>                  m_StateIds {};  // pipelines, materials and meshes
+    uint32_t                                                   m_MeshCount { 0 };
+
+    // Consecutive draws mostly share their mesh and material, the last ids skip the map
+    const void* m_LastMesh { nullptr };
+    uint32_t    m_LastMeshId { 0 };
+    const void* m_LastMaterial { nullptr };
+    uint32_t    m_LastMaterialId { 0 };
+};
@@ -29,13 +29,21 @@
  *
  *  @brief A scene visitor is used to render the meshes in a scene. It uses the Visitor design pattern to iterate the 
  * nodes of a scene.
+ * The visitor does not draw: it emits a draw of every mesh to a RenderQueue, which sorts the draws and records them.
  */
 
+#include "RenderQueue.h"
+
 #include <dx12lib/Visitor.h>
 
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <memory>
+
 namespace dx12lib
 {
-class CommandList;
+class PipelineStateObject;
 }
 
 class SceneVisitor : public dx12lib::Visitor
@@ -43,17 +51,38 @@ class SceneVisitor : public dx12lib::Visitor
 public:
     /**
      * Constructor for the SceneVisitor.
-     * @param commandList The CommandList that is used to render the meshes in the scene.
+     * @param renderQueue The RenderQueue that receives the draws of the meshes in the scene.
+     * @param pass The pass of the draws.
+     * @param instanceCount The number of instances every mesh is drawn with.
+     */
+    SceneVisitor( RenderQueue& renderQueue, RenderPass pass = RenderPass::Opaque, uint32_t instanceCount = 1 );
+
+    /**
+     * The transform the scene is placed with and the view depth of the placement, the draws of the next visits
+     * have their own transform. The transform is bound as is and is often a world transform, so the view depth
+     * of the draws cannot be taken from it: every mesh of the placement is sorted at viewDepth.
+     */
+    void SetTransform( const DirectX::XMMATRIX& transform, float viewDepth );
+
+    /**
+     * The pipeline state the next meshes are drawn with, nullptr keeps the bound pipeline state.
      */
-    SceneVisitor( dx12lib::CommandList& commandList );
+    void SetPipeline( const std::shared_ptr<dx12lib::PipelineStateObject>& pipeline );
 
     // For this sample, we don't need to do anything when visiting the Scene.
     virtual void Visit( dx12lib::Scene& scene ) override {}
-    // For this sample, we don't need to do anything when visiting the SceneNode.
-    virtual void Visit( dx12lib::SceneNode& sceneNode ) override {}
-    // When visiting a mesh, the mesh must be rendered.
+    // The meshes of a node are visited after the node, they are placed with its transform.
+    virtual void Visit( dx12lib::SceneNode& sceneNode ) override;
+    // When visiting a mesh, the draw of the mesh is emitted.
     virtual void Visit( dx12lib::Mesh& mesh ) override;
 
 private:
-    dx12lib::CommandList& m_CommandList;
+    RenderQueue&        m_RenderQueue;
+    RenderPass          m_Pass;
+    uint32_t            m_InstanceCount;
+    uint32_t            m_Pipeline { 0 };
+    bool                m_HasTransform { false };
+    float               m_ViewDepth { 0.0f };
+    DirectX::XMFLOAT4X4 m_Transform {};
+    DirectX::XMFLOAT4X4 m_NodeTransform {};
 };
\ No newline at end of file
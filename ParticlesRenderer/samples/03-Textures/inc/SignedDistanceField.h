@@ -0,0 +1,82 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dx12lib
+{
+    class Scene;
+}
+
+// Sparse signed distance field of the meshes of a scene, in world space.
+// The volume is split in bricks of BrickSize^3 cells. Only the bricks close to the surface store their
+// (BrickSize + 1)^3 corner distances, the other bricks only keep the distance at their center.
+class SignedDistanceField
+{
+public:
+    static constexpr uint32_t BrickSize { 8 };
+    static constexpr uint32_t BrickSamples { BrickSize + 1 };
+
+    struct BakeSettings
+    {
+        float        VoxelSize;
+        float        Band;     // Bricks further away from the surface than this are not stored.
+        float        Padding;  // Added around the bounds of the geometry.
+        std::wstring CacheDirectory;
+    };
+
+    // Bakes the field of every triangle mesh in the scene. The result is cached in the cache directory,
+    // keyed by a hash of the geometry and the settings, so baking the same scene again only loads the file.
+    // The scene must be loaded with keepCollisionGeometry, the meshes without a CPU copy are skipped.
+    static std::shared_ptr<SignedDistanceField> Bake( dx12lib::Scene& scene, const BakeSettings& settings );
+
+    float             GetDistance( const DirectX::XMFLOAT3& position ) const;
+    DirectX::XMFLOAT3 GetNormal( const DirectX::XMFLOAT3& position ) const;
+
+    // Pushes a sphere out of the geometry and removes the part of the velocity going into the surface,
+    // so the sphere slides along it. Returns true if there was a contact, and its surface normal if asked.
+    bool Collide( DirectX::XMFLOAT3& position, DirectX::XMFLOAT3& velocity, float radius, float bounce,
+                  float friction, DirectX::XMFLOAT3* contactNormal = nullptr ) const;
+
+    size_t GetStoredBrickCount() const
+    {
+        return m_Samples.size() / ( BrickSamples * BrickSamples * BrickSamples );
+    }
+
+private:
+    struct Header
+    {
+        char     Magic[4];
+        uint32_t Version;
+        uint32_t BrickSize;
+        uint32_t Bricks[3];
+        float    Origin[3];
+        float    VoxelSize;
+        uint32_t StoredBricks;
+    };
+
+    static constexpr char     m_Magic[4] { 'S', 'D', 'F', '1' };
+    static constexpr uint32_t m_Version { 1 };
+
+    // Triangles are given as 3 consecutive positions.
+    void Build( const std::vector<DirectX::XMFLOAT3>& triangles, const BakeSettings& settings );
+
+    bool Load( const std::wstring& fileName );
+    bool Save( const std::wstring& fileName ) const;
+
+    size_t GetBrickIndex( uint32_t x, uint32_t y, uint32_t z ) const
+    {
+        return ( static_cast<size_t>( z ) * m_Bricks[1] + y ) * m_Bricks[0] + x;
+    }
+
+    DirectX::XMFLOAT3 m_Origin {};
+    float             m_VoxelSize { 1.0f };
+    uint32_t          m_Bricks[3] {};
+
+    std::vector<int32_t> m_BrickSlots {};      // -1 when the brick is not stored
+    std::vector<float>   m_BrickDistances {};  // Distance at the center of every brick
+    std::vector<float>   m_Samples {};
+};
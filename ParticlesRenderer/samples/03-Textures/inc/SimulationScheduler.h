@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class Camera;
+class ParticleSystem;
+class Profiler;
+
+// Chooses the simulation rate of every registered particle system each frame: full rate, 1/2, 1/4 or 1/8
+// depending on the size of the system on screen, its visibility and its priority.
+// Systems running at the same rate are given different phases so their simulation frames are staggered and
+// the simulation cost stays flat from frame to frame.
+class SimulationScheduler
+{
+public:
+    static constexpr uint32_t MaxLevel { 3 };
+
+    // A higher priority keeps the system at a higher rate, one level per priority point.
+    void Register( ParticleSystem& system, int priority = 0 );
+    void Unregister( const ParticleSystem& system );
+    bool IsRegistered( const ParticleSystem& system ) const;
+
+    // Levels added to every system, used to lower the simulation rates when the frame time is too high.
+    void SetLevelBias( uint32_t bias )
+    {
+        m_LevelBias = bias;
+    }
+
+    // Must be called before the systems are updated.
+    void Update( const Camera& camera, Profiler& profiler );
+
+private:
+    struct Entry
+    {
+        ParticleSystem* System;
+        int             Priority;
+    };
+
+    uint32_t ComputeLevel( const Entry& entry, const Camera& camera ) const;
+
+    // Projected diameter of the bounding sphere over the screen height under which a system drops one more level
+    static constexpr float m_LevelScreenSizes[MaxLevel] { 0.25f, 0.1f, 0.03f };
+
+    std::vector<Entry> m_Entries {};
+    uint64_t           m_Frame { 0 };
+    uint32_t           m_LevelBias { 0 };
+};
@@ -3,27 +3,29 @@
 #include "Mat.h"
 #include "MemoryCounter.h"
 #include "FPSCounter.h"
+#include "Profiler.h"
 
 #include <Camera.h>
 
 #include <GameFramework/Events.h>
 #include <GameFramework/GameFramework.h>
 
+#include <dx12lib/CommandStream.h>
 #include <dx12lib/RenderTarget.h>
 
 #include <cstdint>  // For uint32_t
+#include <map>
 #include <memory>   // For std::unique_ptr and std::smart_ptr
 #include <string>   // For std::wstring
 
+#include<Autotuner.h>
+#include<ParticleBudget.h>
 #include<ParticleSystem.h>
+#include<QualityGovernor.h>
+#include<SimulationScheduler.h>
 
 #include <d3dx12.h>  // For CD3DX12_ROOT_PARAMETER1 and related utilities
 
-namespace Math
-{
-void XM_CALLCONV ComputeMatrices( const DirectX::FXMMATRIX& model, DirectX::CXMMATRIX view, DirectX::CXMMATRIX viewProjection, Mat& mat );
-}
-
 enum RootParameters
 {
     MatricesCB,         // ConstantBuffer<Mat> MatCB : register(b0);
@@ -31,6 +33,9 @@ enum RootParameters
     Textures,           // Texture2D DiffuseTexture : register( t2 );
     FOVSizeAndNBParticles,        //(b1)
     MatricesSRV,
+    PackedParticlesCB,  // ConstantBuffer<PackedHeader> : register( b2 ), packed mesh shader only
+    InstanceOffset,     // uint InstanceOffset : register( b3 ), instanced vertex shader only
+    MeshDispatchCB,     // MeshDispatchConstants : register( b4 ), mesh shaders only
     NumRootParameters
 };
 
@@ -88,6 +93,15 @@ private:
 
     void UpdateCamera(float deltaTime);
     void InitializeColors();
+    void InitializeForceFields();
+    void InitializeCollider();
+    void InitializeInstances();
+    void ApplyGovernorKnobs();
+    void ApplyQuality();
+    void InitializeTuning();
+    void UpdateAutotuning( double frameMilliseconds );
+    void ApplyTuning( const Autotuner::Configuration& configuration );
+    void EndCommandCapture();
 
     void CreateRootSignature( const D3D12_SHADER_VISIBILITY& matricesVisibility,
                               const D3D12_SHADER_VISIBILITY& fovSizeParticlesVisibility,
@@ -109,6 +123,8 @@ private:
 
     // Pipeline state object.
     std::shared_ptr<dx12lib::PipelineStateObject> m_PipelineState;
+    // Mesh shader pipeline of every group size, the tuning picks one.
+    std::map<uint32_t, std::shared_ptr<dx12lib::PipelineStateObject>> m_GroupSizePipelineStates;
 
     D3D12_VIEWPORT m_Viewport;
     D3D12_RECT     m_ScissorRect;
@@ -145,12 +161,49 @@ private:
 
     //test parameters
     static constexpr bool m_IsUsingMeshShaders { true };
+    static constexpr bool m_IsUsingPackedParticles { false };  // 8 byte particles instead of matrices, mesh shaders only
+    static constexpr bool m_IsValidatingPackedParticles { false };
+    static constexpr bool m_IsUsingFusedKernel { false };  // packed particles written by the update itself
+    static constexpr bool m_IsUsingInstanceBufferRing { true };  // persistent instance buffers instead of one upload buffer per frame
+    static constexpr bool m_IsUsingInstancedDraws { true };  // geometry shader path, a few instanced draws instead of one draw per particle
     static constexpr float m_ParticlesSize { 0.5f };
     static constexpr bool  m_IsAccelerationEnabled { false };
     static constexpr bool  m_IsPerpendicularEnabled { false };
+    static constexpr bool  m_IsForceFieldsEnabled { false };
+    static constexpr const wchar_t* m_VectorFieldFile { L"" };  // .vfb or .fga, empty to disable
+    static constexpr float m_ParticleLifetime { 0.0f };  // seconds, 0 for immortal particles
+    static constexpr ExpirationMode m_ExpirationMode { ExpirationMode::TimingWheel };
+    static constexpr bool  m_IsCullingEnabled { true };
+    static constexpr bool  m_IsBudgetEnabled { false };
+    static constexpr bool  m_IsCoverageEnabled { false };  // screen coverage estimate, needed by the overdraw budget
+    static constexpr ParticleBudgetManager::Budget m_ParticleBudgetLimit { 2000000, 8.0, 8.0 };  // particles, update milliseconds, overdraw
+    static constexpr int   m_BoundsInterval { 1 };  // frames between two computations of the particle system bounds
+    static constexpr bool  m_IsQualityGovernorEnabled { false };
+    static constexpr QualityGovernor::Settings m_GovernorSettings { 16.6, 0.9, 0.1, 30, 60 };  // target ms, percentile, hysteresis, window, cooldown
+    static constexpr int   m_ReorderInterval { 0 };   // frames between Morton reorders of the particles, 0 to disable
+    static constexpr const wchar_t* m_ColliderSceneFile { L"" };  // scene the particles collide with, empty to disable
+    static constexpr int   m_InstanceGridSize { 0 };  // n x n placements sharing the simulation, 0 to draw the system once
+    static constexpr float m_InstanceSpacing { 8.0f };
+    static constexpr float m_InstanceTimeOffset { 0.5f };  // seconds between two neighbouring placements
+    static constexpr bool  m_IsAutotuning { false };  // sweeps the tuning parameters at a fixed particle count, saves the fastest ones and quits
+    static constexpr int   m_AutotuneParticleCount { 1000000 };
+    static constexpr uint32_t m_AutotuneTrialFrames { 30 };  // frames averaged per trial
+    static constexpr uint32_t m_AutotuneSettleFrames { 5 };  // frames ignored after every change of configuration
+    static constexpr Autotuner::Settings m_AutotuneSettings { 2, 10, 0.05, 0.02 };  // warmup rounds, rounds, significance, min improvement
+    static constexpr const char* m_TuningFile { "autotune.cfg" };  // loaded at startup when it was tuned on this machine
+    static constexpr uint32_t m_CommandCaptureFrames { 0 };  // frames of commands saved to commands.dxcs and replayed on the null backend, 0 to disable
+    static_assert( !m_IsUsingPackedParticles || m_InstanceGridSize == 0, "instanced systems upload matrices" );
+    static_assert( !m_IsUsingFusedKernel || m_IsUsingPackedParticles, "the fused kernel writes packed particles" );
+
+    //quality parameters, start at these values and are changed at runtime by the quality governor
+    bool  m_IsSimulationLODEnabled { false };
+    uint32_t m_SimulationLODBias { 0 };
+    ParticleBudgetManager::Budget m_ParticleBudget { m_ParticleBudgetLimit };
+    RenderLOD::Settings m_RenderLODSettings { false, 2.0f, 4.0f };  // enabled, min pixel size, max scale
+    DepthSortMode m_DepthSortMode { DepthSortMode::Off };
 
     //Implementation specific
-    ParticleSystem m_ParticleSystem{ m_ParticlesSize, m_IsAccelerationEnabled, m_IsPerpendicularEnabled };
+    ParticleSystem m_ParticleSystem{ m_ParticlesSize, m_IsAccelerationEnabled, m_IsPerpendicularEnabled, m_ParticleLifetime, m_ExpirationMode };
     std::shared_ptr<dx12lib::CommandList> m_CommandList;
 
     DXGI_FORMAT m_BackbufferFormat { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB };
@@ -158,4 +211,18 @@ private:
     DXGI_SAMPLE_DESC m_SampleDesc {};
     FPSCounter       m_FPSCounter {};
     MemoryCounter    m_MemoryCounter {};
+    Profiler         m_Profiler {};
+    SimulationScheduler m_SimulationScheduler {};
+    ParticleBudgetManager m_BudgetManager {};
+    QualityGovernor     m_QualityGovernor { m_GovernorSettings };
+
+    //autotuning
+    std::unique_ptr<Autotuner> m_Autotuner {};
+    std::string                m_MachineName {};
+    uint32_t                   m_AutotuneFrame { 0 };
+    double                     m_AutotuneMilliseconds { 0.0 };
+
+    //command capture
+    std::shared_ptr<dx12lib::CommandStream> m_CommandStream {};
+    uint32_t                                m_CapturedFrames { 0 };
 };
\ No newline at end of file
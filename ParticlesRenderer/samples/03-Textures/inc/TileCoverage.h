@@ -0,0 +1,117 @@
+#pragma once
+#include <ParallelFor.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Coverage and overdraw of screen aligned quads on a coarse grid of screen tiles.
+// The area of every quad is added to the tiles it overlaps. Chunks of quads fill their own tile histograms in
+// parallel, without atomics, and the histograms are summed tile by tile afterwards.
+// The overdraw of a tile is its covered area over its own area, the average number of quads on its pixels.
+class TileCoverage
+{
+public:
+    static constexpr uint32_t TileSize { 32 };  // pixels
+
+    // In pixels, from the top left corner of the screen.
+    struct Quad
+    {
+        float MinX;
+        float MinY;
+        float MaxX;
+        float MaxY;
+    };
+
+    void SetViewportSize( float width, float height );
+    void Clear();
+
+    // Replaces the coverage by the one of quadCount quads. getQuad( index, quad ) fills a quad and returns false
+    // when it is not drawn, it is called in parallel.
+    template<typename QuadFunction>
+    void EstimateQuads( size_t quadCount, const QuadFunction& getQuad )
+    {
+        if ( m_TileCountX == 0 )
+        {
+            SetViewportSize( m_Width, m_Height );
+        }
+        Clear();
+        if ( quadCount == 0 ) return;
+
+        // Few enough chunks that their histograms stay cheap to clear and merge
+        const size_t tileCount { m_TileOverdraw.size() };
+        const size_t chunkSize { std::max( m_MinChunkSize, ( quadCount + m_MaxChunkCount - 1 ) / m_MaxChunkCount ) };
+        const size_t chunkCount { Parallel::GetChunkCount( quadCount, chunkSize ) };
+        m_ChunkTiles.resize( chunkCount );
+
+        Parallel::ForEachChunk( quadCount, chunkSize, [&]( size_t chunk, size_t begin, size_t end ) {
+            std::vector<float>& tiles { m_ChunkTiles[chunk] };
+            tiles.assign( tileCount, 0.0f );
+            Quad quad {};
+            for ( size_t i { begin }; i < end; ++i )
+            {
+                if ( getQuad( i, quad ) )
+                {
+                    AddQuad( tiles, quad );
+                }
+            }
+        } );
+
+        SumChunks( chunkCount );
+    }
+
+    float GetViewportWidth() const
+    {
+        return m_Width;
+    }
+    float GetViewportHeight() const
+    {
+        return m_Height;
+    }
+    uint32_t GetTileCountX() const
+    {
+        return m_TileCountX;
+    }
+    uint32_t GetTileCountY() const
+    {
+        return m_TileCountY;
+    }
+    // Row major, from the top left tile.
+    const std::vector<float>& GetTileOverdraw() const
+    {
+        return m_TileOverdraw;
+    }
+
+    double GetCoveredPixels() const
+    {
+        return m_CoveredPixels;
+    }
+    // Covered pixels over the pixels of the screen.
+    double GetAverageOverdraw() const
+    {
+        return m_AverageOverdraw;
+    }
+    float GetMaxTileOverdraw() const
+    {
+        return m_MaxTileOverdraw;
+    }
+
+private:
+    void AddQuad( std::vector<float>& tiles, const Quad& quad ) const;
+    void SumChunks( size_t chunkCount );
+
+    static constexpr size_t m_MinChunkSize { 4096 };
+    static constexpr size_t m_MaxChunkCount { 64 };
+
+    float    m_Width { 1280.0f };
+    float    m_Height { 720.0f };
+    uint32_t m_TileCountX { 0 };
+    uint32_t m_TileCountY { 0 };
+
+    std::vector<std::vector<float>> m_ChunkTiles {};
+    std::vector<float>              m_TileOverdraw {};
+
+    double m_CoveredPixels { 0.0 };
+    double m_AverageOverdraw { 0.0 };
+    float  m_MaxTileOverdraw { 0.0f };
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel scheduling ids to expire on a given tick.
+// Level 0 has one bucket per tick, every level above covers 256 times the range of the one below.
+// When a level wraps around, the next bucket of the level above is cascaded down, so an entry is moved at most
+// once per level and advancing a tick only touches the entries that expire on it.
+class TimingWheel
+{
+public:
+    // Ticks in the past or on the current tick expire on the next one.
+    void Schedule( uint32_t id, uint64_t tick );
+
+    // Advances one tick and appends the ids expiring on it to expired.
+    void Advance( std::vector<uint32_t>& expired );
+
+    void Clear();
+
+    uint64_t GetCurrentTick() const
+    {
+        return m_CurrentTick;
+    }
+    size_t GetScheduledCount() const
+    {
+        return m_ScheduledCount;
+    }
+
+private:
+    struct Entry
+    {
+        uint32_t Id;
+        uint64_t Tick;
+    };
+
+    static constexpr uint32_t m_SlotBits { 8 };
+    static constexpr uint32_t m_SlotCount { 1u << m_SlotBits };
+    static constexpr uint32_t m_LevelCount { 4 };
+
+    void Insert( const Entry& entry );
+
+    std::array<std::array<std::vector<Entry>, m_SlotCount>, m_LevelCount> m_Levels {};
+    std::vector<Entry>                                                     m_Cascade {};
+
+    uint64_t m_CurrentTick { 0 };
+    size_t   m_ScheduledCount { 0 };
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Baked 3D vector field, memory mapped from a .vfb file.
+// Voxels are stored in 4x4x4 bricks, Morton ordered inside a brick, so the 8 corners of a trilinear
+// lookup are almost always in the same brick.
+//
+// .vfb layout: Header, followed by BricksX * BricksY * BricksZ bricks of 64 XMFLOAT3 voxels.
+// Bricks are stored x first, then y, then z.
+class VectorFieldVolume
+{
+public:
+    static constexpr uint32_t BrickSize { 4 };
+    static constexpr uint32_t VoxelsPerBrick { BrickSize * BrickSize * BrickSize };
+
+    // Maps a .vfb file. A .fga file is imported to a .vfb next to it first.
+    // Loading a file that is already mapped returns the same volume.
+    static std::shared_ptr<VectorFieldVolume> Load( const std::wstring& fileName );
+
+    // Voxels are given in linear order, x first.
+    static bool Save( const std::wstring& fileName, uint32_t sizeX, uint32_t sizeY, uint32_t sizeZ,
+                      const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax,
+                      const std::vector<DirectX::XMFLOAT3>& voxels );
+    static bool ImportFGA( const std::wstring& fgaFileName, const std::wstring& fileName );
+
+    ~VectorFieldVolume();
+
+    VectorFieldVolume( const VectorFieldVolume& )            = delete;
+    VectorFieldVolume& operator=( const VectorFieldVolume& ) = delete;
+
+    // Positions are in world space, the volume bounds are placed at origin + bounds * scale.
+    // Positions outside the bounds are clamped to the border.
+    DirectX::XMFLOAT3 Sample( const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& origin, float scale ) const;
+
+    // Samples 4 positions at a time, count must be a multiple of 4 and all arrays 16 bytes aligned.
+    void SampleBatch( const float* x, const float* y, const float* z, float* outX, float* outY, float* outZ,
+                      size_t count, const DirectX::XMFLOAT3& origin, float scale ) const;
+
+    DirectX::XMFLOAT3 GetBoundsMin() const
+    {
+        return m_BoundsMin;
+    }
+    DirectX::XMFLOAT3 GetBoundsMax() const
+    {
+        return m_BoundsMax;
+    }
+
+private:
+    struct Header
+    {
+        char     Magic[4];
+        uint32_t Version;
+        uint32_t SizeX, SizeY, SizeZ;
+        uint32_t BricksX, BricksY, BricksZ;
+        float    BoundsMin[3];
+        float    BoundsMax[3];
+    };
+
+    static constexpr char     m_Magic[4] { 'V', 'F', 'B', '1' };
+    static constexpr uint32_t m_Version { 1 };
+
+    VectorFieldVolume() = default;
+
+    bool Map( const std::wstring& fileName );
+
+    size_t GetVoxelIndex( uint32_t x, uint32_t y, uint32_t z ) const;
+
+    void*                    m_File { nullptr };
+    void*                    m_Mapping { nullptr };
+    const void*              m_View { nullptr };
+    const DirectX::XMFLOAT3* m_Voxels { nullptr };
+
+    uint32_t          m_Size[3] {};
+    uint32_t          m_BricksX {};
+    uint32_t          m_BricksY {};
+    DirectX::XMFLOAT3 m_BoundsMin {};
+    DirectX::XMFLOAT3 m_BoundsMax {};
+};
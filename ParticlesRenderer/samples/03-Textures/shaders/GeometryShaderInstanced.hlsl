@@ -0,0 +1,61 @@
+struct VertexShaderOutput
+{
+    matrix ModelViewProjectionMatrix : TRANSFORM;
+};
+
+struct GeometryShaderOutput
+{
+    float2 TexCoord : TEXCOORD;
+    float4 Position : SV_Position;
+};
+
+cbuffer Constants : register(b1)
+{
+    float FOV;
+    float ParticleSize;
+};
+
+
+void CreateTriangle(float4 v1, float4 v2, float4 v3, inout TriangleStream<GeometryShaderOutput> triangleStream)
+{
+    GeometryShaderOutput OUT;
+    //top-left
+    OUT.Position = v1;
+    OUT.TexCoord = float2(0.0f, 0.0f);
+    triangleStream.Append(OUT);
+
+    //top-right
+    OUT.Position = v2;
+    OUT.TexCoord = float2(1.0f, 0.0f);
+    triangleStream.Append(OUT);
+
+    //bottom-right
+    OUT.Position = v3;
+    OUT.TexCoord = float2(1.0f, 1.0f);
+    triangleStream.Append(OUT);
+}
+
+float4 CreateVertexFromBasePoint(matrix modelViewProjection, float x, float y)
+{
+    return mul(modelViewProjection, float4(x, y, 0, 1.0f));
+}
+
+
+//same quad as GeometryShader.hlsl, with the matrix of the instance instead of a constant buffer
+[maxvertexcount(6)]
+void main(point VertexShaderOutput IN[1], inout TriangleStream<GeometryShaderOutput> triangleStream)
+{
+    matrix modelViewProjection = IN[0].ModelViewProjectionMatrix;
+
+    // quad vertices
+    float4 topLeft = CreateVertexFromBasePoint(modelViewProjection, -ParticleSize, ParticleSize);
+    float4 topRight = CreateVertexFromBasePoint(modelViewProjection, ParticleSize, ParticleSize);
+    float4 bottomLeft = CreateVertexFromBasePoint(modelViewProjection, -ParticleSize, -ParticleSize);
+    float4 bottomRight = CreateVertexFromBasePoint(modelViewProjection, ParticleSize, -ParticleSize);
+
+    //first triangle
+    CreateTriangle(topLeft, topRight, bottomRight, triangleStream);
+
+    //second triangle
+    CreateTriangle(topLeft, bottomLeft, bottomRight, triangleStream);
+}
@@ -1,4 +1,7 @@
+// Overridden by the group size variants of the autotuner
+#ifndef MAX_PARTICLES_PER_GROUP
 #define MAX_PARTICLES_PER_GROUP 64
+#endif
 
 StructuredBuffer<matrix> Matrices : register(t0);
 
@@ -15,6 +18,15 @@ cbuffer Constants : register(b1)
     float ParticlesAmount;
 };
 
+// Linearization of the groups of the dispatch, see MeshDispatchConstants in MeshDispatchPlanner.h
+cbuffer DispatchConstants : register(b4)
+{
+    uint GroupOffset;
+    uint GroupsX;
+    uint GroupsY;
+    uint ParticleEnd;
+};
+
 float4 CreateVertexPositionFromMatrix(matrix inputMatrix, float x, float y)
 {
     return mul(inputMatrix, float4(x, y, 0.0f, 1.0f));
@@ -30,13 +42,14 @@ MeshOutput CreateVertexFromBasePoint(matrix inputMatrix, float2 position, float2
 
 [numthreads(1, 1, 1)]
 [outputtopology("triangle")]
-void main(out indices uint3 triangles[2 * MAX_PARTICLES_PER_GROUP], out vertices MeshOutput vertices[4 * MAX_PARTICLES_PER_GROUP], uint3 dispatchThreadID : SV_DispatchThreadID)
+void main(out indices uint3 triangles[2 * MAX_PARTICLES_PER_GROUP], out vertices MeshOutput vertices[4 * MAX_PARTICLES_PER_GROUP], uint3 groupID : SV_GroupID)
 {
-    uint groupStart = dispatchThreadID.x * MAX_PARTICLES_PER_GROUP;
-    uint groupEnd = min(groupStart + MAX_PARTICLES_PER_GROUP, ParticlesAmount);
+    uint group = GroupOffset + (groupID.z * GroupsY + groupID.y) * GroupsX + groupID.x;
+    uint groupStart = group * MAX_PARTICLES_PER_GROUP;
+    uint groupEnd = min(groupStart + MAX_PARTICLES_PER_GROUP, ParticleEnd);
 
-    //Amount of triangles and vertices definition
-    uint numParticles = groupEnd - groupStart;
+    //Amount of triangles and vertices definition, none for the groups past the end of the dispatch
+    uint numParticles = groupStart < groupEnd ? groupEnd - groupStart : 0;
     uint numTriangles = 2 * numParticles;
     uint numVertices = 4 * numParticles;
     SetMeshOutputCounts(numVertices, numTriangles);
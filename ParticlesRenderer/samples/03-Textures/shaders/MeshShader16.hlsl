@@ -0,0 +1,3 @@
+// MeshShader.hlsl with 16 particles per group, see Autotuner.h
+#define MAX_PARTICLES_PER_GROUP 16
+#include "MeshShader.hlsl"
@@ -0,0 +1,3 @@
+// MeshShader.hlsl with 32 particles per group, see Autotuner.h
+#define MAX_PARTICLES_PER_GROUP 32
+#include "MeshShader.hlsl"
@@ -0,0 +1,100 @@
+// Overridden by the group size variants of the autotuner
+#ifndef MAX_PARTICLES_PER_GROUP
+#define MAX_PARTICLES_PER_GROUP 64
+#endif
+
+// 8 bytes per particle, see PackedParticle in ParticlePacker.h
+//     x: X | Y << 16
+//     y: Z | Size << 16 | Life << 24
+StructuredBuffer<uint2> Particles : register(t0);
+
+struct MeshOutput
+{
+    float4 Position : SV_POSITION;
+    float2 TexCoord : TEXCOORD;
+};
+
+cbuffer Constants : register(b1)
+{
+    float FOV;
+    float ParticleSize;
+    float ParticlesAmount;
+};
+
+// Linearization of the groups of the dispatch, see MeshDispatchConstants in MeshDispatchPlanner.h
+cbuffer DispatchConstants : register(b4)
+{
+    uint GroupOffset;
+    uint GroupsX;
+    uint GroupsY;
+    uint ParticleEnd;
+};
+
+cbuffer PackedHeader : register(b2)
+{
+    matrix ViewProjection;
+    float3 BoundsMin;
+    float MaxScale;
+    float3 BoundsStep;
+    float Padding;
+};
+
+struct DecodedParticle
+{
+    float3 Position;
+    float Scale;
+    float Life;
+};
+
+DecodedParticle Decode(uint2 packed)
+{
+    DecodedParticle particle;
+    float3 steps = float3(packed.x & 0xFFFF, packed.x >> 16, packed.y & 0xFFFF);
+    particle.Position = BoundsMin + steps * BoundsStep;
+    particle.Scale = ((packed.y >> 16) & 0xFF) / 255.0f * MaxScale;
+    particle.Life = (packed.y >> 24) / 255.0f;
+    return particle;
+}
+
+MeshOutput CreateVertex(DecodedParticle particle, float2 position, float2 uv)
+{
+    //same quad as the matrix path, in the xy plane of the particle
+    MeshOutput OUT;
+    OUT.Position = mul(ViewProjection, float4(particle.Position + float3(position * particle.Scale, 0.0f), 1.0f));
+    OUT.TexCoord = uv;
+    return OUT;
+}
+
+[numthreads(1, 1, 1)]
+[outputtopology("triangle")]
+void main(out indices uint3 triangles[2 * MAX_PARTICLES_PER_GROUP], out vertices MeshOutput vertices[4 * MAX_PARTICLES_PER_GROUP], uint3 groupID : SV_GroupID)
+{
+    uint group = GroupOffset + (groupID.z * GroupsY + groupID.y) * GroupsX + groupID.x;
+    uint groupStart = group * MAX_PARTICLES_PER_GROUP;
+    uint groupEnd = min(groupStart + MAX_PARTICLES_PER_GROUP, ParticleEnd);
+
+    //Amount of triangles and vertices definition, none for the groups past the end of the dispatch
+    uint numParticles = groupStart < groupEnd ? groupEnd - groupStart : 0;
+    uint numTriangles = 2 * numParticles;
+    uint numVertices = 4 * numParticles;
+    SetMeshOutputCounts(numVertices, numTriangles);
+
+    for (uint i = groupStart; i < groupEnd; ++i)
+    {
+        DecodedParticle particle = Decode(Particles[i]);
+
+        //Indexes Definition
+        uint baseIndex = 4 * (i - groupStart);
+        uint baseTriangleIndex = 2 * (i - groupStart);
+
+        //Triangles Definition
+        triangles[baseTriangleIndex] = uint3(baseIndex, baseIndex + 1, baseIndex + 2);
+        triangles[baseTriangleIndex + 1] = uint3(baseIndex, baseIndex + 2, baseIndex + 3);
+
+        // Vertices Definition
+        vertices[baseIndex] = CreateVertex(particle, float2(-ParticleSize, ParticleSize), float2(0.0f, 1.0f));
+        vertices[baseIndex + 1] = CreateVertex(particle, float2(ParticleSize, ParticleSize), float2(1.0f, 1.0f));
+        vertices[baseIndex + 2] = CreateVertex(particle, float2(ParticleSize, -ParticleSize), float2(1.0f, 0.0f));
+        vertices[baseIndex + 3] = CreateVertex(particle, float2(-ParticleSize, -ParticleSize), float2(0.0f, 0.0f));
+    }
+}
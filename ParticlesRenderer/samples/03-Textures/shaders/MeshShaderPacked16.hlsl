@@ -0,0 +1,3 @@
+// MeshShaderPacked.hlsl with 16 particles per group, see Autotuner.h
+#define MAX_PARTICLES_PER_GROUP 16
+#include "MeshShaderPacked.hlsl"
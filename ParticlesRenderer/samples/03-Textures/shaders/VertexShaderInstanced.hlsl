@@ -0,0 +1,26 @@
+// Model view projection matrices of the drawn particles, one per instance
+StructuredBuffer<matrix> Matrices : register(t0);
+
+cbuffer InstanceConstants : register(b3)
+{
+    uint InstanceOffset;
+};
+
+struct VertexPositionNormalTexture
+{
+    float3 Position  : POSITION;
+    float2 TexCoord  : TEXCOORD;
+};
+
+struct VertexShaderOutput
+{
+    matrix ModelViewProjectionMatrix : TRANSFORM;
+};
+
+VertexShaderOutput main(VertexPositionNormalTexture IN, uint instanceID : SV_InstanceID)
+{
+    //SV_InstanceID starts at 0 in every draw
+    VertexShaderOutput OUT;
+    OUT.ModelViewProjectionMatrix = Matrices[InstanceOffset + instanceID];
+    return OUT;
+}
@@ -0,0 +1,274 @@
+#include <Autotuner.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+namespace
+{
+    // Continued fraction of the incomplete beta function, evaluated with the modified Lentz method
+    double BetaContinuedFraction( double a, double b, double x )
+    {
+        constexpr int    maxIterations { 200 };
+        constexpr double epsilon { 1e-12 };
+        constexpr double tiny { 1e-300 };
+
+        double c { 1.0 };
+        double d { 1.0 - ( a + b ) * x / ( a + 1.0 ) };
+        d = 1.0 / ( std::abs( d ) < tiny ? tiny : d );
+        double result { d };
+
+        for ( int m { 1 }; m <= maxIterations; ++m )
+        {
+            const double m2 { 2.0 * m };
+
+            // Even step
+            double term { m * ( b - m ) * x / ( ( a - 1.0 + m2 ) * ( a + m2 ) ) };
+            d = 1.0 + term * d;
+            d = 1.0 / ( std::abs( d ) < tiny ? tiny : d );
+            c = 1.0 + term / c;
+            c = std::abs( c ) < tiny ? tiny : c;
+            result *= d * c;
+
+            // Odd step
+            term = -( a + m ) * ( a + b + m ) * x / ( ( a + m2 ) * ( a + 1.0 + m2 ) );
+            d    = 1.0 + term * d;
+            d    = 1.0 / ( std::abs( d ) < tiny ? tiny : d );
+            c    = 1.0 + term / c;
+            c    = std::abs( c ) < tiny ? tiny : c;
+            const double delta { d * c };
+            result *= delta;
+
+            if ( std::abs( delta - 1.0 ) < epsilon ) break;
+        }
+        return result;
+    }
+
+    // Regularized incomplete beta function I_x(a, b)
+    double IncompleteBeta( double a, double b, double x )
+    {
+        if ( x <= 0.0 ) return 0.0;
+        if ( x >= 1.0 ) return 1.0;
+
+        const double front { std::exp( std::lgamma( a + b ) - std::lgamma( a ) - std::lgamma( b ) + a * std::log( x ) +
+                                       b * std::log( 1.0 - x ) ) };
+
+        // The continued fraction converges quickly on this side only, the other side uses the symmetry
+        if ( x < ( a + 1.0 ) / ( a + b + 2.0 ) )
+        {
+            return front * BetaContinuedFraction( a, b, x ) / a;
+        }
+        return 1.0 - front * BetaContinuedFraction( b, a, 1.0 - x ) / b;
+    }
+
+    void WriteConfiguration( std::ostream& stream, const Autotuner::Configuration& configuration )
+    {
+        for ( const auto& [name, value]: configuration )
+        {
+            stream << name << "=" << value << " ";
+        }
+    }
+}
+
+Autotuner::Autotuner( std::vector<Parameter> parameters, const Settings& settings, uint32_t seed )
+: m_Parameters { std::move( parameters ) }
+, m_Settings { settings }
+, m_Random { seed }
+{
+    m_Settings.Rounds = std::max( m_Settings.Rounds, 2u );
+
+    // Every combination of the values, the last parameter changes first
+    size_t candidateCount { 1 };
+    for ( const Parameter& parameter: m_Parameters )
+    {
+        candidateCount *= std::max<size_t>( parameter.Values.size(), 1 );
+    }
+    m_Candidates.reserve( candidateCount );
+    for ( size_t candidate { 0 }; candidate < candidateCount; ++candidate )
+    {
+        Configuration configuration {};
+        size_t        rest { candidate };
+        for ( auto parameter { m_Parameters.rbegin() }; parameter != m_Parameters.rend(); ++parameter )
+        {
+            if ( parameter->Values.empty() ) continue;
+            configuration[parameter->Name] = parameter->Values[rest % parameter->Values.size()];
+            rest /= parameter->Values.size();
+        }
+        m_Candidates.push_back( std::move( configuration ) );
+    }
+
+    m_Trials.resize( m_Candidates.size() );
+    m_Order.resize( m_Candidates.size() );
+    ShuffleRound();
+}
+
+void Autotuner::AddTrial( double milliseconds )
+{
+    if ( m_IsDone ) return;
+
+    if ( m_Round >= m_Settings.WarmupRounds )
+    {
+        m_Trials[m_Order[m_OrderCursor]].push_back( milliseconds );
+    }
+
+    if ( ++m_OrderCursor < m_Order.size() ) return;
+
+    m_OrderCursor = 0;
+    if ( ++m_Round < m_Settings.WarmupRounds + m_Settings.Rounds )
+    {
+        ShuffleRound();
+        return;
+    }
+
+    ComputeResults();
+    m_IsDone = true;
+}
+
+void Autotuner::ShuffleRound()
+{
+    std::iota( m_Order.begin(), m_Order.end(), size_t { 0 } );
+    std::shuffle( m_Order.begin(), m_Order.end(), m_Random );
+}
+
+void Autotuner::ComputeResults()
+{
+    m_Results.clear();
+    m_Results.reserve( m_Candidates.size() );
+    std::vector<double> variances {};
+    for ( size_t candidate { 0 }; candidate < m_Candidates.size(); ++candidate )
+    {
+        const std::vector<double>& trials { m_Trials[candidate] };
+        const double               count { static_cast<double>( trials.size() ) };
+        const double               mean { std::accumulate( trials.begin(), trials.end(), 0.0 ) / count };
+
+        double squares { 0.0 };
+        for ( double trial: trials )
+        {
+            squares += ( trial - mean ) * ( trial - mean );
+        }
+        const double variance { squares / ( count - 1.0 ) };  // unbiased, there are at least 2 trials
+        variances.push_back( variance );
+
+        m_Results.push_back( Result { m_Candidates[candidate], mean, std::sqrt( variance ), std::sqrt( variance / count ), 1.0, false } );
+    }
+
+    // Bonferroni: every candidate is one more comparison against the baseline
+    const size_t comparisonCount { std::max<size_t>( m_Candidates.size() - 1, 1 ) };
+    const double significance { m_Settings.Significance / static_cast<double>( comparisonCount ) };
+    const Result& baseline { m_Results[0] };
+
+    m_BestCandidate = 0;
+    for ( size_t candidate { 1 }; candidate < m_Results.size(); ++candidate )
+    {
+        Result& result { m_Results[candidate] };
+        result.PValue        = WelchTest( result.MeanMilliseconds, variances[candidate], m_Trials[candidate].size(),
+                                          baseline.MeanMilliseconds, variances[0], m_Trials[0].size() );
+        result.IsSignificant = result.PValue < significance;
+
+        const bool isWin { result.IsSignificant &&
+                           result.MeanMilliseconds <= baseline.MeanMilliseconds * ( 1.0 - m_Settings.MinImprovement ) };
+        if ( isWin && result.MeanMilliseconds < m_Results[m_BestCandidate].MeanMilliseconds )
+        {
+            m_BestCandidate = candidate;
+        }
+    }
+}
+
+double Autotuner::WelchTest( double meanA, double varianceA, size_t countA, double meanB, double varianceB, size_t countB )
+{
+    const double errorA { varianceA / static_cast<double>( countA ) };
+    const double errorB { varianceB / static_cast<double>( countB ) };
+    const double error { errorA + errorB };
+    if ( error <= 0.0 )
+    {
+        // No noise at all, any difference is significant
+        return meanA == meanB ? 1.0 : 0.0;
+    }
+
+    const double t { ( meanA - meanB ) / std::sqrt( error ) };
+    // Welch-Satterthwaite degrees of freedom
+    const double degrees { error * error /
+                           ( errorA * errorA / static_cast<double>( countA - 1 ) + errorB * errorB / static_cast<double>( countB - 1 ) ) };
+
+    // P(|T| > |t|) of the Student distribution
+    return IncompleteBeta( degrees * 0.5, 0.5, degrees / ( degrees + t * t ) );
+}
+
+void Autotuner::WriteReport( const std::string& fileName, const std::string& machine ) const
+{
+    std::ofstream logFile { fileName, std::ios::trunc };
+    if ( !logFile ) return;
+
+    logFile << "machine: " << machine << "\n";
+    logFile << "rounds: " << m_Settings.Rounds << " (+" << m_Settings.WarmupRounds << " warmup), significance: " << m_Settings.Significance
+            << " (" << m_Settings.Significance / static_cast<double>( std::max<size_t>( m_Candidates.size() - 1, 1 ) )
+            << " per comparison), min improvement: " << m_Settings.MinImprovement * 100.0 << "%\n";
+
+    for ( size_t candidate { 0 }; candidate < m_Results.size(); ++candidate )
+    {
+        const Result& result { m_Results[candidate] };
+        logFile << ( candidate == 0 ? "baseline  " : "candidate " );
+        WriteConfiguration( logFile, result.Candidate );
+        logFile << ": mean " << result.MeanMilliseconds << " ms, stddev " << result.StandardDeviation << ", stderr "
+                << result.StandardError << ", p " << result.PValue << ( result.IsSignificant ? " (significant)" : "" ) << "\n";
+    }
+
+    logFile << "adopted: ";
+    WriteConfiguration( logFile, GetBestConfiguration() );
+    logFile << ( m_BestCandidate == 0 ? "(no significant win)" : "" ) << "\n";
+}
+
+bool Autotuner::SaveConfiguration( const std::string& fileName, const std::string& machine, const Configuration& configuration )
+{
+    std::ofstream file { fileName, std::ios::trunc };
+    if ( !file ) return false;
+
+    file << "# written by the autotuner, delete to tune again\n";
+    file << "machine=" << machine << "\n";
+    for ( const auto& [name, value]: configuration )
+    {
+        file << name << "=" << value << "\n";
+    }
+    return static_cast<bool>( file );
+}
+
+bool Autotuner::LoadConfiguration( const std::string& fileName, const std::string& machine, Configuration& configuration )
+{
+    std::ifstream file { fileName };
+    if ( !file ) return false;
+
+    Configuration loaded {};
+    bool          isSameMachine { false };
+    std::string   line {};
+    while ( std::getline( file, line ) )
+    {
+        if ( line.empty() || line[0] == '#' ) continue;
+
+        const size_t separator { line.find( '=' ) };
+        if ( separator == std::string::npos ) continue;
+
+        const std::string name { line.substr( 0, separator ) };
+        const std::string value { line.substr( separator + 1 ) };
+        if ( name == "machine" )
+        {
+            isSameMachine = value == machine;
+            continue;
+        }
+
+        std::istringstream stream { value };
+        int                number {};
+        if ( stream >> number )
+        {
+            loaded[name] = number;
+        }
+    }
+    if ( !isSameMachine ) return false;
+
+    for ( const auto& [name, value]: loaded )
+    {
+        configuration[name] = value;
+    }
+    return true;
+}
@@ -12,14 +12,14 @@ Camera::Camera()
     , m_zNear( 0.1f )
     , m_zFar( 100.0f )
 {
-    pData = (AlignedData*)_aligned_malloc( sizeof(AlignedData), 16 );
+    pData = new AlignedData();
     pData->m_Translation = XMVectorZero();
     pData->m_Rotation = XMQuaternionIdentity();
 }
 
 Camera::~Camera()
 {
-    _aligned_free(pData);
+    delete pData;
 }
 
 void XM_CALLCONV Camera::set_LookAt( FXMVECTOR eye, FXMVECTOR target, FXMVECTOR up )
@@ -0,0 +1,28 @@
+#include <CommandListInstancedDrawBackend.h>
+
+#include <SceneVisitor.h>
+
+#include <dx12lib/CommandList.h>
+#include <dx12lib/Scene.h>
+
+CommandListInstancedDrawBackend::CommandListInstancedDrawBackend( dx12lib::CommandList& commandList, dx12lib::Scene& scene,
+                                                                  uint32_t offsetRootParameterIndex, const RenderQueue::Bindings& bindings ) :
+    m_CommandList { commandList },
+    m_Scene { scene },
+    m_OffsetRootParameterIndex { offsetRootParameterIndex },
+    m_Bindings { bindings }
+{}
+
+void CommandListInstancedDrawBackend::SetInstanceOffset( uint32_t offset )
+{
+    m_CommandList.SetGraphics32BitConstants( m_OffsetRootParameterIndex, offset );
+}
+
+void CommandListInstancedDrawBackend::DrawInstanced( uint32_t instanceCount )
+{
+    m_RenderQueue.Clear();
+    SceneVisitor visitor { m_RenderQueue, RenderPass::Opaque, instanceCount };
+    m_Scene.Accept( visitor );
+    m_RenderQueue.Sort();
+    m_RenderQueue.Submit( m_CommandList, m_Bindings );
+}
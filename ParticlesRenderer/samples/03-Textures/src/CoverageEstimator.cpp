@@ -0,0 +1,46 @@
+#include <CoverageEstimator.h>
+
+#include <Particle.h>
+#include <Profiler.h>
+
+using namespace DirectX;
+
+void CoverageEstimator::Estimate( const std::vector<Particle>& particles, const std::vector<uint32_t>& drawList,
+                                  const float* scales, float particleSize, FXMMATRIX viewMatrix,
+                                  CXMMATRIX projectionMatrix, Profiler& profiler )
+{
+    if ( drawList.empty() )
+    {
+        Clear();
+        return;
+    }
+
+    ScopedTimer timer { profiler, "Coverage/Estimate" };
+
+    const float width { GetViewportWidth() };
+    const float height { GetViewportHeight() };
+    const float projectionScale { XMVectorGetY( projectionMatrix.r[1] ) };
+    EstimateQuads( drawList.size(), [&]( size_t i, Quad& quad ) {
+        const uint32_t  index { drawList[i] };
+        const Particle& particle { particles[index] };
+
+        const XMFLOAT3 position { particle.GetPosition() };
+        const XMVECTOR viewPosition { XMVector3Transform( XMLoadFloat3( &position ), viewMatrix ) };
+        const float    depth { XMVectorGetZ( viewPosition ) };
+        if ( depth <= 0.0f ) return false;
+
+        // Same on screen size as the render LOD, the quad goes from -size to size
+        const XMVECTOR clipPosition { XMVector4Transform( XMVectorSetW( viewPosition, 1.0f ), projectionMatrix ) };
+        const float    inverseW { 1.0f / XMVectorGetW( clipPosition ) };
+        const float    centerX { ( XMVectorGetX( clipPosition ) * inverseW * 0.5f + 0.5f ) * width };
+        const float    centerY { ( 0.5f - XMVectorGetY( clipPosition ) * inverseW * 0.5f ) * height };
+        const float    scale { scales ? scales[index] : 1.0f };
+        const float    halfSize { 0.5f * particleSize * particle.GetSize() * scale * projectionScale * height / depth };
+
+        quad = Quad { centerX - halfSize, centerY - halfSize, centerX + halfSize, centerY + halfSize };
+        return true;
+    } );
+
+    profiler.AddCount( "Coverage/AverageOverdraw", GetAverageOverdraw() );
+    profiler.AddCount( "Coverage/MaxTileOverdraw", GetMaxTileOverdraw() );
+}
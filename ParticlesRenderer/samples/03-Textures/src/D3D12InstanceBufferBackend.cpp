@@ -0,0 +1,75 @@
+#include <dx12lib/d3dx12.h>
+
+#include <D3D12InstanceBufferBackend.h>
+
+#include <dx12lib/CommandList.h>
+#include <dx12lib/CommandQueue.h>
+#include <dx12lib/Device.h>
+#include <dx12lib/Helpers.h>
+#include <dx12lib/StructuredBuffer.h>
+
+#include <wrl.h>
+
+using namespace Microsoft::WRL;
+
+D3D12InstanceBufferBackend::D3D12InstanceBufferBackend( dx12lib::Device& device, dx12lib::CommandQueue& commandQueue ) :
+    m_Device { device },
+    m_CommandQueue { commandQueue }
+{}
+
+InstanceBufferBackend::Buffer D3D12InstanceBufferBackend::Create( size_t size )
+{
+    // Same upload heap resource as StructuredBuffer::UploadDataToStructuredBuffer, but kept and mapped for its whole life
+    const CD3DX12_HEAP_PROPERTIES heapProperties { D3D12_HEAP_TYPE_UPLOAD };
+    const CD3DX12_RESOURCE_DESC   bufferDesc { CD3DX12_RESOURCE_DESC::Buffer( size ) };
+
+    ComPtr<ID3D12Resource> resource {};
+    ThrowIfFailed( m_Device.GetD3D12Device()->CreateCommittedResource( &heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+                                                                       D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS( &resource ) ) );
+
+    // The CPU never reads the buffer
+    const CD3DX12_RANGE readRange { 0, 0 };
+    void*               data { nullptr };
+    ThrowIfFailed( resource->Map( 0, &readRange, &data ) );
+
+    uint32_t id { static_cast<uint32_t>( m_Buffers.size() + 1 ) };
+    if ( m_FreeIds.empty() )
+    {
+        m_Buffers.emplace_back();
+    }
+    else
+    {
+        id = m_FreeIds.back();
+        m_FreeIds.pop_back();
+    }
+    m_Buffers[id - 1] = m_Device.CreateStructuredBuffer( resource, size / sizeof( uint32_t ), sizeof( uint32_t ) );
+
+    return Buffer { id, data, size };
+}
+
+void D3D12InstanceBufferBackend::Destroy( const Buffer& buffer )
+{
+    m_Buffers[buffer.Id - 1]->GetD3D12Resource()->Unmap( 0, nullptr );
+    m_Buffers[buffer.Id - 1].reset();
+    m_FreeIds.emplace_back( buffer.Id );
+}
+
+void D3D12InstanceBufferBackend::Bind( dx12lib::CommandList& commandList, uint32_t rootParameterIndex, const Buffer& buffer )
+{
+    commandList.SetShaderResourceView( rootParameterIndex, m_Buffers[buffer.Id - 1], D3D12_RESOURCE_STATE_GENERIC_READ );
+}
+
+uint64_t D3D12InstanceBufferBackend::Signal()
+{
+    return m_CommandQueue.Signal();
+}
+
+bool D3D12InstanceBufferBackend::IsComplete( uint64_t fenceValue )
+{
+    return m_CommandQueue.IsFenceComplete( fenceValue );
+}
+
+void D3D12InstanceBufferBackend::Wait( uint64_t fenceValue )
+{
+    m_CommandQueue.WaitForFenceValue( fenceValue );
+}
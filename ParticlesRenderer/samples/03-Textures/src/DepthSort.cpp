@@ -0,0 +1,184 @@
+#include <DepthSort.h>
+
+#include <Camera.h>
+#include <Particle.h>
+#include <Profiler.h>
+#include <RadixSort.h>
+
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+void DepthSort::Sort( const std::vector<Particle>& particles, const Camera& camera, std::vector<uint32_t>& indices,
+                      Profiler& profiler )
+{
+    if ( m_Mode == DepthSortMode::Off ) return;
+
+    bool isSorted { false };
+    if ( m_Mode == DepthSortMode::Incremental && !m_PreviousOrder.empty() && !HasCameraMoved( camera ) )
+    {
+        ScopedTimer timer { profiler, "DepthSort/Incremental" };
+        BuildCandidateOrder( indices, particles.size() );
+        ComputeKeys( particles, camera, m_Candidate );
+        isSorted = SortIncremental( indices );
+        profiler.AddCount( "DepthSort/IncrementalFallbacks", isSorted ? 0.0 : 1.0 );
+    }
+
+    if ( !isSorted )
+    {
+        ScopedTimer timer { profiler, "DepthSort/Full" };
+        ComputeKeys( particles, camera, indices );
+        SortFull( indices );
+    }
+
+    m_PreviousOrder = indices;
+    XMStoreFloat3( &m_PreviousCameraPosition, camera.get_Translation() );
+    XMStoreFloat4( &m_PreviousCameraRotation, camera.get_Rotation() );
+}
+
+void DepthSort::ComputeKeys( const std::vector<Particle>& particles, const Camera& camera, const std::vector<uint32_t>& indices )
+{
+    const size_t   count { indices.size() };
+    const size_t   chunkCount { Parallel::GetChunkCount( count, m_ChunkSize ) };
+    const XMMATRIX viewMatrix { camera.get_ViewMatrix() };
+
+    m_Depths.resize( count );
+    m_Keys.resize( count );
+
+    std::vector<float> chunkMin( chunkCount );
+    std::vector<float> chunkMax( chunkCount );
+    Parallel::ForEachChunk( count, m_ChunkSize, [&]( size_t chunk, size_t begin, size_t end ) {
+        float minDepth { FLT_MAX };
+        float maxDepth { -FLT_MAX };
+        for ( size_t i { begin }; i < end; ++i )
+        {
+            const XMFLOAT3 position { particles[indices[i]].GetPosition() };
+            const float    depth { XMVectorGetZ( XMVector3Transform( XMLoadFloat3( &position ), viewMatrix ) ) };
+            m_Depths[i] = depth;
+            minDepth    = std::min( minDepth, depth );
+            maxDepth    = std::max( maxDepth, depth );
+        }
+        chunkMin[chunk] = minDepth;
+        chunkMax[chunk] = maxDepth;
+    } );
+
+    float minDepth { FLT_MAX };
+    float maxDepth { -FLT_MAX };
+    for ( size_t chunk { 0 }; chunk < chunkCount; ++chunk )
+    {
+        minDepth = std::min( minDepth, chunkMin[chunk] );
+        maxDepth = std::max( maxDepth, chunkMax[chunk] );
+    }
+
+    // The furthest particle gets the smallest key so it is drawn first
+    const float maxKey { static_cast<float>( ( 1u << m_KeyBits ) - 1 ) };
+    const float scale { maxKey / std::max( maxDepth - minDepth, FLT_EPSILON ) };
+    Parallel::ForEachChunk( count, m_ChunkSize, [&]( size_t, size_t begin, size_t end ) {
+        for ( size_t i { begin }; i < end; ++i )
+        {
+            m_Keys[i] = static_cast<uint32_t>( maxKey - std::min( ( m_Depths[i] - minDepth ) * scale, maxKey ) );
+        }
+    } );
+}
+
+void DepthSort::SortFull( std::vector<uint32_t>& indices )
+{
+    Parallel::RadixSort( m_Keys, indices, m_TempKeys, m_TempIndices, m_KeyBits );
+}
+
+bool DepthSort::SortIncremental( std::vector<uint32_t>& indices )
+{
+    const size_t count { m_Candidate.size() };
+    m_Entries.resize( count );
+    Parallel::ForEachChunk( count, m_ChunkSize, [this]( size_t, size_t begin, size_t end ) {
+        for ( size_t i { begin }; i < end; ++i )
+        {
+            m_Entries[i] = ( static_cast<uint64_t>( m_Keys[i] ) << 32 ) | m_Candidate[i];
+        }
+    } );
+
+    // Insertion sort every chunk, giving up when the previous order is too far from the new one
+    std::atomic<bool> isTooExpensive { false };
+    Parallel::ForEachChunk( count, m_ChunkSize, [this, &isTooExpensive]( size_t, size_t begin, size_t end ) {
+        const size_t maxShifts { ( end - begin ) * m_MaxShiftsPerParticle };
+        size_t       shifts { 0 };
+        for ( size_t i { begin + 1 }; i < end; ++i )
+        {
+            const uint64_t entry { m_Entries[i] };
+            size_t         j { i };
+            while ( j > begin && m_Entries[j - 1] > entry )
+            {
+                m_Entries[j] = m_Entries[j - 1];
+                --j;
+            }
+            m_Entries[j] = entry;
+
+            shifts += i - j;
+            if ( shifts > maxShifts || isTooExpensive.load( std::memory_order_relaxed ) )
+            {
+                isTooExpensive.store( true, std::memory_order_relaxed );
+                return;
+            }
+        }
+    } );
+    if ( isTooExpensive ) return false;
+
+    // Merge the sorted chunks pairwise, pairs that are already in order are skipped
+    for ( size_t width { m_ChunkSize }; width < count; width *= 2 )
+    {
+        Parallel::ForEachChunk( Parallel::GetChunkCount( count, 2 * width ), 1, [this, width, count]( size_t pair, size_t, size_t ) {
+            const size_t begin { pair * 2 * width };
+            const size_t middle { std::min( begin + width, count ) };
+            const size_t end { std::min( begin + 2 * width, count ) };
+            if ( middle < end && m_Entries[middle - 1] > m_Entries[middle] )
+            {
+                std::inplace_merge( m_Entries.begin() + begin, m_Entries.begin() + middle, m_Entries.begin() + end );
+            }
+        } );
+    }
+
+    indices.resize( count );
+    Parallel::ForEachChunk( count, m_ChunkSize, [this, &indices]( size_t, size_t begin, size_t end ) {
+        for ( size_t i { begin }; i < end; ++i )
+        {
+            indices[i] = static_cast<uint32_t>( m_Entries[i] );
+        }
+    } );
+    return true;
+}
+
+void DepthSort::BuildCandidateOrder( const std::vector<uint32_t>& indices, size_t particleCount )
+{
+    m_IsToDraw.assign( particleCount, 0 );
+    for ( const uint32_t index: indices )
+    {
+        m_IsToDraw[index] = 1;
+    }
+
+    m_Candidate.clear();
+    m_Candidate.reserve( indices.size() );
+    for ( const uint32_t index: m_PreviousOrder )
+    {
+        if ( index < particleCount && m_IsToDraw[index] )
+        {
+            m_Candidate.emplace_back( index );
+            m_IsToDraw[index] = 0;
+        }
+    }
+    for ( const uint32_t index: indices )
+    {
+        if ( m_IsToDraw[index] )
+        {
+            m_Candidate.emplace_back( index );
+        }
+    }
+}
+
+bool DepthSort::HasCameraMoved( const Camera& camera ) const
+{
+    const XMVECTOR movement { camera.get_Translation() - XMLoadFloat3( &m_PreviousCameraPosition ) };
+    const float    rotationDot { std::abs( XMVectorGetX( XMQuaternionDot( camera.get_Rotation(), XMLoadFloat4( &m_PreviousCameraRotation ) ) ) ) };
+    return XMVectorGetX( XMVector3Length( movement ) ) > m_MaxCameraMovement || rotationDot < m_MinCameraRotationDot;
+}
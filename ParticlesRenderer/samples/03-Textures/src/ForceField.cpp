@@ -0,0 +1,380 @@
+#include <ForceField.h>
+
+#include <Particle.h>
+#include <Profiler.h>
+#include <VectorFieldVolume.h>
+
+#include <algorithm>
+#include <chrono>
+
+using namespace DirectX;
+
+namespace
+{
+    struct alignas( 16 ) ForceBatch
+    {
+        float PosX[ForceFieldSet::BatchSize];
+        float PosY[ForceFieldSet::BatchSize];
+        float PosZ[ForceFieldSet::BatchSize];
+        float VelX[ForceFieldSet::BatchSize];
+        float VelY[ForceFieldSet::BatchSize];
+        float VelZ[ForceFieldSet::BatchSize];
+        float AccX[ForceFieldSet::BatchSize];
+        float AccY[ForceFieldSet::BatchSize];
+        float AccZ[ForceFieldSet::BatchSize];
+        float SampleX[ForceFieldSet::BatchSize];
+        float SampleY[ForceFieldSet::BatchSize];
+        float SampleZ[ForceFieldSet::BatchSize];
+    };
+
+    inline XMVECTOR Load4( const float* source )
+    {
+        return XMLoadFloat4A( reinterpret_cast<const XMFLOAT4A*>( source ) );
+    }
+
+    inline void Store4( float* destination, FXMVECTOR value )
+    {
+        XMStoreFloat4A( reinterpret_cast<XMFLOAT4A*>( destination ), value );
+    }
+
+    inline void AddAcceleration( ForceBatch& batch, size_t i, FXMVECTOR x, FXMVECTOR y, FXMVECTOR z )
+    {
+        Store4( &batch.AccX[i], Load4( &batch.AccX[i] ) + x );
+        Store4( &batch.AccY[i], Load4( &batch.AccY[i] ) + y );
+        Store4( &batch.AccZ[i], Load4( &batch.AccZ[i] ) + z );
+    }
+
+    void AccumulateAttractor( ForceBatch& batch, size_t count, const PointAttractor& attractor )
+    {
+        const XMVECTOR centerX { XMVectorReplicate( attractor.Position.x ) };
+        const XMVECTOR centerY { XMVectorReplicate( attractor.Position.y ) };
+        const XMVECTOR centerZ { XMVectorReplicate( attractor.Position.z ) };
+        const XMVECTOR strength { XMVectorReplicate( attractor.Strength ) };
+        const XMVECTOR radiusSq { XMVectorReplicate( attractor.Radius * attractor.Radius ) };
+        const XMVECTOR epsilon { XMVectorReplicate( 1e-6f ) };
+
+        for ( size_t i { 0 }; i < count; i += 4 )
+        {
+            const XMVECTOR dx { centerX - Load4( &batch.PosX[i] ) };
+            const XMVECTOR dy { centerY - Load4( &batch.PosY[i] ) };
+            const XMVECTOR dz { centerZ - Load4( &batch.PosZ[i] ) };
+
+            const XMVECTOR distSq { dx * dx + dy * dy + dz * dz };
+            const XMVECTOR invDist { XMVectorReciprocalSqrtEst( XMVectorMax( distSq, epsilon ) ) };
+            const XMVECTOR scale { strength * invDist * XMVectorReciprocalEst( XMVectorMax( distSq, radiusSq ) ) };
+
+            AddAcceleration( batch, i, dx * scale, dy * scale, dz * scale );
+        }
+    }
+
+    void AccumulateVortex( ForceBatch& batch, size_t count, const Vortex& vortex )
+    {
+        const XMVECTOR centerX { XMVectorReplicate( vortex.Center.x ) };
+        const XMVECTOR centerY { XMVectorReplicate( vortex.Center.y ) };
+        const XMVECTOR centerZ { XMVectorReplicate( vortex.Center.z ) };
+        const XMVECTOR axisX { XMVectorReplicate( vortex.Axis.x ) };
+        const XMVECTOR axisY { XMVectorReplicate( vortex.Axis.y ) };
+        const XMVECTOR axisZ { XMVectorReplicate( vortex.Axis.z ) };
+        const XMVECTOR strength { XMVectorReplicate( vortex.Strength ) };
+        const XMVECTOR radiusSq { XMVectorReplicate( vortex.Radius * vortex.Radius ) };
+
+        for ( size_t i { 0 }; i < count; i += 4 )
+        {
+            const XMVECTOR rx { Load4( &batch.PosX[i] ) - centerX };
+            const XMVECTOR ry { Load4( &batch.PosY[i] ) - centerY };
+            const XMVECTOR rz { Load4( &batch.PosZ[i] ) - centerZ };
+
+            // Distance to the axis
+            const XMVECTOR along { rx * axisX + ry * axisY + rz * axisZ };
+            const XMVECTOR px { rx - axisX * along };
+            const XMVECTOR py { ry - axisY * along };
+            const XMVECTOR pz { rz - axisZ * along };
+
+            const XMVECTOR distSq { px * px + py * py + pz * pz };
+            const XMVECTOR scale { strength * XMVectorReciprocalEst( XMVectorMax( distSq, radiusSq ) ) };
+
+            // Tangent direction: axis x offset
+            AddAcceleration( batch, i,
+                             ( axisY * pz - axisZ * py ) * scale,
+                             ( axisZ * px - axisX * pz ) * scale,
+                             ( axisX * py - axisY * px ) * scale );
+        }
+    }
+
+    void AccumulateDrag( ForceBatch& batch, size_t count, float coefficient )
+    {
+        const XMVECTOR drag { XMVectorReplicate( -coefficient ) };
+
+        for ( size_t i { 0 }; i < count; i += 4 )
+        {
+            AddAcceleration( batch, i, Load4( &batch.VelX[i] ) * drag, Load4( &batch.VelY[i] ) * drag,
+                             Load4( &batch.VelZ[i] ) * drag );
+        }
+    }
+
+    void AccumulateWind( ForceBatch& batch, size_t count, const Wind& wind )
+    {
+        const XMVECTOR windX { XMVectorReplicate( wind.Velocity.x ) };
+        const XMVECTOR windY { XMVectorReplicate( wind.Velocity.y ) };
+        const XMVECTOR windZ { XMVectorReplicate( wind.Velocity.z ) };
+        const XMVECTOR coefficient { XMVectorReplicate( wind.Coefficient ) };
+
+        for ( size_t i { 0 }; i < count; i += 4 )
+        {
+            AddAcceleration( batch, i,
+                             ( windX - Load4( &batch.VelX[i] ) ) * coefficient,
+                             ( windY - Load4( &batch.VelY[i] ) ) * coefficient,
+                             ( windZ - Load4( &batch.VelZ[i] ) ) * coefficient );
+        }
+    }
+
+    // Potential: ( sin(fy)cos(fz+t), sin(fz)cos(fx+t), sin(fx)cos(fy+t) ), its curl is divergence free.
+    void AccumulateCurlNoise( ForceBatch& batch, size_t count, const CurlNoise& noise, float time )
+    {
+        const XMVECTOR frequency { XMVectorReplicate( noise.Frequency ) };
+        const XMVECTOR phase { XMVectorReplicate( time * noise.Speed ) };
+        const XMVECTOR strength { XMVectorReplicate( -noise.Strength ) };
+
+        for ( size_t i { 0 }; i < count; i += 4 )
+        {
+            const XMVECTOR fx { Load4( &batch.PosX[i] ) * frequency };
+            const XMVECTOR fy { Load4( &batch.PosY[i] ) * frequency };
+            const XMVECTOR fz { Load4( &batch.PosZ[i] ) * frequency };
+
+            XMVECTOR sinX, cosX, sinY, cosY, sinZ, cosZ;
+            XMVectorSinCos( &sinX, &cosX, fx );
+            XMVectorSinCos( &sinY, &cosY, fy );
+            XMVectorSinCos( &sinZ, &cosZ, fz );
+
+            XMVECTOR sinXt, cosXt, sinYt, cosYt, sinZt, cosZt;
+            XMVectorSinCos( &sinXt, &cosXt, fx + phase );
+            XMVectorSinCos( &sinYt, &cosYt, fy + phase );
+            XMVectorSinCos( &sinZt, &cosZt, fz + phase );
+
+            AddAcceleration( batch, i,
+                             ( sinX * sinYt + cosZ * cosXt ) * strength,
+                             ( sinY * sinZt + cosX * cosYt ) * strength,
+                             ( sinZ * sinXt + cosY * cosZt ) * strength );
+        }
+    }
+
+    void AccumulateVolume( ForceBatch& batch, size_t count, const VolumeField& field )
+    {
+        field.Volume->SampleBatch( batch.PosX, batch.PosY, batch.PosZ, batch.SampleX, batch.SampleY, batch.SampleZ,
+                                   count, field.Origin, field.Scale );
+
+        const XMVECTOR intensity { XMVectorReplicate( field.Intensity ) };
+        const XMVECTOR tightness { XMVectorReplicate( field.Tightness ) };
+
+        for ( size_t i { 0 }; i < count; i += 4 )
+        {
+            const XMVECTOR sampleX { Load4( &batch.SampleX[i] ) * intensity };
+            const XMVECTOR sampleY { Load4( &batch.SampleY[i] ) * intensity };
+            const XMVECTOR sampleZ { Load4( &batch.SampleZ[i] ) * intensity };
+
+            if ( field.Tightness > 0.0f )
+            {
+                AddAcceleration( batch, i,
+                                 ( sampleX - Load4( &batch.VelX[i] ) ) * tightness,
+                                 ( sampleY - Load4( &batch.VelY[i] ) ) * tightness,
+                                 ( sampleZ - Load4( &batch.VelZ[i] ) ) * tightness );
+            }
+            else
+            {
+                AddAcceleration( batch, i, sampleX, sampleY, sampleZ );
+            }
+        }
+    }
+
+    constexpr const char* g_FieldNames[] {
+        "Forces/Attractors",
+        "Forces/Vortices",
+        "Forces/Drag",
+        "Forces/Wind",
+        "Forces/CurlNoise",
+        "Forces/Volumes",
+    };
+}
+
+void ForceFieldSet::AddAttractor( const PointAttractor& attractor )
+{
+    m_Attractors.push_back( attractor );
+}
+
+void ForceFieldSet::AddVortex( const Vortex& vortex )
+{
+    Vortex normalized { vortex };
+    XMStoreFloat3( &normalized.Axis, XMVector3Normalize( XMLoadFloat3( &vortex.Axis ) ) );
+    m_Vortices.push_back( normalized );
+}
+
+void ForceFieldSet::AddDrag( const LinearDrag& drag )
+{
+    // Linear drags add up, a single pass is enough for all of them.
+    m_DragCoefficient += drag.Coefficient;
+}
+
+void ForceFieldSet::AddWind( const Wind& wind )
+{
+    m_Winds.push_back( wind );
+}
+
+void ForceFieldSet::AddCurlNoise( const CurlNoise& curlNoise )
+{
+    m_CurlNoises.push_back( curlNoise );
+}
+
+void ForceFieldSet::AddVolume( const VolumeField& volume )
+{
+    if ( volume.Volume ) m_Volumes.push_back( volume );
+}
+
+void ForceFieldSet::Clear()
+{
+    m_Attractors.clear();
+    m_Vortices.clear();
+    m_Winds.clear();
+    m_CurlNoises.clear();
+    m_Volumes.clear();
+    m_DragCoefficient = 0.0f;
+}
+
+void ForceFieldSet::Advance( float deltaTime )
+{
+    m_Time += deltaTime;
+}
+
+uint32_t ForceFieldSet::GetActiveMask() const
+{
+    uint32_t mask { 0 };
+    if ( !m_Attractors.empty() ) mask |= GetBit( ForceFieldType::Attractor );
+    if ( !m_Vortices.empty() ) mask |= GetBit( ForceFieldType::Vortex );
+    if ( m_DragCoefficient != 0.0f ) mask |= GetBit( ForceFieldType::Drag );
+    if ( !m_Winds.empty() ) mask |= GetBit( ForceFieldType::Wind );
+    if ( !m_CurlNoises.empty() ) mask |= GetBit( ForceFieldType::CurlNoise );
+    if ( !m_Volumes.empty() ) mask |= GetBit( ForceFieldType::Volume );
+    return mask;
+}
+
+template<size_t... Masks>
+std::array<ForceFieldSet::BatchFunction, sizeof...( Masks )> ForceFieldSet::MakeBatchTable( std::index_sequence<Masks...> )
+{
+    return { &ForceFieldSet::ApplyBatch<static_cast<uint32_t>( Masks )>... };
+}
+
+void ForceFieldSet::Apply( Particle* particles, size_t count, float deltaTime ) const
+{
+    static const auto batchTable { MakeBatchTable( std::make_index_sequence<1u << FieldTypeCount> {} ) };
+
+    const uint32_t mask { GetActiveMask() };
+    if ( mask == 0 ) return;
+
+    const BatchFunction applyBatch { batchTable[mask] };
+    for ( size_t offset { 0 }; offset < count; offset += BatchSize )
+    {
+        ( this->*applyBatch )( particles + offset, std::min( BatchSize, count - offset ), deltaTime );
+    }
+}
+
+template<typename Func>
+void ForceFieldSet::TimedPass( ForceFieldType type, Func&& func ) const
+{
+    const auto start { std::chrono::high_resolution_clock::now() };
+    func();
+    const auto elapsed { std::chrono::high_resolution_clock::now() - start };
+
+    m_Nanoseconds[static_cast<uint32_t>( type )].fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count(), std::memory_order_relaxed );
+}
+
+template<uint32_t Mask>
+void ForceFieldSet::ApplyBatch( Particle* particles, size_t count, float deltaTime ) const
+{
+    if constexpr ( Mask != 0 )
+    {
+        ForceBatch batch;
+
+        for ( size_t i { 0 }; i < count; ++i )
+        {
+            const XMFLOAT3 position { particles[i].GetPosition() };
+            const XMFLOAT3 velocity { particles[i].GetVelocity() };
+            batch.PosX[i] = position.x;
+            batch.PosY[i] = position.y;
+            batch.PosZ[i] = position.z;
+            batch.VelX[i] = velocity.x;
+            batch.VelY[i] = velocity.y;
+            batch.VelZ[i] = velocity.z;
+        }
+
+        // Pad the tail so the fields can always work on 4 particles.
+        const size_t paddedCount { ( count + 3 ) & ~size_t { 3 } };
+        for ( size_t i { count }; i < paddedCount; ++i )
+        {
+            batch.PosX[i] = batch.PosY[i] = batch.PosZ[i] = 0.0f;
+            batch.VelX[i] = batch.VelY[i] = batch.VelZ[i] = 0.0f;
+        }
+        std::fill_n( batch.AccX, paddedCount, 0.0f );
+        std::fill_n( batch.AccY, paddedCount, 0.0f );
+        std::fill_n( batch.AccZ, paddedCount, 0.0f );
+
+        if constexpr ( ( Mask & GetBit( ForceFieldType::Attractor ) ) != 0 )
+        {
+            TimedPass( ForceFieldType::Attractor, [&] {
+                for ( const PointAttractor& attractor: m_Attractors )
+                    AccumulateAttractor( batch, paddedCount, attractor );
+            } );
+        }
+        if constexpr ( ( Mask & GetBit( ForceFieldType::Vortex ) ) != 0 )
+        {
+            TimedPass( ForceFieldType::Vortex, [&] {
+                for ( const Vortex& vortex: m_Vortices )
+                    AccumulateVortex( batch, paddedCount, vortex );
+            } );
+        }
+        if constexpr ( ( Mask & GetBit( ForceFieldType::Drag ) ) != 0 )
+        {
+            TimedPass( ForceFieldType::Drag, [&] { AccumulateDrag( batch, paddedCount, m_DragCoefficient ); } );
+        }
+        if constexpr ( ( Mask & GetBit( ForceFieldType::Wind ) ) != 0 )
+        {
+            TimedPass( ForceFieldType::Wind, [&] {
+                for ( const Wind& wind: m_Winds )
+                    AccumulateWind( batch, paddedCount, wind );
+            } );
+        }
+        if constexpr ( ( Mask & GetBit( ForceFieldType::CurlNoise ) ) != 0 )
+        {
+            TimedPass( ForceFieldType::CurlNoise, [&] {
+                for ( const CurlNoise& noise: m_CurlNoises )
+                    AccumulateCurlNoise( batch, paddedCount, noise, m_Time );
+            } );
+        }
+        if constexpr ( ( Mask & GetBit( ForceFieldType::Volume ) ) != 0 )
+        {
+            TimedPass( ForceFieldType::Volume, [&] {
+                for ( const VolumeField& volume: m_Volumes )
+                    AccumulateVolume( batch, paddedCount, volume );
+            } );
+        }
+
+        for ( size_t i { 0 }; i < count; ++i )
+        {
+            particles[i].SetVelocity( XMFLOAT3 { batch.VelX[i] + batch.AccX[i] * deltaTime,
+                                                 batch.VelY[i] + batch.AccY[i] * deltaTime,
+                                                 batch.VelZ[i] + batch.AccZ[i] * deltaTime } );
+        }
+    }
+}
+
+void ForceFieldSet::ReportTimings( Profiler& profiler ) const
+{
+    const uint32_t mask { GetActiveMask() };
+    for ( uint32_t type { 0 }; type < FieldTypeCount; ++type )
+    {
+        const long long nanoseconds { m_Nanoseconds[type].exchange( 0, std::memory_order_relaxed ) };
+        if ( ( mask & ( 1u << type ) ) != 0 )
+        {
+            profiler.AddTime( g_FieldNames[type], static_cast<double>( nanoseconds ) / 1e6 );
+        }
+    }
+}
@@ -0,0 +1,169 @@
+#include <FrustumCulling.h>
+
+#include <ParallelFor.h>
+#include <Particle.h>
+#include <Profiler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+using namespace DirectX;
+
+FrustumPlanes FrustumPlanes::FromViewProjection( FXMMATRIX viewProjectionMatrix )
+{
+    // Rows of the transpose are the columns of the matrix
+    const XMMATRIX columns { XMMatrixTranspose( viewProjectionMatrix ) };
+    const XMVECTOR planes[6] {
+        columns.r[3] + columns.r[0],  // left
+        columns.r[3] - columns.r[0],  // right
+        columns.r[3] + columns.r[1],  // bottom
+        columns.r[3] - columns.r[1],  // top
+        columns.r[2],                 // near
+        columns.r[3] - columns.r[2],  // far
+    };
+
+    FrustumPlanes frustum {};
+    for ( int i { 0 }; i < 6; ++i )
+    {
+        XMStoreFloat4( &frustum.Planes[i], XMPlaneNormalize( planes[i] ) );
+    }
+    return frustum;
+}
+
+ContainmentType FrustumPlanes::Contains( const BoundingBox& box ) const
+{
+    ContainmentType containment { CONTAINS };
+    for ( const XMFLOAT4& plane: Planes )
+    {
+        const float distance { plane.x * box.Center.x + plane.y * box.Center.y + plane.z * box.Center.z + plane.w };
+        const float radius { std::abs( plane.x ) * box.Extents.x + std::abs( plane.y ) * box.Extents.y + std::abs( plane.z ) * box.Extents.z };
+        if ( distance < -radius ) return DISJOINT;
+        if ( distance < radius ) containment = INTERSECTS;
+    }
+    return containment;
+}
+
+std::array<XMMATRIX, 6> GetCubemapViewProjections( FXMVECTOR position, float nearZ, float farZ )
+{
+    const XMVECTOR directions[6] {
+        XMVectorSet( 1, 0, 0, 0 ), XMVectorSet( -1, 0, 0, 0 ), XMVectorSet( 0, 1, 0, 0 ),
+        XMVectorSet( 0, -1, 0, 0 ), XMVectorSet( 0, 0, 1, 0 ), XMVectorSet( 0, 0, -1, 0 ),
+    };
+    const XMVECTOR ups[6] {
+        XMVectorSet( 0, 1, 0, 0 ), XMVectorSet( 0, 1, 0, 0 ), XMVectorSet( 0, 0, -1, 0 ),
+        XMVectorSet( 0, 0, 1, 0 ), XMVectorSet( 0, 1, 0, 0 ), XMVectorSet( 0, 1, 0, 0 ),
+    };
+
+    const XMMATRIX projectionMatrix { XMMatrixPerspectiveFovLH( XM_PIDIV2, 1.0f, nearZ, farZ ) };
+
+    std::array<XMMATRIX, 6> viewProjections {};
+    for ( size_t face { 0 }; face < 6; ++face )
+    {
+        viewProjections[face] = XMMatrixLookToLH( position, directions[face], ups[face] ) * projectionMatrix;
+    }
+    return viewProjections;
+}
+
+void ParticleCuller::Begin( const std::vector<FrustumPlanes>& views, float radius, size_t particleCount, size_t chunkSize )
+{
+    m_Views.assign( views.begin(), views.begin() + std::min( views.size(), MaxViews ) );
+    m_Radius        = radius;
+    m_ParticleCount = particleCount;
+
+    m_VisibilityMasks.resize( particleCount );
+
+    const size_t chunkCount { Parallel::GetChunkCount( particleCount, chunkSize ) };
+    for ( size_t view { 0 }; view < m_Views.size(); ++view )
+    {
+        m_ChunkVisibleIndices[view].resize( chunkCount );
+        for ( std::vector<uint32_t>& visibleIndices: m_ChunkVisibleIndices[view] )
+        {
+            visibleIndices.clear();
+        }
+    }
+}
+
+void ParticleCuller::CullChunk( const Particle* particles, size_t chunk, size_t begin, size_t end )
+{
+    const XMVECTOR negativeRadius { XMVectorReplicate( -m_Radius ) };
+    const size_t   viewCount { m_Views.size() };
+
+    for ( size_t i { begin }; i < end; i += 4 )
+    {
+        // Gather 4 positions, the last group is padded with the last particle
+        XMFLOAT4A x {};
+        XMFLOAT4A y {};
+        XMFLOAT4A z {};
+        for ( size_t lane { 0 }; lane < 4; ++lane )
+        {
+            const XMFLOAT3 position { particles[std::min( i + lane, end - 1 )].GetPosition() };
+            ( &x.x )[lane] = position.x;
+            ( &y.x )[lane] = position.y;
+            ( &z.x )[lane] = position.z;
+        }
+        const XMVECTOR positionX { XMLoadFloat4A( &x ) };
+        const XMVECTOR positionY { XMLoadFloat4A( &y ) };
+        const XMVECTOR positionZ { XMLoadFloat4A( &z ) };
+
+        const size_t laneCount { std::min<size_t>( 4, end - i ) };
+        uint8_t      masks[4] {};
+
+        for ( size_t view { 0 }; view < viewCount; ++view )
+        {
+            XMVECTOR isVisible { XMVectorTrueInt() };
+            for ( const XMFLOAT4& plane: m_Views[view].Planes )
+            {
+                const XMVECTOR distance { XMVectorMultiplyAdd( positionX, XMVectorReplicate( plane.x ),
+                                          XMVectorMultiplyAdd( positionY, XMVectorReplicate( plane.y ),
+                                          XMVectorMultiplyAdd( positionZ, XMVectorReplicate( plane.z ), XMVectorReplicate( plane.w ) ) ) ) };
+                isVisible = XMVectorAndInt( isVisible, XMVectorGreater( distance, negativeRadius ) );
+            }
+
+            uint32_t laneVisible[4];
+            XMStoreInt4( laneVisible, isVisible );
+            for ( size_t lane { 0 }; lane < laneCount; ++lane )
+            {
+                if ( laneVisible[lane] )
+                {
+                    masks[lane] |= static_cast<uint8_t>( 1u << view );
+                    m_ChunkVisibleIndices[view][chunk].emplace_back( static_cast<uint32_t>( i + lane ) );
+                }
+            }
+        }
+
+        std::copy( masks, masks + laneCount, m_VisibilityMasks.begin() + i );
+    }
+}
+
+void ParticleCuller::End( Profiler& profiler )
+{
+    ScopedTimer timer { profiler, "Culling/Compact" };
+
+    for ( size_t view { 0 }; view < m_Views.size(); ++view )
+    {
+        const std::vector<std::vector<uint32_t>>& chunkVisibleIndices { m_ChunkVisibleIndices[view] };
+        std::vector<uint32_t>&                    visibleIndices { m_VisibleIndices[view] };
+
+        const size_t chunkCount { chunkVisibleIndices.size() };
+        m_ChunkOffsets.resize( chunkCount );
+        size_t visibleCount { 0 };
+        for ( size_t chunk { 0 }; chunk < chunkCount; ++chunk )
+        {
+            m_ChunkOffsets[chunk] = visibleCount;
+            visibleCount += chunkVisibleIndices[chunk].size();
+        }
+
+        visibleIndices.resize( visibleCount );
+        Parallel::ForEachChunk( chunkCount, 1, [this, &chunkVisibleIndices, &visibleIndices]( size_t chunk, size_t, size_t ) {
+            std::copy( chunkVisibleIndices[chunk].begin(), chunkVisibleIndices[chunk].end(),
+                       visibleIndices.begin() + m_ChunkOffsets[chunk] );
+        } );
+
+        // View 0 is the main camera
+        const std::string prefix { view == 0 ? "Culling/" : "Culling/View" + std::to_string( view ) + "/" };
+        const double      culledRatio { m_ParticleCount == 0 ? 0.0 : 1.0 - static_cast<double>( visibleCount ) / m_ParticleCount };
+        profiler.AddCount( prefix + "Visible", static_cast<double>( visibleCount ) );
+        profiler.AddCount( prefix + "CulledRatio", culledRatio );
+    }
+}
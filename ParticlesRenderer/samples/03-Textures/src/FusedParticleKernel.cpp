@@ -0,0 +1,124 @@
+#include <FusedParticleKernel.h>
+
+#include <FrustumCulling.h>
+#include <InstanceBufferRing.h>
+#include <Particle.h>
+#include <Profiler.h>
+
+#include <cstring>
+
+using namespace DirectX;
+
+PackedParticle* HostPackedParticleTarget::Map( size_t capacity )
+{
+    m_Storage.resize( ( capacity + 1 ) / 2 );
+    m_Count = 0;
+    return reinterpret_cast<PackedParticle*>( m_Storage.data() );
+}
+
+void HostPackedParticleTarget::Unmap( size_t count )
+{
+    m_Count = count;
+}
+
+PackedParticle* RingPackedParticleTarget::Map( size_t capacity )
+{
+    m_Count = 0;
+    return static_cast<PackedParticle*>( m_Ring.Allocate( capacity * sizeof( PackedParticle ) ) );
+}
+
+void FusedParticleKernel::Begin( PackedParticleTarget& target, size_t particleCount, size_t chunkSize, const FrustumPlanes* frustum,
+                                 float radius, const PackedParticleEncoder& encoder )
+{
+    // Every chunk pads at most one block
+    const size_t chunkCount { ( particleCount + chunkSize - 1 ) / chunkSize };
+    m_Capacity = ( ( particleCount + BlockSize - 1 ) / BlockSize + chunkCount ) * BlockSize;
+
+    m_Target      = &target;
+    m_Destination = target.Map( m_Capacity );
+    m_IsCulling   = frustum != nullptr;
+    m_Radius      = radius;
+    m_Encoder     = encoder;
+    if ( frustum )
+    {
+        std::memcpy( m_Planes, frustum->Planes, sizeof( m_Planes ) );
+    }
+
+    m_Cursor.store( 0, std::memory_order_relaxed );
+    m_VisibleCount.store( 0, std::memory_order_relaxed );
+    m_RecordCount = 0;
+}
+
+void FusedParticleKernel::WriteChunk( const Particle* particles, size_t begin, size_t end, float interpolation )
+{
+    alignas( 16 ) PackedParticle block[BlockSize];
+    size_t                       blockCount { 0 };
+    size_t                       visibleCount { 0 };
+
+    for ( size_t i { begin }; i < end; ++i )
+    {
+        const Particle& particle { particles[i] };
+        const XMVECTOR  position { particle.GetInterpolatedPosition( interpolation ) };
+
+        bool isVisible { true };
+        for ( int plane { 0 }; plane < 6 && isVisible && m_IsCulling; ++plane )
+        {
+            isVisible = XMVectorGetX( XMPlaneDotCoord( XMLoadFloat4( &m_Planes[plane] ), position ) ) > -m_Radius;
+        }
+        if ( !isVisible ) continue;
+
+        block[blockCount++] = m_Encoder.Encode( position, particle.GetSize(), particle.GetDeathTick() );
+        ++visibleCount;
+        if ( blockCount == BlockSize )
+        {
+            FlushBlock( block );
+            blockCount = 0;
+        }
+    }
+
+    if ( blockCount > 0 )
+    {
+        std::memset( block + blockCount, 0, ( BlockSize - blockCount ) * sizeof( PackedParticle ) );
+        FlushBlock( block );
+    }
+
+#if defined( _XM_SSE_INTRINSICS_ )
+    // Non-temporal stores are weakly ordered, they must be visible before the update joins
+    _mm_sfence();
+#endif
+    m_VisibleCount.fetch_add( visibleCount, std::memory_order_relaxed );
+}
+
+void FusedParticleKernel::FlushBlock( const PackedParticle* block )
+{
+    const size_t    offset { m_Cursor.fetch_add( BlockSize, std::memory_order_relaxed ) };
+    PackedParticle* destination { m_Destination + offset };
+
+#if defined( _XM_SSE_INTRINSICS_ )
+    if ( reinterpret_cast<uintptr_t>( destination ) % 16 == 0 )
+    {
+        // 2 records per store, whole cache lines go to memory without being read
+        const __m128i* source { reinterpret_cast<const __m128i*>( block ) };
+        __m128i*       target { reinterpret_cast<__m128i*>( destination ) };
+        for ( size_t i { 0 }; i < BlockSize / 2; ++i )
+        {
+            _mm_stream_si128( target + i, _mm_load_si128( source + i ) );
+        }
+        return;
+    }
+#endif
+    std::memcpy( destination, block, BlockSize * sizeof( PackedParticle ) );
+}
+
+size_t FusedParticleKernel::End( Profiler& profiler )
+{
+    m_RecordCount = m_Cursor.load( std::memory_order_relaxed );
+    m_Target->Unmap( m_RecordCount );
+    m_Target = nullptr;
+
+    const size_t visibleCount { m_VisibleCount.load( std::memory_order_relaxed ) };
+    profiler.AddCount( "Fused/Visible", static_cast<double>( visibleCount ) );
+    profiler.AddCount( "Fused/PaddingRecords", static_cast<double>( m_RecordCount - visibleCount ) );
+    profiler.AddCount( "Fused/UploadBytes", static_cast<double>( m_RecordCount * sizeof( PackedParticle ) ) );
+    return m_RecordCount;
+}
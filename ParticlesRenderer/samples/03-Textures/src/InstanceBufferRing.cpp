@@ -0,0 +1,147 @@
+#include <InstanceBufferRing.h>
+
+#include <Profiler.h>
+
+#include <algorithm>
+
+InstanceBufferBackend::Buffer HostInstanceBufferBackend::Create( size_t size )
+{
+    m_Buffers.emplace_back( std::make_unique<uint8_t[]>( size ) );
+    ++m_LiveBufferCount;
+    return Buffer { static_cast<uint32_t>( m_Buffers.size() ), m_Buffers.back().get(), size };
+}
+
+void HostInstanceBufferBackend::Destroy( const Buffer& buffer )
+{
+    m_Buffers[buffer.Id - 1].reset();
+    --m_LiveBufferCount;
+}
+
+uint64_t HostInstanceBufferBackend::Signal()
+{
+    ++m_SignaledValue;
+    if ( m_IsCompletingAutomatically )
+    {
+        m_CompletedValue = m_SignaledValue;
+    }
+    return m_SignaledValue;
+}
+
+void HostInstanceBufferBackend::Wait( uint64_t fenceValue )
+{
+    // Nothing runs the work, waiting is the same as completing it
+    Complete( fenceValue );
+}
+
+void HostInstanceBufferBackend::Complete( uint64_t fenceValue )
+{
+    m_CompletedValue = std::max( m_CompletedValue, std::min( fenceValue, m_SignaledValue ) );
+}
+
+InstanceBufferRing::~InstanceBufferRing()
+{
+    Release();
+}
+
+void InstanceBufferRing::SetBackend( std::unique_ptr<InstanceBufferBackend> backend )
+{
+    Release();
+    m_Backend = std::move( backend );
+}
+
+void* InstanceBufferRing::Allocate( size_t size )
+{
+    Slot& slot { m_Slots[m_CurrentSlot] };
+    if ( !m_Backend->IsComplete( slot.FenceValue ) )
+    {
+        ++m_FenceWaits;
+        m_Backend->Wait( slot.FenceValue );
+    }
+
+    size_t newSize { 0 };
+    if ( size > slot.Storage.Size )
+    {
+        newSize = std::max( { size, slot.Storage.Size * 2, MinSize } );
+        ++m_Grows;
+    }
+    else if ( m_HasShrinkSize && slot.Storage.Size > MinSize && slot.Storage.Size > m_ShrinkSize * 4 )
+    {
+        newSize = std::max( { size, m_ShrinkSize * 2, MinSize } );
+        ++m_Shrinks;
+    }
+
+    // The GPU is done with the old buffer, the fence of the slot was reached
+    if ( newSize > 0 )
+    {
+        if ( slot.Storage.Size > 0 )
+        {
+            m_Backend->Destroy( slot.Storage );
+        }
+        slot.Storage = m_Backend->Create( newSize );
+    }
+
+    slot.UsedSize    = size;
+    m_WindowPeakSize = std::max( m_WindowPeakSize, size );
+    return slot.Storage.Data;
+}
+
+void InstanceBufferRing::Bind( dx12lib::CommandList& commandList, uint32_t rootParameterIndex ) const
+{
+    m_Backend->Bind( commandList, rootParameterIndex, m_Slots[m_CurrentSlot].Storage );
+}
+
+void InstanceBufferRing::EndFrame()
+{
+    if ( !m_Backend ) return;
+
+    m_Slots[m_CurrentSlot].FenceValue = m_Backend->Signal();
+    m_CurrentSlot                     = ( m_CurrentSlot + 1 ) % FramesInFlight;
+
+    if ( ++m_WindowFrames >= ShrinkWindowFrames )
+    {
+        m_ShrinkSize     = m_WindowPeakSize;
+        m_HasShrinkSize  = true;
+        m_WindowPeakSize = 0;
+        m_WindowFrames   = 0;
+    }
+}
+
+void InstanceBufferRing::Report( Profiler& profiler )
+{
+    size_t bytes { 0 };
+    size_t usedBytes { 0 };
+    for ( const Slot& slot: m_Slots )
+    {
+        bytes += slot.Storage.Size;
+        usedBytes += slot.UsedSize;
+    }
+
+    profiler.SetValue( "InstanceRing/Bytes", static_cast<double>( bytes ) );
+    profiler.SetValue( "InstanceRing/UsedBytes", static_cast<double>( usedBytes ) );
+    profiler.AddCount( "InstanceRing/Grows", m_Grows );
+    profiler.AddCount( "InstanceRing/Shrinks", m_Shrinks );
+    profiler.AddCount( "InstanceRing/FenceWaits", m_FenceWaits );
+
+    m_Grows      = 0;
+    m_Shrinks    = 0;
+    m_FenceWaits = 0;
+}
+
+void InstanceBufferRing::Release()
+{
+    if ( !m_Backend ) return;
+
+    for ( Slot& slot: m_Slots )
+    {
+        if ( slot.Storage.Size > 0 )
+        {
+            m_Backend->Wait( slot.FenceValue );
+            m_Backend->Destroy( slot.Storage );
+        }
+        slot = Slot {};
+    }
+    m_CurrentSlot    = 0;
+    m_WindowPeakSize = 0;
+    m_WindowFrames   = 0;
+    m_HasShrinkSize  = false;
+}
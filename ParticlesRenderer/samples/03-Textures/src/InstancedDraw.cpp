@@ -0,0 +1,33 @@
+#include <InstancedDraw.h>
+
+#include <algorithm>
+
+size_t RecordingInstancedDrawBackend::GetCount( CommandType type ) const
+{
+    return static_cast<size_t>( std::count_if( m_Commands.begin(), m_Commands.end(), [type]( const Command& command ) { return command.Type == type; } ) );
+}
+
+size_t RecordingInstancedDrawBackend::GetInstanceCount() const
+{
+    size_t instanceCount { 0 };
+    for ( const Command& command: m_Commands )
+    {
+        if ( command.Type == CommandType::DrawInstanced )
+        {
+            instanceCount += command.Value;
+        }
+    }
+    return instanceCount;
+}
+
+size_t SubmitInstancedDraws( InstancedDrawBackend& backend, size_t instanceCount, size_t maxInstancesPerDraw )
+{
+    size_t drawCount { 0 };
+    for ( size_t offset { 0 }; offset < instanceCount; offset += maxInstancesPerDraw )
+    {
+        backend.SetInstanceOffset( static_cast<uint32_t>( offset ) );
+        backend.DrawInstanced( static_cast<uint32_t>( std::min( maxInstancesPerDraw, instanceCount - offset ) ) );
+        ++drawCount;
+    }
+    return drawCount;
+}
@@ -2,6 +2,8 @@
 
 #include <random>
 
+using namespace DirectX;
+
 float Math::GetRandomInRange( float min, float max )
 {
     std::random_device                    rd {};
@@ -9,4 +11,11 @@ float Math::GetRandomInRange( float min, float max )
     std::uniform_real_distribution<float> dis { min, max };
 
     return dis( gen );
-}
\ No newline at end of file
+}
+void XM_CALLCONV Math::ComputeMatrices(const FXMMATRIX& model, CXMMATRIX view, CXMMATRIX viewProjection, Mat& mat )
+{
+    mat.ModelMatrix                     = model;
+    mat.ModelViewMatrix                 = model * view;
+    mat.InverseTransposeModelViewMatrix = XMMatrixTranspose( XMMatrixInverse( nullptr, mat.ModelViewMatrix ) );
+    mat.ModelViewProjectionMatrix       = model * viewProjection;
+}
@@ -0,0 +1,53 @@
+#include <MeshDispatchPlanner.h>
+
+#include <algorithm>
+
+namespace
+{
+    uint64_t DivideRoundingUp( uint64_t value, uint64_t divisor )
+    {
+        return ( value + divisor - 1 ) / divisor;
+    }
+
+    // Smallest tile of at least groupCount groups in the dimension limit, filled in X first
+    MeshDispatch Tile( uint64_t groupCount, uint64_t maxGroupsPerDimension )
+    {
+        const uint64_t z { DivideRoundingUp( groupCount, maxGroupsPerDimension * maxGroupsPerDimension ) };
+        const uint64_t y { DivideRoundingUp( groupCount, z * maxGroupsPerDimension ) };
+        const uint64_t x { DivideRoundingUp( groupCount, z * y ) };
+
+        MeshDispatch dispatch {};
+        dispatch.X = static_cast<uint32_t>( x );
+        dispatch.Y = static_cast<uint32_t>( y );
+        dispatch.Z = static_cast<uint32_t>( z );
+        return dispatch;
+    }
+}
+
+std::vector<MeshDispatch> PlanMeshDispatches( uint64_t itemCount, uint32_t itemsPerGroup, uint32_t maxGroupsPerDimension,
+                                              uint32_t maxGroupsPerDispatch )
+{
+    std::vector<MeshDispatch> dispatches {};
+    const uint64_t            groupCount { DivideRoundingUp( itemCount, itemsPerGroup ) };
+    const uint64_t            dimension { maxGroupsPerDimension };
+    const uint64_t            maxDispatchGroups { std::min( uint64_t { maxGroupsPerDispatch }, dimension * dimension * dimension ) };
+
+    uint64_t groupOffset { 0 };
+    while ( groupOffset < groupCount )
+    {
+        // The tile can be larger than its groups, fewer groups are taken until it fits in the dispatch limit
+        uint64_t     dispatchGroups { std::min( groupCount - groupOffset, maxDispatchGroups ) };
+        MeshDispatch dispatch { Tile( dispatchGroups, dimension ) };
+        while ( uint64_t { dispatch.X } * dispatch.Y * dispatch.Z > maxDispatchGroups )
+        {
+            dispatchGroups -= uint64_t { dispatch.Y } * dispatch.Z;
+            dispatch = Tile( dispatchGroups, dimension );
+        }
+
+        groupOffset += dispatchGroups;
+        dispatch.Constants = MeshDispatchConstants { static_cast<uint32_t>( groupOffset - dispatchGroups ), dispatch.X, dispatch.Y,
+                                                     static_cast<uint32_t>( std::min( itemCount, groupOffset * itemsPerGroup ) ) };
+        dispatches.emplace_back( dispatch );
+    }
+    return dispatches;
+}
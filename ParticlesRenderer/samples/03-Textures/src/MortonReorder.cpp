@@ -0,0 +1,177 @@
+#include <MortonReorder.h>
+
+#include <Particle.h>
+#include <Profiler.h>
+#include <RadixSort.h>
+
+#include <cfloat>
+
+using namespace DirectX;
+
+namespace
+{
+    // Inserts 2 zero bits between each of the lowest 10 bits.
+    uint32_t SpreadBits( uint32_t value )
+    {
+        value &= 0x3FF;
+        value = ( value | ( value << 16 ) ) & 0x030000FF;
+        value = ( value | ( value << 8 ) ) & 0x0300F00F;
+        value = ( value | ( value << 4 ) ) & 0x030C30C3;
+        value = ( value | ( value << 2 ) ) & 0x09249249;
+        return value;
+    }
+
+    XMVECTOR LoadPosition( const Particle& particle )
+    {
+        const XMFLOAT3 position { particle.GetPosition() };
+        return XMLoadFloat3( &position );
+    }
+}
+
+bool MortonReorder::Update( std::vector<Particle>& particles, Profiler& profiler )
+{
+    switch ( m_Stage )
+    {
+    case Stage::Idle:
+    {
+        if ( m_Interval <= 0 || ++m_FrameCounter < m_Interval || particles.size() < 2 ) return false;
+        m_FrameCounter = 0;
+
+        ScopedTimer timer { profiler, "Reorder/Codes" };
+        ComputeCodes( particles );
+        m_Stage = Stage::Sort;
+        return false;
+    }
+    case Stage::Sort:
+    {
+        ScopedTimer timer { profiler, "Reorder/Sort" };
+        Sort();
+        m_Stage = Stage::Apply;
+        return false;
+    }
+    case Stage::Apply:
+    {
+        m_Stage = Stage::Idle;
+
+        // Particles removed since the codes were computed, the order is not valid anymore
+        if ( particles.size() < m_Order.size() ) return false;
+
+        {
+            ScopedTimer timer { profiler, "Reorder/Apply" };
+            Apply( particles );
+        }
+        profiler.SetValue( "Reorder/NeighbourDistanceBefore", m_NeighbourDistanceBefore );
+        profiler.SetValue( "Reorder/NeighbourDistanceAfter", m_NeighbourDistanceAfter );
+        return true;
+    }
+    }
+    return false;
+}
+
+void MortonReorder::ComputeCodes( const std::vector<Particle>& particles )
+{
+    const size_t count { particles.size() };
+    const size_t chunkCount { Parallel::GetChunkCount( count, m_ChunkSize ) };
+
+    std::vector<XMFLOAT3> chunkMin( chunkCount );
+    std::vector<XMFLOAT3> chunkMax( chunkCount );
+    std::vector<double>   chunkDistance( chunkCount );
+    Parallel::ForEachChunk( count, m_ChunkSize, [&]( size_t chunk, size_t begin, size_t end ) {
+        XMVECTOR boundsMin { XMVectorReplicate( FLT_MAX ) };
+        XMVECTOR boundsMax { XMVectorReplicate( -FLT_MAX ) };
+        XMVECTOR previous { LoadPosition( particles[begin] ) };
+        double   distance { 0.0 };
+        for ( size_t i { begin }; i < end; ++i )
+        {
+            const XMVECTOR position { LoadPosition( particles[i] ) };
+            boundsMin = XMVectorMin( boundsMin, position );
+            boundsMax = XMVectorMax( boundsMax, position );
+            distance += XMVectorGetX( XMVector3Length( position - previous ) );
+            previous = position;
+        }
+        XMStoreFloat3( &chunkMin[chunk], boundsMin );
+        XMStoreFloat3( &chunkMax[chunk], boundsMax );
+        chunkDistance[chunk] = distance;
+    } );
+
+    XMVECTOR boundsMin { XMVectorReplicate( FLT_MAX ) };
+    XMVECTOR boundsMax { XMVectorReplicate( -FLT_MAX ) };
+    double   distance { 0.0 };
+    for ( size_t chunk { 0 }; chunk < chunkCount; ++chunk )
+    {
+        boundsMin = XMVectorMin( boundsMin, XMLoadFloat3( &chunkMin[chunk] ) );
+        boundsMax = XMVectorMax( boundsMax, XMLoadFloat3( &chunkMax[chunk] ) );
+        distance += chunkDistance[chunk];
+    }
+    m_NeighbourDistanceBefore = distance / static_cast<double>( count - 1 );
+
+    // Quantize the positions on a 1024^3 grid covering the particles
+    const float    cellCount { static_cast<float>( ( 1u << m_BitsPerAxis ) - 1 ) };
+    const XMVECTOR extent { XMVectorMax( boundsMax - boundsMin, XMVectorReplicate( FLT_EPSILON ) ) };
+    const XMVECTOR scale { XMVectorReplicate( cellCount ) / extent };
+
+    m_Codes.resize( count );
+    m_Order.resize( count );
+    Parallel::ForEachChunk( count, m_ChunkSize, [&]( size_t, size_t begin, size_t end ) {
+        for ( size_t i { begin }; i < end; ++i )
+        {
+            XMFLOAT3 cell {};
+            XMStoreFloat3( &cell, XMVectorClamp( ( LoadPosition( particles[i] ) - boundsMin ) * scale, XMVectorZero(),
+                                                 XMVectorReplicate( cellCount ) ) );
+            m_Codes[i] = SpreadBits( static_cast<uint32_t>( cell.x ) ) | ( SpreadBits( static_cast<uint32_t>( cell.y ) ) << 1 ) |
+                         ( SpreadBits( static_cast<uint32_t>( cell.z ) ) << 2 );
+            m_Order[i] = static_cast<uint32_t>( i );
+        }
+    } );
+}
+
+void MortonReorder::Sort()
+{
+    Parallel::RadixSort( m_Codes, m_Order, m_TempCodes, m_TempOrder, m_BitsPerAxis * 3 );
+}
+
+void MortonReorder::Apply( std::vector<Particle>& particles )
+{
+    // Particles added since the codes were computed keep their place at the end
+    const size_t sortedCount { m_Order.size() };
+    const size_t chunkCount { Parallel::GetChunkCount( sortedCount, m_ChunkSize ) };
+
+    std::vector<double> chunkDistance( chunkCount );
+    Parallel::ForEachChunk( sortedCount, m_ChunkSize, [&]( size_t chunk, size_t begin, size_t end ) {
+        double distance { 0.0 };
+        for ( size_t i { begin + 1 }; i < end; ++i )
+        {
+            distance += XMVectorGetX( XMVector3Length( LoadPosition( particles[m_Order[i]] ) - LoadPosition( particles[m_Order[i - 1]] ) ) );
+        }
+        chunkDistance[chunk] = distance;
+    } );
+
+    double distance { 0.0 };
+    for ( const double value: chunkDistance )
+    {
+        distance += value;
+    }
+    m_NeighbourDistanceAfter = distance / static_cast<double>( sortedCount - 1 );
+
+    // Follows every cycle of the order, each particle is moved once and only one particle is held aside
+    m_IsMoved.assign( sortedCount, false );
+    for ( size_t start { 0 }; start < sortedCount; ++start )
+    {
+        if ( m_IsMoved[start] ) continue;
+
+        Particle held { std::move( particles[start] ) };
+        size_t   destination { start };
+        for ( ;; )
+        {
+            m_IsMoved[destination] = true;
+            const size_t source { m_Order[destination] };
+            if ( source == start )
+            {
+                particles[destination] = std::move( held );
+                break;
+            }
+            particles[destination] = std::move( particles[source] );
+            destination            = source;
+        }
+    }
+}
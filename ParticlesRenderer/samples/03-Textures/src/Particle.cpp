@@ -1,9 +1,5 @@
 #include "Particle.h"
 
-#include "dx12lib/Material.h"
-#include <TestApplication.h>
-#include "dx12lib/Helpers.h"
-
 
 Particle::Particle(Vec3 startPos, float size) :
     m_Size { size },
@@ -11,6 +7,7 @@ Particle::Particle(Vec3 startPos, float size) :
 {
     m_PositionMatrix = DirectX::XMMatrixTranslation( startPos.X, startPos.Y, startPos.Z );
     m_ScaleMatrix = DirectX::XMMatrixScaling( m_Size, m_Size, m_Size );
+    m_PreviousPosition = DirectX::XMFLOAT3 { startPos.X, startPos.Y, startPos.Z };
 
     m_Direction.X = Math::GetRandomInRange( -1, 1 );
     m_Direction.Y = Math::GetRandomInRange( -1, 1 );
@@ -24,22 +21,38 @@ Particle::Particle(Vec3 startPos, float size) :
     m_perpendicularSpeed = Math::GetRandomInRange( 0.25f, 2.25f );
 }
 
-void Particle::Update(float deltaTime, const Camera& camera, bool isAccelerationEnabled, bool isPerpendicularEnabled)
+void Particle::Update(float deltaTime, bool isAccelerationEnabled, bool isPerpendicularEnabled)
 {
-    Translate( deltaTime );   
+    m_PreviousPosition = GetPosition();
+    Translate( deltaTime );
+
+    if (!isAccelerationEnabled) return;
+    Accelerate( deltaTime );
+
+    if (!isPerpendicularEnabled) return;
+    MovePerpendicular(deltaTime);
+}
+
+void Particle::UpdateMatrices( const Camera& camera, float interpolation )
+{
+    DirectX::XMMATRIX positionMatrix { m_PositionMatrix };
+    positionMatrix.r[3] = GetInterpolatedPosition( interpolation );
+
     DirectX::XMMATRIX rotationMatrix { DirectX::XMMatrixIdentity() };
-    DirectX::XMMATRIX worldMatrix { m_ScaleMatrix * rotationMatrix * m_PositionMatrix };
+    DirectX::XMMATRIX worldMatrix { m_ScaleMatrix * rotationMatrix * positionMatrix };
 
     DirectX::XMMATRIX viewMatrix { camera.get_ViewMatrix() };
     DirectX::XMMATRIX viewProjectionMatrix { viewMatrix * camera.get_ProjectionMatrix() };
 
     Math::ComputeMatrices( worldMatrix, viewMatrix, viewProjectionMatrix, m_Matrices );
+}
 
-    if (!isAccelerationEnabled) return;
-    Accelerate( deltaTime );
+DirectX::XMVECTOR Particle::GetInterpolatedPosition( float interpolation ) const
+{
+    if ( interpolation >= 1.0f ) return m_PositionMatrix.r[3];
 
-    if (!isPerpendicularEnabled) return;
-    MovePerpendicular(deltaTime);
+    const DirectX::XMVECTOR previousPosition { DirectX::XMVectorSet( m_PreviousPosition.x, m_PreviousPosition.y, m_PreviousPosition.z, 1.0f ) };
+    return DirectX::XMVectorLerp( previousPosition, m_PositionMatrix.r[3], interpolation );
 }
 
 DirectX::XMFLOAT3 Particle::GetPosition() const
@@ -49,12 +62,35 @@ DirectX::XMFLOAT3 Particle::GetPosition() const
     return position;
 }
 
+void Particle::SetPosition( const DirectX::XMFLOAT3& position )
+{
+    m_PositionMatrix.r[3] = DirectX::XMVectorSet( position.x, position.y, position.z, 1.0f );
+}
+
+void Particle::RemoveInwardMotion( const DirectX::XMFLOAT3& normal )
+{
+    //the direction keeps its part along the surface, the perpendicular motion oscillates so it loses its normal part
+    const float directionDot { m_Direction.X * normal.x + m_Direction.Y * normal.y + m_Direction.Z * normal.z };
+    if ( directionDot < 0.0f )
+    {
+        m_Direction.X -= normal.x * directionDot;
+        m_Direction.Y -= normal.y * directionDot;
+        m_Direction.Z -= normal.z * directionDot;
+    }
+
+    const float perpendicularDot { m_PerpendicularDirection.X * normal.x + m_PerpendicularDirection.Y * normal.y +
+                                   m_PerpendicularDirection.Z * normal.z };
+    m_PerpendicularDirection.X -= normal.x * perpendicularDot;
+    m_PerpendicularDirection.Y -= normal.y * perpendicularDot;
+    m_PerpendicularDirection.Z -= normal.z * perpendicularDot;
+}
+
 void Particle::Translate(float deltaTime)
 {
     const float offset { m_Speed * deltaTime };
-    const float offsetX { m_Direction.X * offset };
-    const float offsetY { m_Direction.Y * offset };
-    const float offsetZ { m_Direction.Z * offset };
+    const float offsetX { m_Direction.X * offset + m_Velocity.x * deltaTime };
+    const float offsetY { m_Direction.Y * offset + m_Velocity.y * deltaTime };
+    const float offsetZ { m_Direction.Z * offset + m_Velocity.z * deltaTime };
 
     const DirectX::XMMATRIX translationMatrix { DirectX::XMMatrixTranslation( offsetX, offsetY, offsetZ ) };
 
@@ -69,9 +105,9 @@ void Particle::Accelerate( float deltaTime )
 void Particle::MovePerpendicular( float deltaTime )
 {
     m_AccumulatedPerpendicularTime += deltaTime;
-    if (m_AccumulatedPerpendicularTime >= Math::PI * 2)
+    if (m_AccumulatedPerpendicularTime >= DirectX::XM_2PI)
     {
-        m_AccumulatedPerpendicularTime -= Math::PI * 2;
+        m_AccumulatedPerpendicularTime -= DirectX::XM_2PI;
     }
 
     const float offset { sinf(m_AccumulatedPerpendicularTime) * m_perpendicularSpeed * deltaTime};
@@ -0,0 +1,157 @@
+#include <ParticleBudget.h>
+
+#include <Camera.h>
+#include <FrustumCulling.h>
+#include <ParticleSystem.h>
+#include <Profiler.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+void ParticleBudgetManager::Register( ParticleSystem& system, std::string name, int priority )
+{
+    m_Entries.emplace_back( Entry { &system, std::move( name ), priority } );
+}
+
+void ParticleBudgetManager::Unregister( const ParticleSystem& system )
+{
+    m_Entries.erase( std::remove_if( m_Entries.begin(), m_Entries.end(),
+                                     [&system]( const Entry& entry ) { return entry.System == &system; } ),
+                     m_Entries.end() );
+}
+
+void ParticleBudgetManager::Update( const Camera& camera, Profiler& profiler )
+{
+    if ( m_Entries.empty() ) return;
+
+    ScopedTimer timer { profiler, "Budget/Update" };
+
+    UpdateCost();
+    m_EffectiveBudget = m_Budget.MaxParticles;
+    if ( m_Budget.MaxUpdateMilliseconds > 0.0 && m_MillisecondsPerParticle > 0.0 )
+    {
+        const double timeLimitedParticles { m_Budget.MaxUpdateMilliseconds / m_MillisecondsPerParticle };
+        m_EffectiveBudget = std::min( m_EffectiveBudget, static_cast<size_t>( timeLimitedParticles ) );
+    }
+    if ( m_Budget.MaxOverdraw > 0.0 && m_OverdrawPerParticle > 0.0 )
+    {
+        const double overdrawLimitedParticles { m_Budget.MaxOverdraw / m_OverdrawPerParticle };
+        m_EffectiveBudget = std::min( m_EffectiveBudget, static_cast<size_t>( overdrawLimitedParticles ) );
+    }
+
+    const FrustumPlanes view { FrustumPlanes::FromViewProjection( camera.get_ViewMatrix() * camera.get_ProjectionMatrix() ) };
+    m_Report.resize( m_Entries.size() );
+    for ( size_t i { 0 }; i < m_Entries.size(); ++i )
+    {
+        const Entry& entry { m_Entries[i] };
+        Allocation&  allocation { m_Report[i] };
+        allocation.Name               = entry.Name;
+        allocation.Priority           = entry.Priority;
+        allocation.Weight             = ComputeWeight( entry, camera, view );
+        allocation.Requested          = entry.System->GetRequestedParticleCount();
+        allocation.ParticleCount      = entry.System->GetParticleCount();
+        allocation.UpdateMilliseconds = entry.System->GetLastUpdateMilliseconds();
+        allocation.Overdraw           = entry.System->GetCoverage().GetAverageOverdraw();
+    }
+
+    Distribute();
+
+    const size_t maxGrowth { std::max( size_t { 1 }, static_cast<size_t>( static_cast<double>( m_EffectiveBudget ) * m_MaxGrowthPerFrame ) ) };
+    for ( size_t i { 0 }; i < m_Entries.size(); ++i )
+    {
+        const Allocation& allocation { m_Report[i] };
+        m_Entries[i].System->SetParticleCapacity( std::min( allocation.Allocated, allocation.ParticleCount + maxGrowth ) );
+
+        profiler.AddCount( "Budget/" + allocation.Name + "/Requested", static_cast<double>( allocation.Requested ) );
+        profiler.AddCount( "Budget/" + allocation.Name + "/Allocated", static_cast<double>( allocation.Allocated ) );
+        profiler.AddCount( "Budget/" + allocation.Name + "/Weight", allocation.Weight );
+        profiler.AddCount( "Budget/" + allocation.Name + "/Overdraw", allocation.Overdraw );
+    }
+    profiler.AddCount( "Budget/EffectiveBudget", static_cast<double>( m_EffectiveBudget ) );
+    profiler.SetValue( "Budget/MillisecondsPerMillionParticles", m_MillisecondsPerParticle * 1000000.0 );
+    profiler.SetValue( "Budget/OverdrawPerMillionParticles", m_OverdrawPerParticle * 1000000.0 );
+}
+
+void ParticleBudgetManager::UpdateCost()
+{
+    double milliseconds { 0.0 };
+    double overdraw { 0.0 };
+    size_t particles { 0 };
+    for ( const Entry& entry: m_Entries )
+    {
+        milliseconds += entry.System->GetLastUpdateMilliseconds();
+        overdraw += entry.System->GetCoverage().GetAverageOverdraw();
+        particles += entry.System->GetParticleCount();
+    }
+    if ( particles == 0 ) return;
+
+    const auto smooth = []( double& smoothed, double value ) {
+        if ( value <= 0.0 ) return;
+        smoothed = smoothed > 0.0 ? smoothed + ( value - smoothed ) * m_CostSmoothing : value;
+    };
+    smooth( m_MillisecondsPerParticle, milliseconds / static_cast<double>( particles ) );
+    smooth( m_OverdrawPerParticle, overdraw / static_cast<double>( particles ) );
+}
+
+float ParticleBudgetManager::ComputeWeight( const Entry& entry, const Camera& camera, const FrustumPlanes& view ) const
+{
+    const BoundingSphere sphere { entry.System->GetBoundingSphere() };
+    const float          centerDistance { XMVectorGetX( XMVector3Length( XMLoadFloat3( &sphere.Center ) - camera.get_Translation() ) ) };
+    const float          distance { std::max( centerDistance - sphere.Radius, 0.0f ) };
+
+    const float visibility { view.Contains( entry.System->GetBounds() ) == DISJOINT ? m_HiddenWeight : 1.0f };
+    return std::exp2( static_cast<float>( entry.Priority ) ) * visibility * m_ReferenceDistance / ( m_ReferenceDistance + distance );
+}
+
+void ParticleBudgetManager::Distribute()
+{
+    // Systems asking for less than their share are served first, what they leave is shared again between the others
+    m_Pending.clear();
+    for ( size_t i { 0 }; i < m_Report.size(); ++i )
+    {
+        m_Report[i].Allocated = 0;
+        if ( m_Report[i].Requested > 0 )
+        {
+            m_Pending.emplace_back( i );
+        }
+    }
+
+    size_t remaining { m_EffectiveBudget };
+    while ( !m_Pending.empty() )
+    {
+        double totalWeight { 0.0 };
+        for ( const size_t i: m_Pending )
+        {
+            totalWeight += m_Report[i].Weight;
+        }
+
+        size_t served { 0 };
+        for ( const size_t i: m_Pending )
+        {
+            Allocation&  allocation { m_Report[i] };
+            const double share { static_cast<double>( remaining ) * allocation.Weight / totalWeight };
+            if ( static_cast<double>( allocation.Requested ) <= share )
+            {
+                allocation.Allocated = allocation.Requested;
+                served += allocation.Requested;
+            }
+        }
+
+        if ( served == 0 )
+        {
+            for ( const size_t i: m_Pending )
+            {
+                Allocation& allocation { m_Report[i] };
+                allocation.Allocated = static_cast<size_t>( static_cast<double>( remaining ) * allocation.Weight / totalWeight );
+            }
+            return;
+        }
+
+        remaining -= served;
+        m_Pending.erase( std::remove_if( m_Pending.begin(), m_Pending.end(),
+                                         [this]( size_t i ) { return m_Report[i].Allocated > 0; } ),
+                         m_Pending.end() );
+    }
+}
@@ -0,0 +1,227 @@
+#include <ParticleInstances.h>
+
+#include <Camera.h>
+#include <FrustumCulling.h>
+#include <ParallelFor.h>
+#include <Particle.h>
+#include <Profiler.h>
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace DirectX;
+
+size_t ParticleInstances::Add( const Placement& placement )
+{
+    m_Placements.emplace_back( placement );
+    return m_Placements.size() - 1;
+}
+
+void ParticleInstances::Set( size_t index, const Placement& placement )
+{
+    m_Placements[index] = placement;
+}
+
+void ParticleInstances::Clear()
+{
+    m_Placements.clear();
+    m_Snapshots.clear();
+    m_Matrices.clear();
+}
+
+void ParticleInstances::Update( const std::vector<Particle>& particles, float deltaTime, const Camera& camera, float cullingRadius,
+                                Profiler& profiler )
+{
+    m_Matrices.clear();
+    if ( m_Placements.empty() ) return;
+
+    {
+        ScopedTimer timer { profiler, "Instancing/Record" };
+        Record( particles, deltaTime );
+    }
+
+    ScopedTimer timer { profiler, "Instancing/CullPack" };
+
+    // Placements outside the frustum are dropped as a whole, the others are split in tasks
+    const XMMATRIX      viewProjectionMatrix { camera.get_ViewMatrix() * camera.get_ProjectionMatrix() };
+    const FrustumPlanes frustum { FrustumPlanes::FromViewProjection( viewProjectionMatrix ) };
+    m_VisiblePlacements.clear();
+    m_Tasks.clear();
+    for ( const Placement& placement: m_Placements )
+    {
+        const Snapshot& snapshot { FindSnapshot( placement.TimeOffset ) };
+        const XMMATRIX  transform { XMLoadFloat4x4( &placement.Transform ) };
+
+        BoundingBox localBounds { snapshot.Bounds };
+        localBounds.Extents.x += cullingRadius;
+        localBounds.Extents.y += cullingRadius;
+        localBounds.Extents.z += cullingRadius;
+        BoundingBox bounds {};
+        localBounds.Transform( bounds, transform );
+        const ContainmentType containment { frustum.Contains( bounds ) };
+        if ( containment == DISJOINT || snapshot.Particles.empty() ) continue;
+
+        // The frustum planes in the space of the placement, where the particles were simulated
+        VisiblePlacement& visible { m_VisiblePlacements.emplace_back() };
+        visible.Source    = &snapshot;
+        visible.Transform = transform * viewProjectionMatrix;
+        visible.IsCulled  = containment == INTERSECTS;
+        const XMMATRIX planeTransform { XMMatrixTranspose( transform ) };
+        for ( int i { 0 }; i < 6; ++i )
+        {
+            XMStoreFloat4( &visible.Planes[i], XMPlaneNormalize( XMPlaneTransform( XMLoadFloat4( &frustum.Planes[i] ), planeTransform ) ) );
+        }
+
+        const uint32_t placementIndex { static_cast<uint32_t>( m_VisiblePlacements.size() - 1 ) };
+        const size_t   count { snapshot.Particles.size() };
+        for ( size_t begin { 0 }; begin < count; begin += m_TaskSize )
+        {
+            m_Tasks.emplace_back( Task { placementIndex, static_cast<uint32_t>( begin ), static_cast<uint32_t>( std::min( begin + m_TaskSize, count ) ) } );
+        }
+    }
+
+    // Every task culls its range into its own list
+    m_TaskVisibleIndices.resize( m_Tasks.size() );
+    Parallel::ForEachChunk( m_Tasks.size(), 1, [this, cullingRadius]( size_t taskIndex, size_t, size_t ) {
+        const Task&             task { m_Tasks[taskIndex] };
+        const VisiblePlacement& placement { m_VisiblePlacements[task.Placement] };
+        std::vector<uint32_t>&  visibleIndices { m_TaskVisibleIndices[taskIndex] };
+        visibleIndices.clear();
+
+        for ( uint32_t i { task.Begin }; i < task.End; ++i )
+        {
+            const XMFLOAT4& particle { placement.Source->Particles[i] };
+            bool            isVisible { true };
+            for ( int plane { 0 }; plane < 6 && isVisible && placement.IsCulled; ++plane )
+            {
+                const XMFLOAT4& p { placement.Planes[plane] };
+                isVisible = p.x * particle.x + p.y * particle.y + p.z * particle.z + p.w > -cullingRadius;
+            }
+            if ( isVisible )
+            {
+                visibleIndices.emplace_back( i );
+            }
+        }
+    } );
+
+    size_t visibleCount { 0 };
+    m_TaskOffsets.resize( m_Tasks.size() );
+    for ( size_t task { 0 }; task < m_Tasks.size(); ++task )
+    {
+        m_TaskOffsets[task] = visibleCount;
+        visibleCount += m_TaskVisibleIndices[task].size();
+    }
+
+    // Every task packs its visible particles at its offset
+    m_Matrices.resize( visibleCount );
+    Parallel::ForEachChunk( m_Tasks.size(), 1, [this]( size_t taskIndex, size_t, size_t ) {
+        const VisiblePlacement& placement { m_VisiblePlacements[m_Tasks[taskIndex].Placement] };
+        XMMATRIX*               matrices { m_Matrices.data() + m_TaskOffsets[taskIndex] };
+        for ( const uint32_t i: m_TaskVisibleIndices[taskIndex] )
+        {
+            const XMFLOAT4& particle { placement.Source->Particles[i] };
+            *matrices++ = XMMatrixScaling( particle.w, particle.w, particle.w ) * XMMatrixTranslation( particle.x, particle.y, particle.z ) *
+                          placement.Transform;
+        }
+    } );
+
+    profiler.AddCount( "Instancing/Placements", static_cast<double>( m_Placements.size() ) );
+    profiler.AddCount( "Instancing/VisiblePlacements", static_cast<double>( m_VisiblePlacements.size() ) );
+    profiler.AddCount( "Instancing/Snapshots", static_cast<double>( m_Snapshots.size() ) );
+    profiler.AddCount( "Instancing/Drawn", static_cast<double>( visibleCount ) );
+}
+
+void ParticleInstances::Record( const std::vector<Particle>& particles, float deltaTime )
+{
+    float maxTimeOffset { 0.0f };
+    for ( const Placement& placement: m_Placements )
+    {
+        maxTimeOffset = std::max( maxTimeOffset, placement.TimeOffset );
+    }
+
+    // The youngest snapshot at least as old as the largest offset is still needed, the older ones are reused
+    float youngestNeededAge { FLT_MAX };
+    for ( Snapshot& snapshot: m_Snapshots )
+    {
+        snapshot.Age += deltaTime;
+        if ( snapshot.Age >= maxTimeOffset )
+        {
+            youngestNeededAge = std::min( youngestNeededAge, snapshot.Age );
+        }
+    }
+
+    Snapshot* target { nullptr };
+    for ( Snapshot& snapshot: m_Snapshots )
+    {
+        if ( maxTimeOffset <= 0.0f || snapshot.Age > youngestNeededAge )
+        {
+            target = &snapshot;
+            break;
+        }
+    }
+    if ( !target )
+    {
+        if ( m_Snapshots.size() < m_MaxSnapshots )
+        {
+            target = &m_Snapshots.emplace_back();
+        }
+        else
+        {
+            target = &*std::max_element( m_Snapshots.begin(), m_Snapshots.end(),
+                                         []( const Snapshot& a, const Snapshot& b ) { return a.Age < b.Age; } );
+        }
+    }
+
+    const size_t count { particles.size() };
+    const size_t chunkCount { Parallel::GetChunkCount( count, m_TaskSize ) };
+    target->Particles.resize( count );
+    target->Age = 0.0f;
+
+    std::vector<XMFLOAT3> chunkMin( chunkCount );
+    std::vector<XMFLOAT3> chunkMax( chunkCount );
+    Parallel::ForEachChunk( count, m_TaskSize, [&]( size_t chunk, size_t begin, size_t end ) {
+        XMVECTOR boundsMin { XMVectorReplicate( FLT_MAX ) };
+        XMVECTOR boundsMax { XMVectorReplicate( -FLT_MAX ) };
+        for ( size_t i { begin }; i < end; ++i )
+        {
+            const XMFLOAT3 position { particles[i].GetPosition() };
+            target->Particles[i] = XMFLOAT4 { position.x, position.y, position.z, particles[i].GetSize() };
+            boundsMin            = XMVectorMin( boundsMin, XMLoadFloat3( &position ) );
+            boundsMax            = XMVectorMax( boundsMax, XMLoadFloat3( &position ) );
+        }
+        XMStoreFloat3( &chunkMin[chunk], boundsMin );
+        XMStoreFloat3( &chunkMax[chunk], boundsMax );
+    } );
+
+    XMVECTOR boundsMin { XMVectorReplicate( FLT_MAX ) };
+    XMVECTOR boundsMax { XMVectorReplicate( -FLT_MAX ) };
+    for ( size_t chunk { 0 }; chunk < chunkCount; ++chunk )
+    {
+        boundsMin = XMVectorMin( boundsMin, XMLoadFloat3( &chunkMin[chunk] ) );
+        boundsMax = XMVectorMax( boundsMax, XMLoadFloat3( &chunkMax[chunk] ) );
+    }
+    if ( count == 0 )
+    {
+        boundsMin = boundsMax = XMVectorZero();
+    }
+    BoundingBox::CreateFromPoints( target->Bounds, boundsMin, boundsMax );
+}
+
+const ParticleInstances::Snapshot& ParticleInstances::FindSnapshot( float timeOffset ) const
+{
+    // The youngest snapshot at least as old as the offset, or the oldest one while the history is filling
+    const Snapshot* found { nullptr };
+    const Snapshot* oldest { &m_Snapshots.front() };
+    for ( const Snapshot& snapshot: m_Snapshots )
+    {
+        if ( snapshot.Age >= timeOffset && ( !found || snapshot.Age < found->Age ) )
+        {
+            found = &snapshot;
+        }
+        if ( snapshot.Age > oldest->Age )
+        {
+            oldest = &snapshot;
+        }
+    }
+    return found ? *found : *oldest;
+}
@@ -0,0 +1,119 @@
+#include <ParticlePacker.h>
+
+#include <ParallelFor.h>
+#include <Particle.h>
+#include <Profiler.h>
+
+#include <DirectXPackedVector.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+PackedParticleEncoder::PackedParticleEncoder( float maxScale, const BoundingBox& bounds, FXMMATRIX viewProjectionMatrix,
+                                              uint64_t currentTick, uint64_t maxLifetimeTicks ) :
+    m_CurrentTick { currentTick },
+    m_MaxLifetimeTicks { maxLifetimeTicks }
+{
+    const XMVECTOR extent { XMVectorMax( XMLoadFloat3( &bounds.Extents ) * 2.0f, XMVectorReplicate( FLT_EPSILON ) ) };
+    m_BoundsMin     = XMLoadFloat3( &bounds.Center ) - XMLoadFloat3( &bounds.Extents );
+    m_InverseExtent = XMVectorReciprocal( extent );
+
+    m_Header.ViewProjection = viewProjectionMatrix;
+    m_Header.MaxScale       = std::max( maxScale, FLT_EPSILON );
+    XMStoreFloat3( &m_Header.BoundsMin, m_BoundsMin );
+    XMStoreFloat3( &m_Header.BoundsStep, extent / 65535.0f );
+
+    m_SizeFactor = 255.0f / m_Header.MaxScale;
+    m_LifeFactor = maxLifetimeTicks > 0 ? 255.0f / static_cast<float>( maxLifetimeTicks ) : 0.0f;
+}
+
+PackedParticle PackedParticleEncoder::Encode( FXMVECTOR position, float scale, uint64_t deathTick ) const
+{
+    // Normalized position in the bounds, scaled, clamped and rounded to 16 bits on the 4 lanes at once
+    PackedVector::XMUSHORTN4 normalized {};
+    PackedVector::XMStoreUShortN4( &normalized, XMVectorSetW( ( position - m_BoundsMin ) * m_InverseExtent, 0.0f ) );
+
+    const float life { m_MaxLifetimeTicks > 0 && deathTick > m_CurrentTick
+                       ? static_cast<float>( deathTick - m_CurrentTick ) * m_LifeFactor
+                       : ( m_MaxLifetimeTicks > 0 ? 0.0f : 255.0f ) };
+
+    PackedParticle packed {};
+    packed.X    = normalized.x;
+    packed.Y    = normalized.y;
+    packed.Z    = normalized.z;
+    packed.Size = static_cast<uint8_t>( std::min( scale * m_SizeFactor + 0.5f, 255.0f ) );
+    packed.Life = static_cast<uint8_t>( std::min( life + 0.5f, 255.0f ) );
+    return packed;
+}
+
+void ParticlePacker::Pack( const std::vector<Particle>& particles, const std::vector<uint32_t>& drawList, const float* scales,
+                           float maxScale, const BoundingBox& bounds, FXMMATRIX viewProjectionMatrix, uint64_t currentTick,
+                           uint64_t maxLifetimeTicks, Profiler& profiler )
+{
+    ScopedTimer timer { profiler, "Packing/Pack" };
+
+    m_Encoder = PackedParticleEncoder { maxScale, bounds, viewProjectionMatrix, currentTick, maxLifetimeTicks };
+
+    m_Particles.resize( drawList.size() );
+    Parallel::ForEachChunk( drawList.size(), m_ChunkSize, [&]( size_t, size_t begin, size_t end ) {
+        for ( size_t i { begin }; i < end; ++i )
+        {
+            const uint32_t  index { drawList[i] };
+            const Particle& particle { particles[index] };
+            m_Particles[i] = m_Encoder.Encode( particle.GetRenderPosition(), particle.GetSize() * ( scales ? scales[index] : 1.0f ),
+                                               particle.GetDeathTick() );
+        }
+    } );
+
+    profiler.AddCount( "Packing/UploadBytes", static_cast<double>( m_Particles.size() * sizeof( PackedParticle ) ) );
+    profiler.AddCount( "Packing/MatrixBytes", static_cast<double>( m_Particles.size() * sizeof( XMMATRIX ) ) );
+}
+
+void ParticlePacker::Validate( const std::vector<Particle>& particles, const std::vector<uint32_t>& drawList, const float* scales,
+                               Profiler& profiler ) const
+{
+    ScopedTimer timer { profiler, "Packing/Validate" };
+
+    const size_t       chunkCount { Parallel::GetChunkCount( m_Particles.size(), m_ChunkSize ) };
+    std::vector<float> chunkPositionError( chunkCount );
+    std::vector<float> chunkScaleError( chunkCount );
+    Parallel::ForEachChunk( m_Particles.size(), m_ChunkSize, [&]( size_t chunk, size_t begin, size_t end ) {
+        XMVECTOR positionError { XMVectorZero() };
+        float    scaleError { 0.0f };
+        for ( size_t i { begin }; i < end; ++i )
+        {
+            const uint32_t  index { drawList[i] };
+            const Particle& particle { particles[index] };
+
+            float          scale { 0.0f };
+            const XMVECTOR position { Decode( m_Particles[i], m_Encoder.GetHeader(), scale ) };
+            positionError = XMVectorMax( positionError, XMVectorAbs( position - particle.GetRenderPosition() ) );
+            scaleError    = std::max( scaleError, std::abs( scale - particle.GetSize() * ( scales ? scales[index] : 1.0f ) ) );
+        }
+
+        // Largest error in steps of every axis
+        XMFLOAT3 stepError {};
+        XMStoreFloat3( &stepError, positionError / XMLoadFloat3( &m_Encoder.GetHeader().BoundsStep ) );
+        chunkPositionError[chunk] = std::max( { stepError.x, stepError.y, stepError.z } );
+        chunkScaleError[chunk]    = scaleError;
+    } );
+
+    const float positionError { chunkPositionError.empty() ? 0.0f : *std::max_element( chunkPositionError.begin(), chunkPositionError.end() ) };
+    const float scaleError { chunkScaleError.empty() ? 0.0f : *std::max_element( chunkScaleError.begin(), chunkScaleError.end() ) };
+
+    // Rounding keeps the error under half a step, more means the bounds did not contain a particle
+    profiler.SetValue( "Packing/MaxPositionErrorInSteps", positionError );
+    profiler.SetValue( "Packing/MaxScaleError", scaleError );
+    profiler.AddCount( "Packing/OutOfPrecision", positionError > 0.5f + 1e-3f ? 1.0 : 0.0 );
+}
+
+XMVECTOR ParticlePacker::Decode( const PackedParticle& particle, const PackedParticleHeader& header, float& scale )
+{
+    scale = static_cast<float>( particle.Size ) / 255.0f * header.MaxScale;
+
+    const XMVECTOR steps { XMVectorSet( static_cast<float>( particle.X ), static_cast<float>( particle.Y ), static_cast<float>( particle.Z ), 0.0f ) };
+    return XMVectorSetW( XMLoadFloat3( &header.BoundsMin ) + steps * XMLoadFloat3( &header.BoundsStep ), 1.0f );
+}
@@ -10,9 +10,21 @@
 #include "dx12lib/Material.h"
 #include "dx12lib/StructuredBuffer.h"
 
+#include <CommandListInstancedDrawBackend.h>
+#include <MeshDispatchPlanner.h>
+#include <ParallelFor.h>
+#include <Profiler.h>
+#include <SignedDistanceField.h>
+
+#include <cfloat>
+#include <cmath>
+#include <chrono>
+#include <cstring>
 #include <execution>
 
-ParticleSystem::ParticleSystem(float particleSize, bool isAccelerationEnabled, bool isPerpendicularEnabled) :
+ParticleSystem::ParticleSystem(float particleSize, bool isAccelerationEnabled, bool isPerpendicularEnabled, float particleLifetime, ExpirationMode expirationMode) :
+    m_ParticleLifetime { particleLifetime },
+    m_ExpirationMode { expirationMode },
     m_ParticlesSize { particleSize },
     m_IsAccelerationEnabled { isAccelerationEnabled },
     m_IsPerpendicularEnabled { isPerpendicularEnabled }
@@ -32,79 +44,594 @@ void ParticleSystem::Initialize( dx12lib::CommandList& commandList )
     m_DefaultTexture = commandList.LoadTextureFromFile( L"Assets/Textures/explosion.tga", true );
 }
 
-void ParticleSystem::Update( float deltaTime, const Camera& camera, FPSCounter& fpsCounter, const MemoryCounter& memCounter)
+void ParticleSystem::Update( float deltaTime, const Camera& camera, FPSCounter& fpsCounter, const MemoryCounter& memCounter, Profiler& profiler )
 {
-    std::for_each
-    ( 
-        std::execution::par,
-        m_Particles.begin(),
-        m_Particles.end(),
-        [this, deltaTime, &camera]( Particle& particle ) 
+    const auto updateStart { std::chrono::high_resolution_clock::now() };
+
+    if ( m_InstanceRing.HasBackend() )
+    {
+        m_InstanceRing.Report( profiler );
+    }
+
+    ExpireParticles( deltaTime, profiler );
+    SpawnParticles( profiler );
+
+    //moves the particles, done before the update so the culled indices stay valid
+    if ( m_Reorder.Update( m_Particles, profiler ) )
+    {
+        UpdateParticleIndices();
+        m_DepthSort.Invalidate();
+    }
+
+    {
+        ScopedTimer updateTimer { profiler, "ParticleSystem/Update" };
+
+        //a system outside every view skips the particle culling and everything after it, an instanced system
+        //is culled per placement instead
+        const DirectX::ContainmentType systemVisibility { m_Instances.IsEmpty() ? GetSystemVisibility( camera ) : DirectX::DISJOINT };
+        const bool isFused { IsUsingFusedKernel() };
+        const bool isWritingRecords { isFused && systemVisibility != DirectX::DISJOINT };
+        const bool isCullingParticles { systemVisibility == DirectX::INTERSECTS && !isFused };
+        const bool isComputingBounds { ++m_FramesSinceBounds >= m_BoundsInterval };
+
+        if ( isCullingParticles )
         {
-            particle.Update( deltaTime, camera, m_IsAccelerationEnabled, m_IsPerpendicularEnabled );
-        } 
-    );
+            m_Culler.Begin( m_CullingViews, GetCullingRadius(), m_Particles.size(), m_Tuning.UpdateChunkSize );
+        }
+        if ( isFused )
+        {
+            //quantized in the bounds of the last frame, grown to contain this frame's moves
+            const PackedParticleEncoder encoder { m_MaxParticleSize, GetBounds(), camera.get_ViewMatrix() * camera.get_ProjectionMatrix(),
+                                                  m_CurrentTick, GetMaxLifetimeTicks() };
+            PackedParticleTarget& target { m_InstanceRing.HasBackend() ? static_cast<PackedParticleTarget&>( m_FusedRingTarget ) : m_FusedTarget };
+            m_FusedKernel.Begin( target, isWritingRecords ? m_Particles.size() : 0, m_Tuning.UpdateChunkSize,
+                                 systemVisibility == DirectX::INTERSECTS ? &m_CullingViews.front() : nullptr, GetCullingRadius(), encoder );
+        }
+        if ( isComputingBounds )
+        {
+            m_ChunkBoundsMin.resize( Parallel::GetChunkCount( m_Particles.size(), m_Tuning.UpdateChunkSize ) );
+            m_ChunkBoundsMax.resize( m_ChunkBoundsMin.size() );
+        }
+
+        //at a lower simulation rate the simulation catches up on the skipped frames and the particles are
+        //rendered between their two last simulated positions
+        m_AccumulatedSimulationTime += deltaTime;
+        const bool  isSimulating { m_IsSimulationFrame };
+        const float simulationDeltaTime { m_AccumulatedSimulationTime };
+        if ( isSimulating )
+        {
+            m_AccumulatedSimulationTime = 0.0f;
+            m_FramesSinceSimulation     = 0;
+            m_LastStepFrames            = m_SimulationPeriod;
+            m_SimulatedFramesSinceBounds += m_SimulationPeriod;
+            m_ForceFields.Advance( simulationDeltaTime );
+        }
+        else
+        {
+            ++m_FramesSinceSimulation;
+        }
+        const float interpolation { std::min( 1.0f, static_cast<float>( m_FramesSinceSimulation + 1 ) / static_cast<float>( m_SimulationPeriod ) ) };
+
+        //back to full rate unless the scheduler says otherwise next frame
+        m_IsSimulationFrame = true;
+        m_SimulationPeriod  = 1;
+
+        Parallel::ForEachChunk
+        (
+            m_Particles.size(),
+            m_Tuning.UpdateChunkSize,
+            [this, &camera, isSimulating, simulationDeltaTime, interpolation, isFused, isWritingRecords, isCullingParticles, isComputingBounds]( size_t chunk, size_t begin, size_t end )
+            {
+                if ( isSimulating )
+                {
+                    m_ForceFields.Apply( m_Particles.data() + begin, end - begin, simulationDeltaTime );
+                    for ( size_t i { begin }; i < end; ++i )
+                    {
+                        m_Particles[i].Update( simulationDeltaTime, m_IsAccelerationEnabled, m_IsPerpendicularEnabled );
+                    }
+                    //on the integrated positions, every motion of the step has been applied
+                    CollideParticles( begin, end );
+                }
+                if ( isWritingRecords )
+                {
+                    m_FusedKernel.WriteChunk( m_Particles.data(), begin, end, interpolation );
+                }
+                else if ( !isFused )
+                {
+                    for ( size_t i { begin }; i < end; ++i )
+                    {
+                        m_Particles[i].UpdateMatrices( camera, interpolation );
+                    }
+                }
+
+                if ( isCullingParticles )
+                {
+                    m_Culler.CullChunk( m_Particles.data(), chunk, begin, end );
+                }
+                if ( isComputingBounds )
+                {
+                    ComputeChunkBounds( chunk, begin, end );
+                }
+            }
+        );
+        m_ForceFields.ReportTimings( profiler );
+
+        if ( isComputingBounds )
+        {
+            ReduceBounds();
+        }
+        m_IsFusedFrame = isFused;
+        if ( isFused )
+        {
+            //the records are already in the target, there is no draw list
+            m_FusedKernel.End( profiler );
+            m_DrawList.clear();
+            profiler.AddCount( "Bounds/SkippedSystems", systemVisibility == DirectX::DISJOINT ? 1.0 : 0.0 );
+        }
+        else
+        {
+            UpdateDrawList( systemVisibility, camera, profiler );
+            m_Instances.Update( m_Particles, deltaTime, camera, GetCullingRadius(), profiler );
+            if ( m_IsPacking && m_Instances.IsEmpty() )
+            {
+                PackDrawList( camera, profiler );
+            }
+        }
+    }
+    m_LastUpdateMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - updateStart ).count();
 
-    accumulatedTime += deltaTime;
+    accumulatedTime += m_IsSampleGrowthEnabled ? deltaTime : 0.0f;
     if (accumulatedTime > intervalTime)
     {
         memCounter.Update( m_Particles.size() );
+        profiler.WriteSample( m_Particles.size() );
         accumulatedTime -= intervalTime;
         AddParticleAmount( m_Particles.size() );
         fpsCounter.UpdateSample( m_Particles.size() );
     }
 }
 
-void ParticleSystem::Render( dx12lib::Device& device, dx12lib::CommandList& commandList, SceneVisitor& visitor, const Camera& camera, bool isMeshShader ) const
+uint64_t ParticleSystem::GetMaxLifetimeTicks() const
+{
+    //the longest lifetime is 1.5 times the lifetime, see AddParticle
+    return m_ParticleLifetime > 0.0f ? static_cast<uint64_t>( std::ceil( m_ParticleLifetime * 1.5f / m_TickDuration ) ) : 0;
+}
+
+bool ParticleSystem::IsUsingFusedKernel() const
+{
+    return m_IsFusedKernelEnabled && m_IsPacking && m_Instances.IsEmpty() && !m_RenderLOD.IsEnabled() &&
+           m_DepthSort.GetMode() == DepthSortMode::Off && m_AdditionalViews.empty() && !m_IsCoverageEnabled;
+}
+
+void ParticleSystem::PackDrawList( const Camera& camera, Profiler& profiler )
+{
+    const float* scales { m_RenderLOD.IsEnabled() ? m_RenderScales.data() : nullptr };
+
+    m_Packer.Pack( m_Particles, m_DrawList, scales, m_MaxParticleSize * m_RenderLOD.GetMaxScale(), GetBounds(),
+                   camera.get_ViewMatrix() * camera.get_ProjectionMatrix(), m_CurrentTick, GetMaxLifetimeTicks(), profiler );
+    if ( m_IsValidatingPacking )
+    {
+        m_Packer.Validate( m_Particles, m_DrawList, scales, profiler );
+    }
+}
+
+void ParticleSystem::SetCollider( std::shared_ptr<const SignedDistanceField> collider )
+{
+    m_Collider = std::move( collider );
+}
+
+void ParticleSystem::CollideParticles( size_t begin, size_t end )
+{
+    if (!m_Collider) return;
+
+    for ( size_t i { begin }; i < end; ++i )
+    {
+        Particle& particle { m_Particles[i] };
+        DirectX::XMFLOAT3 position { particle.GetPosition() };
+        DirectX::XMFLOAT3 velocity { particle.GetVelocity() };
+        DirectX::XMFLOAT3 normal {};
+        if ( m_Collider->Collide( position, velocity, m_ParticlesSize * 0.5f, m_CollisionBounce, m_CollisionFriction, &normal ) )
+        {
+            particle.SetPosition( position );
+            particle.SetVelocity( velocity );
+            particle.RemoveInwardMotion( normal );
+        }
+    }
+}
+
+void ParticleSystem::ExpireParticles( float deltaTime, Profiler& profiler )
+{
+    if ( m_ParticleLifetime <= 0.0f ) return;
+
+    m_ExpiredIds.clear();
+    {
+        ScopedTimer findTimer { profiler, "Expiration/Find" };
+
+        m_AccumulatedTickTime += deltaTime;
+        while ( m_AccumulatedTickTime >= m_TickDuration )
+        {
+            m_AccumulatedTickTime -= m_TickDuration;
+            ++m_CurrentTick;
+            if ( m_ExpirationMode == ExpirationMode::TimingWheel )
+            {
+                m_ExpirationWheel.Advance( m_ExpiredIds );
+            }
+        }
+
+        if ( m_ExpirationMode == ExpirationMode::AgeScan )
+        {
+            for ( const Particle& particle: m_Particles )
+            {
+                if ( particle.GetDeathTick() <= m_CurrentTick )
+                {
+                    m_ExpiredIds.emplace_back( particle.GetId() );
+                }
+            }
+        }
+    }
+
+    {
+        ScopedTimer removeTimer { profiler, "Expiration/Remove" };
+        for ( const uint32_t id: m_ExpiredIds )
+        {
+            RemoveParticle( id );
+        }
+        if ( !m_ExpiredIds.empty() )
+        {
+            m_DepthSort.Invalidate();
+        }
+    }
+    profiler.AddCount( "Expiration/Expired", static_cast<double>( m_ExpiredIds.size() ) );
+}
+
+void ParticleSystem::SpawnParticles( Profiler& profiler )
+{
+    //keep the amount of particles of the test, as far as the capacity allows
+    const size_t targetCount { std::min( m_RequestedParticleCount, m_ParticleCapacity ) };
+    const size_t spawnCount { targetCount > m_Particles.size() ? targetCount - m_Particles.size() : 0 };
+    for ( size_t i { 0 }; i < spawnCount; ++i )
+    {
+        AddParticle();
+    }
+    profiler.AddCount( "Budget/Spawned", static_cast<double>( spawnCount ) );
+    profiler.AddCount( "Budget/Throttled", static_cast<double>( m_RequestedParticleCount > m_Particles.size() ? m_RequestedParticleCount - m_Particles.size() : 0 ) );
+}
+
+void ParticleSystem::RemoveParticle( uint32_t id )
+{
+    //move the last particle in the slot so the storage stays compact
+    const uint32_t index { m_ParticleIndices[id] };
+    const uint32_t lastIndex { static_cast<uint32_t>( m_Particles.size() - 1 ) };
+    if ( index != lastIndex )
+    {
+        m_Particles[index] = m_Particles[lastIndex];
+        m_ParticleIndices[m_Particles[index].GetId()] = index;
+    }
+    m_Particles.pop_back();
+    m_FreeIds.emplace_back( id );
+}
+
+void ParticleSystem::UpdateParticleIndices()
+{
+    Parallel::ForEachChunk
+    (
+        m_Particles.size(),
+        m_Tuning.UpdateChunkSize,
+        [this]( size_t, size_t begin, size_t end )
+        {
+            for ( size_t i { begin }; i < end; ++i )
+            {
+                m_ParticleIndices[m_Particles[i].GetId()] = static_cast<uint32_t>( i );
+            }
+        }
+    );
+}
+
+float ParticleSystem::GetCullingRadius() const
+{
+    //the quad goes from -size to size on both axes, culling runs before the render LOD so the radius
+    //covers the largest scale it can give to the particles it keeps
+    return m_ParticlesSize * m_RenderLOD.GetMaxScale() * 1.4142136f;
+}
+
+void ParticleSystem::UpdateDrawList( DirectX::ContainmentType systemVisibility, const Camera& camera, Profiler& profiler )
+{
+    profiler.AddCount( "Bounds/SkippedSystems", systemVisibility == DirectX::DISJOINT ? 1.0 : 0.0 );
+
+    switch ( systemVisibility )
+    {
+    case DirectX::DISJOINT:
+        m_DrawList.clear();
+        m_Coverage.Clear();
+        return;
+    case DirectX::INTERSECTS:
+        m_Culler.End( profiler );
+        m_DrawList.swap( m_Culler.GetVisibleIndices( 0 ) );
+        break;
+    case DirectX::CONTAINS:
+        m_DrawList.resize( m_Particles.size() );
+        std::iota( m_DrawList.begin(), m_DrawList.end(), 0u );
+        break;
+    }
+
+    m_RenderLOD.Apply( m_Particles, camera, m_ParticlesSize, m_DrawList, m_RenderScales, profiler );
+    if ( m_IsCoverageEnabled )
+    {
+        m_Coverage.Estimate( m_Particles, m_DrawList, m_RenderLOD.IsEnabled() ? m_RenderScales.data() : nullptr, m_ParticlesSize,
+                             camera.get_ViewMatrix(), camera.get_ProjectionMatrix(), profiler );
+    }
+    m_DepthSort.Sort( m_Particles, camera, m_DrawList, profiler );
+}
+
+DirectX::ContainmentType ParticleSystem::GetSystemVisibility( const Camera& camera )
 {
+    if ( !m_IsCullingEnabled ) return DirectX::CONTAINS;
+
+    m_CullingViews.clear();
+    m_CullingViews.emplace_back( FrustumPlanes::FromViewProjection( camera.get_ViewMatrix() * camera.get_ProjectionMatrix() ) );
+    m_CullingViews.insert( m_CullingViews.end(), m_AdditionalViews.begin(), m_AdditionalViews.end() );
+
+    if ( !m_HasBounds ) return DirectX::INTERSECTS;
+
+    const DirectX::BoundingBox bounds { GetBounds() };
+    bool isDisjoint { true };
+    for ( const FrustumPlanes& view: m_CullingViews )
+    {
+        const DirectX::ContainmentType containment { view.Contains( bounds ) };
+        isDisjoint = isDisjoint && containment == DirectX::DISJOINT;
+
+        //the additional views still need their own lists
+        if ( containment == DirectX::CONTAINS && m_CullingViews.size() == 1 ) return DirectX::CONTAINS;
+    }
+    return isDisjoint ? DirectX::DISJOINT : DirectX::INTERSECTS;
+}
+
+DirectX::BoundingBox ParticleSystem::GetBounds() const
+{
+    //grow the last computed bounds by the growth measured between the last two computations, twice to stay conservative,
+    //a step simulated before the next computation moves the particles by the simulated time of a whole step
+    const float margin { m_BoundsGrowthPerFrame * 2.0f * static_cast<float>( m_FramesSinceBounds + m_LastStepFrames ) + GetCullingRadius() };
+
+    DirectX::BoundingBox bounds { m_Bounds };
+    bounds.Extents.x += margin;
+    bounds.Extents.y += margin;
+    bounds.Extents.z += margin;
+
+    //new particles are spawned at the emitter
+    const DirectX::BoundingBox emitter { DirectX::XMFLOAT3 { m_Pos.X, m_Pos.Y, m_Pos.Z }, DirectX::XMFLOAT3 { margin, margin, margin } };
+    DirectX::BoundingBox::CreateMerged( bounds, bounds, emitter );
+    return bounds;
+}
+
+DirectX::BoundingSphere ParticleSystem::GetBoundingSphere() const
+{
+    DirectX::BoundingSphere sphere {};
+    DirectX::BoundingSphere::CreateFromBoundingBox( sphere, GetBounds() );
+    return sphere;
+}
+
+void ParticleSystem::ComputeChunkBounds( size_t chunk, size_t begin, size_t end )
+{
+    DirectX::XMVECTOR boundsMin { DirectX::XMVectorReplicate( FLT_MAX ) };
+    DirectX::XMVECTOR boundsMax { DirectX::XMVectorReplicate( -FLT_MAX ) };
+    //the particles are rendered between their two last simulated positions
+    for ( size_t i { begin }; i < end; ++i )
+    {
+        const DirectX::XMFLOAT3 position { m_Particles[i].GetPosition() };
+        const DirectX::XMFLOAT3 previousPosition { m_Particles[i].GetPreviousPosition() };
+        boundsMin = DirectX::XMVectorMin( boundsMin, DirectX::XMVectorMin( DirectX::XMLoadFloat3( &position ), DirectX::XMLoadFloat3( &previousPosition ) ) );
+        boundsMax = DirectX::XMVectorMax( boundsMax, DirectX::XMVectorMax( DirectX::XMLoadFloat3( &position ), DirectX::XMLoadFloat3( &previousPosition ) ) );
+    }
+    DirectX::XMStoreFloat3( &m_ChunkBoundsMin[chunk], boundsMin );
+    DirectX::XMStoreFloat3( &m_ChunkBoundsMax[chunk], boundsMax );
+}
+
+void ParticleSystem::ReduceBounds()
+{
+    if ( m_Particles.empty() )
+    {
+        m_HasBounds = false;
+        return;
+    }
+
+    DirectX::XMVECTOR boundsMin { DirectX::XMVectorReplicate( FLT_MAX ) };
+    DirectX::XMVECTOR boundsMax { DirectX::XMVectorReplicate( -FLT_MAX ) };
+    for ( size_t chunk { 0 }; chunk < m_ChunkBoundsMin.size(); ++chunk )
+    {
+        boundsMin = DirectX::XMVectorMin( boundsMin, DirectX::XMLoadFloat3( &m_ChunkBoundsMin[chunk] ) );
+        boundsMax = DirectX::XMVectorMax( boundsMax, DirectX::XMLoadFloat3( &m_ChunkBoundsMax[chunk] ) );
+    }
+
+    DirectX::BoundingBox bounds {};
+    DirectX::BoundingBox::CreateFromPoints( bounds, boundsMin, boundsMax );
+
+    //the particles only move on simulation steps, frames without a step keep the growth of the last ones
+    if ( m_HasBounds && m_SimulatedFramesSinceBounds > 0 )
+    {
+        const DirectX::XMVECTOR previousMin { DirectX::XMLoadFloat3( &m_Bounds.Center ) - DirectX::XMLoadFloat3( &m_Bounds.Extents ) };
+        const DirectX::XMVECTOR previousMax { DirectX::XMLoadFloat3( &m_Bounds.Center ) + DirectX::XMLoadFloat3( &m_Bounds.Extents ) };
+        const DirectX::XMVECTOR growth { DirectX::XMVectorMax( DirectX::XMVectorMax( previousMin - boundsMin, boundsMax - previousMax ), DirectX::XMVectorZero() ) };
+
+        DirectX::XMFLOAT3 axisGrowth {};
+        DirectX::XMStoreFloat3( &axisGrowth, growth );
+        m_BoundsGrowthPerFrame = std::max( { axisGrowth.x, axisGrowth.y, axisGrowth.z } ) / static_cast<float>( m_SimulatedFramesSinceBounds );
+    }
+
+    m_Bounds                     = bounds;
+    m_HasBounds                  = true;
+    m_FramesSinceBounds          = 0;
+    m_SimulatedFramesSinceBounds = 0;
+}
+
+void ParticleSystem::Render( dx12lib::Device& device, dx12lib::CommandList& commandList, const Camera& camera, bool isMeshShader, Profiler& profiler )
+{
+    const size_t drawCount { GetDrawCount() };
+    if ( drawCount == 0 ) return;
+
     commandList.SetGraphicsDynamicConstantBuffer( RootParameters::MaterialCB, dx12lib::Material::White );
     commandList.SetShaderResourceView( RootParameters::Textures, 0, m_DefaultTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE );
 
-    float constants[3] { camera.get_FoV(), m_ParticlesSize, static_cast<float>( m_Particles.size() ) };
+    float constants[3] { camera.get_FoV(), m_ParticlesSize, static_cast<float>( drawCount ) };
     commandList.SetGraphics32BitConstants( RootParameters::FOVSizeAndNBParticles, 3, &constants );
 
     if (!isMeshShader)
     {
-        TraditionalRender( commandList, visitor, camera );
+        TraditionalRender( device, commandList, camera, profiler );
         return;
     }
     MeshShaderRender( device, commandList);
 }
 
-void ParticleSystem::TraditionalRender( dx12lib::CommandList& commandList, SceneVisitor& visitor, const Camera& camera ) const
+void ParticleSystem::TraditionalRender( dx12lib::Device& device, dx12lib::CommandList& commandList, const Camera& camera, Profiler& profiler )
 {
+    const RenderQueue::Bindings bindings { RootParameters::MatricesCB, RootParameters::MaterialCB };
 
-    for ( Particle particle: m_Particles )
+    //the particles are already one instance stream, built straight from the draw list in its sorted order
+    if ( m_IsUsingInstancedDraws )
     {
-        const DirectX::XMFLOAT3 position = particle.GetPosition();
-        commandList.SetGraphicsDynamicConstantBuffer( RootParameters::MatricesCB, particle.GetMatrices().ModelViewProjectionMatrix );
-        m_Plane->Accept( visitor );
+        const std::vector<DirectX::XMMATRIX> particleMatrices { GetAllMatrices() };
+        BindInstanceStream( device, commandList, particleMatrices.data(), particleMatrices.size() * sizeof( DirectX::XMMATRIX ) );
+
+        CommandListInstancedDrawBackend backend { commandList, *m_Plane, RootParameters::InstanceOffset, bindings };
+        SubmitInstancedDraws( backend, particleMatrices.size(), m_Tuning.InstancesPerDraw );
+        return;
     }
+
+    //the traversal only emits the draws, the queue orders them by state, or back to front when the particles are depth sorted
+    m_RenderQueue.Clear();
+    SceneVisitor visitor { m_RenderQueue, m_DepthSort.GetMode() == DepthSortMode::Off ? RenderPass::Opaque : RenderPass::Transparent };
+    //the particle matrices are full model view projection matrices, w of their origin is its view depth
+    if ( !m_Instances.IsEmpty() )
+    {
+        for ( const DirectX::XMMATRIX& matrix: m_Instances.GetMatrices() )
+        {
+            visitor.SetTransform( matrix, DirectX::XMVectorGetW( matrix.r[3] ) );
+            m_Plane->Accept( visitor );
+        }
+    }
+    else
+    {
+        for ( const uint32_t index: m_DrawList )
+        {
+            const DirectX::XMMATRIX matrix { GetRenderMatrix( index ) };
+            visitor.SetTransform( matrix, DirectX::XMVectorGetW( matrix.r[3] ) );
+            m_Plane->Accept( visitor );
+        }
+    }
+
+    {
+        ScopedTimer timer { profiler, "RenderQueue/Sort" };
+        m_RenderQueue.Sort();
+    }
+    profiler.AddCount( "RenderQueue/Draws", static_cast<double>( m_RenderQueue.GetDrawCount() ) );
+
+    m_RenderQueue.Submit( commandList, bindings );
 }
 
-void ParticleSystem::MeshShaderRender(dx12lib::Device& device, dx12lib::CommandList& commandList ) const
+void ParticleSystem::MeshShaderRender( dx12lib::Device& device, dx12lib::CommandList& commandList )
 {
-    //Upload all the particle matrices
-    std::vector<DirectX::XMMATRIX> particleMatrices { GetAllMatrices() };
-    std::shared_ptr<dx12lib::StructuredBuffer> matricesBuffer {};
-    dx12lib::StructuredBuffer::UploadDataToStructuredBuffer( device, matricesBuffer, particleMatrices.data(), particleMatrices.size() * sizeof(DirectX::XMMATRIX) );
-    commandList.SetShaderResourceView( RootParameters::MatricesSRV, matricesBuffer, D3D12_RESOURCE_STATE_GENERIC_READ );
+    std::vector<DirectX::XMMATRIX> particleMatrices {};
+    const void*                    data { nullptr };
+    size_t                         dataSize { 0 };
+    if ( m_IsFusedFrame )
+    {
+        //Records written by the fused kernel, already in the instance buffer with the ring
+        data     = m_FusedTarget.GetData();
+        dataSize = m_FusedTarget.GetCount() * sizeof( PackedParticle );
+        commandList.SetGraphicsDynamicConstantBuffer( RootParameters::PackedParticlesCB, m_FusedKernel.GetHeader() );
+    }
+    else if ( m_IsPacking && m_Instances.IsEmpty() )
+    {
+        //Packed particles, decoded by the packed mesh shader
+        const std::vector<PackedParticle>& packedParticles { m_Packer.GetParticles() };
+        data     = packedParticles.data();
+        dataSize = packedParticles.size() * sizeof( PackedParticle );
+        commandList.SetGraphicsDynamicConstantBuffer( RootParameters::PackedParticlesCB, m_Packer.GetHeader() );
+    }
+    else
+    {
+        //All the particle matrices
+        particleMatrices = GetAllMatrices();
+        data             = particleMatrices.data();
+        dataSize         = particleMatrices.size() * sizeof( DirectX::XMMATRIX );
+    }
 
-    //Perform Draw
-    const int numParticles      = m_Particles.size();
-    constexpr int particlesPerGroup = 64;
+    if ( m_IsFusedFrame && m_InstanceRing.HasBackend() )
+    {
+        m_InstanceRing.Bind( commandList, RootParameters::MatricesSRV );
+    }
+    else
+    {
+        BindInstanceStream( device, commandList, data, dataSize );
+    }
 
-    commandList.MeshShaderDraw( numParticles / particlesPerGroup);
+    //Perform Draw, every group draws m_Tuning.ParticlesPerGroup particles, the last one the remaining ones
+    for ( const MeshDispatch& dispatch: PlanMeshDispatches( GetDrawCount(), m_Tuning.ParticlesPerGroup ) )
+    {
+        commandList.SetGraphics32BitConstants( RootParameters::MeshDispatchCB, dispatch.Constants );
+        commandList.DispatchMesh( dispatch.X, dispatch.Y, dispatch.Z );
+    }
+}
+
+void ParticleSystem::BindInstanceStream( dx12lib::Device& device, dx12lib::CommandList& commandList, const void* data, size_t dataSize )
+{
+    if ( m_InstanceRing.HasBackend() )
+    {
+        std::memcpy( m_InstanceRing.Allocate( dataSize ), data, dataSize );
+        m_InstanceRing.Bind( commandList, RootParameters::MatricesSRV );
+        return;
+    }
+
+    std::shared_ptr<dx12lib::StructuredBuffer> instanceBuffer {};
+    dx12lib::StructuredBuffer::UploadDataToStructuredBuffer( device, instanceBuffer, data, dataSize );
+    commandList.SetShaderResourceView( RootParameters::MatricesSRV, instanceBuffer, D3D12_RESOURCE_STATE_GENERIC_READ );
 }
 
 void ParticleSystem::AddParticle()
 {
-    m_Particles.emplace_back( Particle {m_Pos} );
+    uint32_t id { static_cast<uint32_t>( m_ParticleIndices.size() ) };
+    if ( m_FreeIds.empty() )
+    {
+        m_ParticleIndices.emplace_back();
+    }
+    else
+    {
+        id = m_FreeIds.back();
+        m_FreeIds.pop_back();
+    }
+    m_ParticleIndices[id] = static_cast<uint32_t>( m_Particles.size() );
+
+    Particle& particle { m_Particles.emplace_back( Particle {m_Pos} ) };
+    particle.SetId( id );
+    m_MaxParticleSize = std::max( m_MaxParticleSize, particle.GetSize() );
+
+    if ( m_ParticleLifetime <= 0.0f ) return;
+
+    //spread the deaths so the particles do not all expire on the same frame
+    const float    lifetime { m_ParticleLifetime * Math::GetRandomInRange( 0.5f, 1.5f ) };
+    const uint64_t deathTick { m_CurrentTick + std::max( uint64_t { 1 }, static_cast<uint64_t>( lifetime / m_TickDuration ) ) };
+    particle.SetDeathTick( deathTick );
+    if ( m_ExpirationMode == ExpirationMode::TimingWheel )
+    {
+        m_ExpirationWheel.Schedule( id, deathTick );
+    }
+}
+
+void ParticleSystem::SetTuning( const Tuning& tuning )
+{
+    //a mesh shader group outputs at most 256 vertices, 4 per particle
+    m_Tuning                   = tuning;
+    m_Tuning.UpdateChunkSize   = std::max<size_t>( m_Tuning.UpdateChunkSize, 1 );
+    m_Tuning.ParticlesPerGroup = std::clamp( m_Tuning.ParticlesPerGroup, 1u, 64u );
+    m_Tuning.InstancesPerDraw  = std::max<size_t>( m_Tuning.InstancesPerDraw, 1 );
 }
 
 void ParticleSystem::AddParticleAmount( int amount )
 {
-    for ( int i {0}; i < amount; ++i )
+    m_RequestedParticleCount += static_cast<size_t>( std::max( amount, 0 ) );
+
+    const size_t spawnCount { std::min( static_cast<size_t>( std::max( amount, 0 ) ), m_ParticleCapacity > m_Particles.size() ? m_ParticleCapacity - m_Particles.size() : 0 ) };
+    for ( size_t i {0}; i < spawnCount; ++i )
     {
         AddParticle();
     }
@@ -120,12 +647,31 @@ std::vector<DirectX::XMFLOAT3> ParticleSystem::GetAllPos() const
     return pos;
 }
 
+size_t ParticleSystem::GetDrawCount() const
+{
+    if ( m_IsFusedFrame ) return m_FusedKernel.GetRecordCount();
+    return m_Instances.IsEmpty() ? m_DrawList.size() : m_Instances.GetMatrices().size();
+}
+
 std::vector<DirectX::XMMATRIX> ParticleSystem::GetAllMatrices() const
 {
+    if ( !m_Instances.IsEmpty() ) return m_Instances.GetMatrices();
+
     std::vector<DirectX::XMMATRIX> mat {};
-    for ( const Particle& particle: m_Particles )
+    mat.reserve( m_DrawList.size() );
+    for ( const uint32_t index: m_DrawList )
     {
-        mat.emplace_back( particle.GetMVPMatrix() );
+        mat.emplace_back( GetRenderMatrix( index ) );
     }
     return mat;
+}
+
+DirectX::XMMATRIX ParticleSystem::GetRenderMatrix( uint32_t index ) const
+{
+    const DirectX::XMMATRIX mvpMatrix { m_Particles[index].GetMVPMatrix() };
+    if ( !m_RenderLOD.IsEnabled() ) return mvpMatrix;
+
+    //particles kept by the render LOD are scaled up in the plane of the quad
+    const float scale { m_RenderScales[index] };
+    return DirectX::XMMatrixScaling( scale, scale, 1.0f ) * mvpMatrix;
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include <Profiler.h>
+
+#include <algorithm>
+#include <fstream>
+
+Profiler::Profiler()
+{
+    if ( std::ofstream logFile { m_FileLocation, std::ios::trunc } )
+    {}
+}
+
+void Profiler::AddTime( const std::string& name, double milliseconds )
+{
+    Entry& entry { m_Entries[name] };
+    entry.Total += milliseconds;
+    entry.Type  = EntryType::Time;
+}
+
+void Profiler::AddCount( const std::string& name, double value )
+{
+    Entry& entry { m_Entries[name] };
+    entry.Total += value;
+    entry.Type  = EntryType::Count;
+}
+
+void Profiler::SetValue( const std::string& name, double value )
+{
+    Entry& entry { m_Entries[name] };
+    entry.Total = value;
+    entry.Type  = EntryType::Value;
+}
+
+void Profiler::EndFrame()
+{
+    ++m_FramesThisSample;
+}
+
+void Profiler::WriteSample( int sampleCount )
+{
+    const double frames { static_cast<double>( std::max( m_FramesThisSample, 1 ) ) };
+
+    if ( std::ofstream logFile { m_FileLocation, std::ios::app } )
+    {
+        logFile << "[" << sampleCount << "] frames: " << m_FramesThisSample << "\n";
+        for ( const auto& [name, entry]: m_Entries )
+        {
+            const double value { entry.Type == EntryType::Value ? entry.Total : entry.Total / frames };
+            logFile << "    " << name << ": " << value << ( entry.Type == EntryType::Time ? " ms" : "" ) << "\n";
+        }
+    }
+
+    m_Entries.clear();
+    m_FramesThisSample = 0;
+}
+
+ScopedTimer::ScopedTimer( Profiler& profiler, const char* name )
+: m_Profiler { profiler }
+, m_Name { name }
+, m_Start { std::chrono::high_resolution_clock::now() }
+{}
+
+ScopedTimer::~ScopedTimer()
+{
+    const std::chrono::duration<double, std::milli> elapsed { std::chrono::high_resolution_clock::now() - m_Start };
+    m_Profiler.AddTime( m_Name, elapsed.count() );
+}
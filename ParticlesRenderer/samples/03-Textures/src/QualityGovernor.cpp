@@ -0,0 +1,130 @@
+#include <QualityGovernor.h>
+
+#include <Profiler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    // From the highest to the lowest quality, every level is cheaper than the previous one
+    constexpr QualityGovernor::Knobs Levels[] {
+        { 1.0, false, 0, false, 0.0f, DepthSortMode::Full },
+        { 1.0, false, 0, false, 0.0f, DepthSortMode::Incremental },
+        { 1.0, true, 0, true, 1.0f, DepthSortMode::Incremental },
+        { 0.75, true, 1, true, 2.0f, DepthSortMode::Incremental },
+        { 0.5, true, 1, true, 3.0f, DepthSortMode::Off },
+        { 0.35, true, 2, true, 4.0f, DepthSortMode::Off },
+        { 0.25, true, 3, true, 6.0f, DepthSortMode::Off },
+    };
+    constexpr uint32_t LevelCount { static_cast<uint32_t>( std::size( Levels ) ) };
+
+    const char* ToString( DepthSortMode mode )
+    {
+        switch ( mode )
+        {
+        case DepthSortMode::Off: return "off";
+        case DepthSortMode::Full: return "full";
+        case DepthSortMode::Incremental: return "incremental";
+        }
+        return "";
+    }
+}
+
+QualityGovernor::QualityGovernor( const Settings& settings )
+: m_Settings { settings }
+{
+    m_Settings.WindowFrames = std::max( m_Settings.WindowFrames, 1u );
+    m_Window.resize( m_Settings.WindowFrames );
+    m_RaiseCooldowns.assign( LevelCount, m_Settings.CooldownFrames );
+}
+
+bool QualityGovernor::Update( double frameMilliseconds, Profiler& profiler )
+{
+    // The log of a previous run is only replaced by a run which uses the governor
+    if ( m_Frame == 0 )
+    {
+        StartLog();
+    }
+    ++m_Frame;
+
+    // One measure per full window
+    m_Window[m_WindowCursor] = frameMilliseconds;
+    m_WindowCursor           = ( m_WindowCursor + 1 ) % m_Window.size();
+    if ( m_WindowCursor != 0 ) return false;
+
+    const double percentile { MeasurePercentile() };
+    m_SmoothedMilliseconds = m_HasMeasure ? m_SmoothedMilliseconds + ( percentile - m_SmoothedMilliseconds ) * m_Smoothing : percentile;
+    m_HasMeasure           = true;
+    profiler.SetValue( "Governor/FrameMilliseconds", m_SmoothedMilliseconds );
+    profiler.SetValue( "Governor/Level", static_cast<double>( m_Level ) );
+
+    const uint64_t framesSinceChange { m_Frame - m_LastChangeFrame };
+    if ( framesSinceChange < m_Settings.CooldownFrames ) return false;
+
+    const double target { m_Settings.TargetFrameMilliseconds };
+    if ( m_SmoothedMilliseconds > target * ( 1.0 + m_Settings.Hysteresis ) && m_Level + 1 < LevelCount )
+    {
+        // The level just went up and could not hold, going up to it again waits longer
+        if ( m_IsLastChangeRaise && framesSinceChange <= m_RaiseCooldowns[m_Level] + m_Window.size() )
+        {
+            m_RaiseCooldowns[m_Level] = std::min( m_RaiseCooldowns[m_Level] * 2, m_Settings.CooldownFrames * m_MaxCooldownScale );
+        }
+        ChangeLevel( m_Level + 1, "over target" );
+        m_IsLastChangeRaise = false;
+        return true;
+    }
+    if ( m_SmoothedMilliseconds < target * ( 1.0 - m_Settings.Hysteresis ) && m_Level > 0 &&
+         framesSinceChange >= m_RaiseCooldowns[m_Level - 1] )
+    {
+        ChangeLevel( m_Level - 1, "under target" );
+        m_IsLastChangeRaise = true;
+        return true;
+    }
+    return false;
+}
+
+const QualityGovernor::Knobs& QualityGovernor::GetKnobs() const
+{
+    return Levels[m_Level];
+}
+
+void QualityGovernor::StartLog() const
+{
+    if ( std::ofstream logFile { m_FileLocation, std::ios::trunc } )
+    {
+        logFile << "target: " << m_Settings.TargetFrameMilliseconds << " ms, percentile: " << m_Settings.Percentile
+                << ", hysteresis: " << m_Settings.Hysteresis << "\n";
+    }
+}
+
+double QualityGovernor::MeasurePercentile()
+{
+    m_Sorted = m_Window;
+    const size_t rank { std::min( static_cast<size_t>( std::ceil( m_Settings.Percentile * static_cast<double>( m_Sorted.size() ) ) ),
+                                  m_Sorted.size() ) };
+    const auto   nth { m_Sorted.begin() + ( rank > 0 ? rank - 1 : 0 ) };
+    std::nth_element( m_Sorted.begin(), nth, m_Sorted.end() );
+    return *nth;
+}
+
+void QualityGovernor::ChangeLevel( uint32_t level, const char* reason )
+{
+    if ( std::ofstream logFile { m_FileLocation, std::ios::app } )
+    {
+        const Knobs& knobs { Levels[level] };
+        logFile << "[" << m_Frame << "] level " << m_Level << " -> " << level << " (" << reason << "): "
+                << m_SmoothedMilliseconds << " ms, budget: " << knobs.BudgetScale
+                << ", simulation LOD: " << ( knobs.IsSimulationLODEnabled ? static_cast<int>( knobs.SimulationLODBias ) : -1 )
+                << ", render LOD: " << ( knobs.IsRenderLODEnabled ? knobs.RenderLODMinPixelSize : 0.0f )
+                << " px, sort: " << ToString( knobs.SortMode ) << "\n";
+    }
+
+    // The next measure only sees frames at the new level
+    m_Level           = level;
+    m_LastChangeFrame = m_Frame;
+    m_WindowCursor    = 0;
+    m_HasMeasure      = false;
+}
@@ -0,0 +1,87 @@
+#include <RenderLOD.h>
+
+#include <Camera.h>
+#include <ParallelFor.h>
+#include <Particle.h>
+#include <Profiler.h>
+
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+    // Uniform value in [0, 1) from a particle id
+    float HashId( uint32_t id )
+    {
+        uint32_t hash { id * 2654435761u };
+        hash ^= hash >> 16;
+        hash *= 0x7feb352du;
+        hash ^= hash >> 15;
+        return static_cast<float>( hash >> 8 ) * ( 1.0f / 16777216.0f );
+    }
+}
+
+void RenderLOD::Apply( const std::vector<Particle>& particles, const Camera& camera, float particleSize,
+                       std::vector<uint32_t>& drawList, std::vector<float>& scales, Profiler& profiler )
+{
+    const size_t visibleCount { drawList.size() };
+    if ( m_Settings.IsEnabled && !drawList.empty() )
+    {
+        ScopedTimer timer { profiler, "RenderLOD/Apply" };
+        scales.resize( particles.size() );
+
+        const XMMATRIX viewMatrix { camera.get_ViewMatrix() };
+        const float    projectionScale { XMVectorGetY( camera.get_ProjectionMatrix().r[1] ) };
+        const float    minKeepProbability { 1.0f / ( m_Settings.MaxScale * m_Settings.MaxScale ) };
+
+        const size_t chunkCount { Parallel::GetChunkCount( drawList.size(), m_ChunkSize ) };
+        m_ChunkKept.resize( chunkCount );
+        Parallel::ForEachChunk( drawList.size(), m_ChunkSize, [&]( size_t chunk, size_t begin, size_t end ) {
+            std::vector<uint32_t>& kept { m_ChunkKept[chunk] };
+            kept.clear();
+            for ( size_t i { begin }; i < end; ++i )
+            {
+                const uint32_t  index { drawList[i] };
+                const Particle& particle { particles[index] };
+
+                // Height of the quad on screen in pixels
+                const XMFLOAT3 position { particle.GetPosition() };
+                const float    depth { XMVectorGetZ( XMVector3Transform( XMLoadFloat3( &position ), viewMatrix ) ) };
+                const float    pixelSize { depth > 0.0f
+                                           ? particleSize * particle.GetSize() * projectionScale * m_ViewportHeight / depth
+                                           : m_Settings.MinPixelSize };
+
+                float keepProbability { 1.0f };
+                if ( pixelSize < m_Settings.MinPixelSize )
+                {
+                    const float ratio { pixelSize / m_Settings.MinPixelSize };
+                    keepProbability = std::max( ratio * ratio, minKeepProbability );
+                }
+
+                if ( HashId( particle.GetId() ) < keepProbability )
+                {
+                    kept.emplace_back( index );
+                    scales[index] = 1.0f / std::sqrt( keepProbability );
+                }
+            }
+        } );
+
+        m_ChunkOffsets.resize( chunkCount );
+        size_t keptCount { 0 };
+        for ( size_t chunk { 0 }; chunk < chunkCount; ++chunk )
+        {
+            m_ChunkOffsets[chunk] = keptCount;
+            keptCount += m_ChunkKept[chunk].size();
+        }
+
+        drawList.resize( keptCount );
+        Parallel::ForEachChunk( chunkCount, 1, [this, &drawList]( size_t chunk, size_t, size_t ) {
+            std::copy( m_ChunkKept[chunk].begin(), m_ChunkKept[chunk].end(), drawList.begin() + m_ChunkOffsets[chunk] );
+        } );
+    }
+
+    profiler.AddCount( "RenderLOD/Simulated", static_cast<double>( particles.size() ) );
+    profiler.AddCount( "RenderLOD/Visible", static_cast<double>( visibleCount ) );
+    profiler.AddCount( "RenderLOD/Emitted", static_cast<double>( drawList.size() ) );
+}
@@ -0,0 +1,155 @@
+#include <RenderQueue.h>
+
+#include <RadixSort.h>
+
+#include <dx12lib/CommandList.h>
+#include <dx12lib/Material.h>
+#include <dx12lib/Mesh.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+    uint64_t ClampField( uint32_t value, uint32_t bits )
+    {
+        return std::min<uint64_t>( value, ( uint64_t { 1 } << bits ) - 1 );
+    }
+
+    // The bits of a positive float keep its order, the lowest ones are dropped to fit the field.
+    uint64_t GetDepthField( float depth )
+    {
+        if ( !( depth > 0.0f ) ) return 0;
+
+        uint32_t bits { 0 };
+        std::memcpy( &bits, &depth, sizeof( bits ) );
+        return bits >> ( 31 - RenderQueue::DepthBits );
+    }
+}
+
+void RenderQueue::Clear()
+{
+    m_Draws.clear();
+    m_Keys.clear();
+    m_Order.clear();
+    m_Transforms.clear();
+    m_Pipelines.clear();
+    m_Materials.clear();
+    m_StateIds.clear();
+    m_MeshCount    = 0;
+    m_LastMesh     = nullptr;
+    m_LastMaterial = nullptr;
+}
+
+uint32_t RenderQueue::AddPipeline( const std::shared_ptr<dx12lib::PipelineStateObject>& pipeline )
+{
+    if ( !pipeline ) return 0;
+
+    const auto id { m_StateIds.try_emplace( pipeline.get(), static_cast<uint32_t>( m_Pipelines.size() + 1 ) ) };
+    if ( id.second ) m_Pipelines.push_back( pipeline );
+    return id.first->second;
+}
+
+uint32_t RenderQueue::AddMaterial( const std::shared_ptr<dx12lib::Material>& material )
+{
+    if ( !material ) return 0;
+    if ( material.get() == m_LastMaterial ) return m_LastMaterialId;
+
+    const auto id { m_StateIds.try_emplace( material.get(), static_cast<uint32_t>( m_Materials.size() + 1 ) ) };
+    if ( id.second ) m_Materials.push_back( material );
+    m_LastMaterial   = material.get();
+    m_LastMaterialId = id.first->second;
+    return m_LastMaterialId;
+}
+
+uint32_t RenderQueue::AddTransform( const XMMATRIX& transform )
+{
+    m_Transforms.push_back( transform );
+    return static_cast<uint32_t>( m_Transforms.size() - 1 );
+}
+
+uint32_t RenderQueue::GetMeshId( const dx12lib::Mesh* mesh )
+{
+    if ( mesh == m_LastMesh ) return m_LastMeshId;
+
+    const auto id { m_StateIds.try_emplace( mesh, m_MeshCount ) };
+    if ( id.second ) ++m_MeshCount;
+    m_LastMesh   = mesh;
+    m_LastMeshId = id.first->second;
+    return m_LastMeshId;
+}
+
+void RenderQueue::Emit( RenderPass pass, const Draw& draw, float depth )
+{
+    m_Keys.push_back( MakeSortKey( pass, draw.Pipeline, draw.Material, GetMeshId( draw.Mesh ), depth ) );
+    m_Order.push_back( static_cast<uint32_t>( m_Draws.size() ) );
+    m_Draws.push_back( draw );
+}
+
+void RenderQueue::Sort()
+{
+    Parallel::RadixSort( m_Keys, m_Order, m_TempKeys, m_TempOrder, 64 );
+}
+
+std::vector<RenderQueue::Range> RenderQueue::Split( size_t rangeCount ) const
+{
+    std::vector<Range> ranges {};
+    const size_t       count { m_Order.size() };
+    if ( count == 0 || rangeCount == 0 ) return ranges;
+
+    const size_t rangeSize { ( count + rangeCount - 1 ) / rangeCount };
+    for ( size_t begin { 0 }; begin < count; begin += rangeSize )
+    {
+        ranges.push_back( Range { begin, std::min( begin + rangeSize, count ) } );
+    }
+    return ranges;
+}
+
+void RenderQueue::Submit( dx12lib::CommandList& commandList, const Bindings& bindings, const Range& range ) const
+{
+    // Nothing is known to be bound at the start of a range
+    uint32_t pipeline { UINT32_MAX };
+    uint32_t material { UINT32_MAX };
+    for ( size_t i { range.Begin }; i < range.End; ++i )
+    {
+        const Draw& draw { GetDraw( i ) };
+        if ( draw.Pipeline != 0 && draw.Pipeline != pipeline )
+        {
+            commandList.SetPipelineState( m_Pipelines[draw.Pipeline - 1] );
+            pipeline = draw.Pipeline;
+        }
+        if ( draw.Material != 0 && draw.Material != material )
+        {
+            commandList.SetGraphicsDynamicConstantBuffer( bindings.MaterialRootParameterIndex,
+                                                          m_Materials[draw.Material - 1]->GetMaterialProperties() );
+            material = draw.Material;
+        }
+        if ( draw.Transform != NoTransform )
+        {
+            commandList.SetGraphicsDynamicConstantBuffer( bindings.TransformRootParameterIndex, m_Transforms[draw.Transform] );
+        }
+
+        draw.Mesh->Draw( commandList, draw.InstanceCount );
+    }
+}
+
+uint64_t RenderQueue::MakeSortKey( RenderPass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth )
+{
+    const uint64_t passField { ClampField( static_cast<uint32_t>( pass ), PassBits ) };
+    const uint64_t pipelineField { ClampField( pipeline, PipelineBits ) };
+    const uint64_t materialField { ClampField( material, MaterialBits ) };
+    const uint64_t meshField { ClampField( mesh, MeshBits ) };
+    const uint64_t depthField { GetDepthField( depth ) };
+
+    if ( pass == RenderPass::Transparent )
+    {
+        const uint64_t reversedDepth { ( ( uint64_t { 1 } << DepthBits ) - 1 ) - depthField };
+        return passField << ( 64 - PassBits ) | reversedDepth << ( PipelineBits + MaterialBits + MeshBits ) |
+               pipelineField << ( MaterialBits + MeshBits ) | materialField << MeshBits | meshField;
+    }
+
+    return passField << ( 64 - PassBits ) | pipelineField << ( MaterialBits + MeshBits + DepthBits ) |
+           materialField << ( MeshBits + DepthBits ) | meshField << DepthBits | depthField;
+}
@@ -1,16 +1,48 @@
 #include <SceneVisitor.h>
 
-#include <dx12lib/CommandList.h>
-#include <dx12lib/IndexBuffer.h>
 #include <dx12lib/Mesh.h>
+#include <dx12lib/SceneNode.h>
 
 using namespace dx12lib;
+using namespace DirectX;
 
-SceneVisitor::SceneVisitor( CommandList& commandList )
-: m_CommandList( commandList )
-{}
+SceneVisitor::SceneVisitor( RenderQueue& renderQueue, RenderPass pass, uint32_t instanceCount )
+: m_RenderQueue( renderQueue )
+, m_Pass( pass )
+, m_InstanceCount( instanceCount )
+{
+    XMStoreFloat4x4( &m_NodeTransform, XMMatrixIdentity() );
+}
+
+void SceneVisitor::SetTransform( const XMMATRIX& transform, float viewDepth )
+{
+    XMStoreFloat4x4( &m_Transform, transform );
+    m_HasTransform = true;
+    m_ViewDepth    = viewDepth;
+}
+
+void SceneVisitor::SetPipeline( const std::shared_ptr<PipelineStateObject>& pipeline )
+{
+    m_Pipeline = m_RenderQueue.AddPipeline( pipeline );
+}
+
+void SceneVisitor::Visit( SceneNode& sceneNode )
+{
+    XMStoreFloat4x4( &m_NodeTransform, sceneNode.GetWorldTransform() );
+}
 
 void SceneVisitor::Visit( Mesh& mesh )
 {
-    mesh.Draw( m_CommandList );
-}
\ No newline at end of file
+    RenderQueue::Draw draw { &mesh, m_Pipeline, m_RenderQueue.AddMaterial( mesh.GetMaterial() ), RenderQueue::NoTransform,
+                             m_InstanceCount };
+
+    // Without a transform the caller binds the transforms, the draw has no depth of its own
+    float depth { 0.0f };
+    if ( m_HasTransform )
+    {
+        draw.Transform = m_RenderQueue.AddTransform( XMLoadFloat4x4( &m_NodeTransform ) * XMLoadFloat4x4( &m_Transform ) );
+        depth          = m_ViewDepth;
+    }
+
+    m_RenderQueue.Emit( m_Pass, draw, depth );
+}
@@ -0,0 +1,528 @@
+#include <SignedDistanceField.h>
+
+#include <ParallelFor.h>
+
+#include <dx12lib/Mesh.h>
+#include <dx12lib/Scene.h>
+#include <dx12lib/SceneNode.h>
+#include <dx12lib/Visitor.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace DirectX;
+
+namespace
+{
+    // Collects the triangles of every mesh of a scene in world space.
+    class TriangleCollector : public dx12lib::Visitor
+    {
+    public:
+        explicit TriangleCollector( std::vector<XMFLOAT3>& triangles )
+        : m_Triangles { triangles }
+        {}
+
+        void Visit( dx12lib::Scene& ) override {}
+
+        // Meshes are visited right after the node that owns them.
+        void Visit( dx12lib::SceneNode& sceneNode ) override
+        {
+            XMStoreFloat4x4( &m_WorldTransform, sceneNode.GetWorldTransform() );
+        }
+
+        void Visit( dx12lib::Mesh& mesh ) override
+        {
+            const std::vector<XMFLOAT3>& positions { mesh.GetCollisionPositions() };
+            const std::vector<uint32_t>& indices { mesh.GetCollisionIndices() };
+            const XMMATRIX               worldTransform { XMLoadFloat4x4( &m_WorldTransform ) };
+
+            for ( size_t i { 0 }; i + 2 < indices.size(); i += 3 )
+            {
+                if ( indices[i] >= positions.size() || indices[i + 1] >= positions.size() ||
+                     indices[i + 2] >= positions.size() )
+                    continue;
+
+                for ( size_t corner { 0 }; corner < 3; ++corner )
+                {
+                    XMFLOAT3 position {};
+                    XMStoreFloat3( &position,
+                                   XMVector3TransformCoord( XMLoadFloat3( &positions[indices[i + corner]] ), worldTransform ) );
+                    m_Triangles.push_back( position );
+                }
+            }
+        }
+
+    private:
+        std::vector<XMFLOAT3>& m_Triangles;
+        XMFLOAT4X4             m_WorldTransform { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    };
+
+    XMVECTOR ClosestPointOnTriangle( const XMVECTOR& p, const XMVECTOR& a, const XMVECTOR& b, const XMVECTOR& c )
+    {
+        const auto dot = []( const XMVECTOR& lhs, const XMVECTOR& rhs ) { return XMVectorGetX( XMVector3Dot( lhs, rhs ) ); };
+
+        const XMVECTOR ab { b - a };
+        const XMVECTOR ac { c - a };
+        const XMVECTOR ap { p - a };
+        const float    d1 { dot( ab, ap ) };
+        const float    d2 { dot( ac, ap ) };
+        if ( d1 <= 0.0f && d2 <= 0.0f ) return a;
+
+        const XMVECTOR bp { p - b };
+        const float    d3 { dot( ab, bp ) };
+        const float    d4 { dot( ac, bp ) };
+        if ( d3 >= 0.0f && d4 <= d3 ) return b;
+
+        const float vc { d1 * d4 - d3 * d2 };
+        if ( vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f ) return a + ab * ( d1 / ( d1 - d3 ) );
+
+        const XMVECTOR cp { p - c };
+        const float    d5 { dot( ab, cp ) };
+        const float    d6 { dot( ac, cp ) };
+        if ( d6 >= 0.0f && d5 <= d6 ) return c;
+
+        const float vb { d5 * d2 - d1 * d6 };
+        if ( vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f ) return a + ac * ( d2 / ( d2 - d6 ) );
+
+        const float va { d3 * d6 - d5 * d4 };
+        if ( va <= 0.0f && ( d4 - d3 ) >= 0.0f && ( d5 - d6 ) >= 0.0f )
+            return b + ( c - b ) * ( ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) ) );
+
+        const float denominator { 1.0f / ( va + vb + vc ) };
+        return a + ab * ( vb * denominator ) + ac * ( vc * denominator );
+    }
+
+    // Bounding volume hierarchy over the triangles, used to find the closest triangle of a point.
+    class TriangleBVH
+    {
+    public:
+        explicit TriangleBVH( const std::vector<XMFLOAT3>& triangles )
+        : m_Triangles { triangles }
+        {
+            const uint32_t triangleCount { static_cast<uint32_t>( triangles.size() / 3 ) };
+            m_Order.resize( triangleCount );
+            m_Centroids.resize( triangleCount );
+            for ( uint32_t i { 0 }; i < triangleCount; ++i )
+            {
+                m_Order[i] = i;
+                XMStoreFloat3( &m_Centroids[i], ( XMLoadFloat3( &triangles[i * 3] ) + XMLoadFloat3( &triangles[i * 3 + 1] ) +
+                                                  XMLoadFloat3( &triangles[i * 3 + 2] ) ) / 3.0f );
+            }
+
+            m_Nodes.reserve( 2 * triangleCount / m_LeafSize + 1 );
+            m_Nodes.emplace_back();
+            Build( 0, 0, triangleCount );
+        }
+
+        float GetSignedDistance( const XMFLOAT3& position ) const
+        {
+            const XMVECTOR p { XMLoadFloat3( &position ) };
+
+            float bestDistSq { FLT_MAX };
+            float bestFacing { 0.0f };
+            float sign { 1.0f };
+
+            uint32_t stack[64];
+            int      stackSize { 0 };
+            stack[stackSize++] = 0;
+
+            while ( stackSize > 0 )
+            {
+                const Node& node { m_Nodes[stack[--stackSize]] };
+                if ( GetBoxDistanceSq( p, node ) >= bestDistSq ) continue;
+
+                if ( node.Count == 0 )
+                {
+                    const float leftDistSq { GetBoxDistanceSq( p, m_Nodes[node.First] ) };
+                    const float rightDistSq { GetBoxDistanceSq( p, m_Nodes[node.First + 1] ) };
+
+                    // Visit the closest child first
+                    const bool leftFirst { leftDistSq <= rightDistSq };
+                    stack[stackSize++] = leftFirst ? node.First + 1 : node.First;
+                    stack[stackSize++] = leftFirst ? node.First : node.First + 1;
+                    continue;
+                }
+
+                for ( uint32_t i { node.First }; i < node.First + node.Count; ++i )
+                {
+                    const uint32_t triangle { m_Order[i] };
+                    const XMVECTOR a { XMLoadFloat3( &m_Triangles[triangle * 3] ) };
+                    const XMVECTOR b { XMLoadFloat3( &m_Triangles[triangle * 3 + 1] ) };
+                    const XMVECTOR c { XMLoadFloat3( &m_Triangles[triangle * 3 + 2] ) };
+
+                    const XMVECTOR offset { p - ClosestPointOnTriangle( p, a, b, c ) };
+                    const XMVECTOR normal { XMVector3Normalize( XMVector3Cross( b - a, c - a ) ) };
+                    const float    distSq { XMVectorGetX( XMVector3LengthSq( offset ) ) };
+                    const float    facing { std::abs( XMVectorGetX( XMVector3Dot( XMVector3Normalize( offset ), normal ) ) ) };
+
+                    // When the closest point is on an edge or a vertex several triangles are as close,
+                    // the one facing the point gives the most reliable sign.
+                    const float epsilon { bestDistSq * 1e-4f };
+                    const bool  isCloser { distSq < bestDistSq - epsilon };
+                    const bool  isTie { !isCloser && distSq <= bestDistSq + epsilon && facing > bestFacing };
+                    if ( isCloser || isTie )
+                    {
+                        bestDistSq = distSq;
+                        bestFacing = facing;
+                        sign       = XMVectorGetX( XMVector3Dot( offset, normal ) ) < 0.0f ? -1.0f : 1.0f;
+                    }
+                }
+            }
+
+            return sign * std::sqrt( bestDistSq );
+        }
+
+    private:
+        struct Node
+        {
+            XMFLOAT3 Min;
+            uint32_t First;  // First triangle for leaves, left child for inner nodes
+            XMFLOAT3 Max;
+            uint32_t Count;  // 0 for inner nodes
+        };
+
+        static constexpr uint32_t m_LeafSize { 4 };
+
+        static float GetBoxDistanceSq( const XMVECTOR& p, const Node& node )
+        {
+            const XMVECTOR boxMin { XMLoadFloat3( &node.Min ) };
+            const XMVECTOR boxMax { XMLoadFloat3( &node.Max ) };
+            const XMVECTOR outside { XMVectorMax( XMVectorMax( boxMin - p, p - boxMax ), XMVectorZero() ) };
+            return XMVectorGetX( XMVector3LengthSq( outside ) );
+        }
+
+        void Build( uint32_t nodeIndex, uint32_t first, uint32_t count )
+        {
+            XMVECTOR boxMin { XMVectorReplicate( FLT_MAX ) };
+            XMVECTOR boxMax { XMVectorReplicate( -FLT_MAX ) };
+            XMVECTOR centroidMin { boxMin };
+            XMVECTOR centroidMax { boxMax };
+            for ( uint32_t i { first }; i < first + count; ++i )
+            {
+                for ( uint32_t corner { 0 }; corner < 3; ++corner )
+                {
+                    const XMVECTOR position { XMLoadFloat3( &m_Triangles[m_Order[i] * 3 + corner] ) };
+                    boxMin = XMVectorMin( boxMin, position );
+                    boxMax = XMVectorMax( boxMax, position );
+                }
+                const XMVECTOR centroid { XMLoadFloat3( &m_Centroids[m_Order[i]] ) };
+                centroidMin = XMVectorMin( centroidMin, centroid );
+                centroidMax = XMVectorMax( centroidMax, centroid );
+            }
+            XMStoreFloat3( &m_Nodes[nodeIndex].Min, boxMin );
+            XMStoreFloat3( &m_Nodes[nodeIndex].Max, boxMax );
+
+            if ( count <= m_LeafSize )
+            {
+                m_Nodes[nodeIndex].First = first;
+                m_Nodes[nodeIndex].Count = count;
+                return;
+            }
+
+            // Median split along the largest extent of the centroids
+            XMFLOAT3 extent {};
+            XMStoreFloat3( &extent, centroidMax - centroidMin );
+            const int axis { extent.x >= extent.y && extent.x >= extent.z ? 0 : ( extent.y >= extent.z ? 1 : 2 ) };
+
+            const uint32_t middle { first + count / 2 };
+            std::nth_element( m_Order.begin() + first, m_Order.begin() + middle, m_Order.begin() + first + count,
+                              [this, axis]( uint32_t lhs, uint32_t rhs ) {
+                                  return ( &m_Centroids[lhs].x )[axis] < ( &m_Centroids[rhs].x )[axis];
+                              } );
+
+            const uint32_t left { static_cast<uint32_t>( m_Nodes.size() ) };
+            m_Nodes.emplace_back();
+            m_Nodes.emplace_back();
+            m_Nodes[nodeIndex].First = left;
+            m_Nodes[nodeIndex].Count = 0;
+
+            Build( left, first, middle - first );
+            Build( left + 1, middle, first + count - middle );
+        }
+
+        const std::vector<XMFLOAT3>& m_Triangles;
+        std::vector<uint32_t>        m_Order {};
+        std::vector<XMFLOAT3>        m_Centroids {};
+        std::vector<Node>            m_Nodes {};
+    };
+
+    uint64_t HashBytes( uint64_t hash, const void* data, size_t size )
+    {
+        // FNV-1a
+        const unsigned char* bytes { static_cast<const unsigned char*>( data ) };
+        for ( size_t i { 0 }; i < size; ++i )
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+std::shared_ptr<SignedDistanceField> SignedDistanceField::Bake( dx12lib::Scene& scene, const BakeSettings& settings )
+{
+    if ( settings.VoxelSize <= 0.0f ) return nullptr;
+
+    std::vector<XMFLOAT3> triangles {};
+    TriangleCollector     collector { triangles };
+    scene.Accept( collector );
+    if ( triangles.empty() ) return nullptr;
+
+    uint64_t hash { 14695981039346656037ull };
+    hash = HashBytes( hash, triangles.data(), triangles.size() * sizeof( XMFLOAT3 ) );
+    hash = HashBytes( hash, &settings.VoxelSize, sizeof( float ) );
+    hash = HashBytes( hash, &settings.Band, sizeof( float ) );
+    hash = HashBytes( hash, &settings.Padding, sizeof( float ) );
+    hash = HashBytes( hash, &m_Version, sizeof( uint32_t ) );
+
+    std::wstringstream cacheName {};
+    cacheName << std::hex << std::setw( 16 ) << std::setfill( L'0' ) << hash << L".sdf";
+    const std::filesystem::path cachePath { std::filesystem::path { settings.CacheDirectory } / cacheName.str() };
+
+    std::shared_ptr<SignedDistanceField> field { std::make_shared<SignedDistanceField>() };
+    if ( field->Load( cachePath.wstring() ) ) return field;
+
+    field->Build( triangles, settings );
+    field->Save( cachePath.wstring() );
+    return field;
+}
+
+void SignedDistanceField::Build( const std::vector<XMFLOAT3>& triangles, const BakeSettings& settings )
+{
+    XMVECTOR boundsMin { XMVectorReplicate( FLT_MAX ) };
+    XMVECTOR boundsMax { XMVectorReplicate( -FLT_MAX ) };
+    for ( const XMFLOAT3& position: triangles )
+    {
+        boundsMin = XMVectorMin( boundsMin, XMLoadFloat3( &position ) );
+        boundsMax = XMVectorMax( boundsMax, XMLoadFloat3( &position ) );
+    }
+    boundsMin -= XMVectorReplicate( settings.Padding );
+    boundsMax += XMVectorReplicate( settings.Padding );
+
+    XMFLOAT3 extent {};
+    XMStoreFloat3( &extent, boundsMax - boundsMin );
+    XMStoreFloat3( &m_Origin, boundsMin );
+    m_VoxelSize = settings.VoxelSize;
+
+    const float axisExtent[3] { extent.x, extent.y, extent.z };
+    for ( int axis { 0 }; axis < 3; ++axis )
+    {
+        const uint32_t cells { std::max( 1u, static_cast<uint32_t>( std::ceil( axisExtent[axis] / m_VoxelSize ) ) ) };
+        m_Bricks[axis] = ( cells + BrickSize - 1 ) / BrickSize;
+    }
+
+    const size_t brickCount { static_cast<size_t>( m_Bricks[0] ) * m_Bricks[1] * m_Bricks[2] };
+    const float  brickExtent { BrickSize * m_VoxelSize };
+    const float  storeDistance { 0.5f * brickExtent * std::sqrt( 3.0f ) + settings.Band };
+
+    const TriangleBVH bvh { triangles };
+
+    const auto getBrickCoordinates = [this]( size_t brick, uint32_t coordinates[3] ) {
+        coordinates[0] = static_cast<uint32_t>( brick % m_Bricks[0] );
+        coordinates[1] = static_cast<uint32_t>( ( brick / m_Bricks[0] ) % m_Bricks[1] );
+        coordinates[2] = static_cast<uint32_t>( brick / ( static_cast<size_t>( m_Bricks[0] ) * m_Bricks[1] ) );
+    };
+
+    // First pass: distance at the center of every brick decides which bricks are stored.
+    m_BrickDistances.resize( brickCount );
+    Parallel::ForEachChunk( brickCount, 1, [&]( size_t, size_t begin, size_t end ) {
+        for ( size_t brick { begin }; brick < end; ++brick )
+        {
+            uint32_t coordinates[3];
+            getBrickCoordinates( brick, coordinates );
+            const XMFLOAT3 center { m_Origin.x + ( coordinates[0] + 0.5f ) * brickExtent,
+                                    m_Origin.y + ( coordinates[1] + 0.5f ) * brickExtent,
+                                    m_Origin.z + ( coordinates[2] + 0.5f ) * brickExtent };
+            m_BrickDistances[brick] = bvh.GetSignedDistance( center );
+        }
+    } );
+
+    m_BrickSlots.resize( brickCount );
+    int32_t storedBricks { 0 };
+    for ( size_t brick { 0 }; brick < brickCount; ++brick )
+    {
+        m_BrickSlots[brick] = std::abs( m_BrickDistances[brick] ) <= storeDistance ? storedBricks++ : -1;
+    }
+
+    // Second pass: corner distances of the stored bricks.
+    constexpr size_t samplesPerBrick { BrickSamples * BrickSamples * BrickSamples };
+    m_Samples.resize( storedBricks * samplesPerBrick );
+    Parallel::ForEachChunk( brickCount, 1, [&]( size_t, size_t begin, size_t end ) {
+        for ( size_t brick { begin }; brick < end; ++brick )
+        {
+            if ( m_BrickSlots[brick] < 0 ) continue;
+
+            uint32_t coordinates[3];
+            getBrickCoordinates( brick, coordinates );
+
+            float* samples { m_Samples.data() + m_BrickSlots[brick] * samplesPerBrick };
+            for ( uint32_t z { 0 }; z < BrickSamples; ++z )
+            {
+                for ( uint32_t y { 0 }; y < BrickSamples; ++y )
+                {
+                    for ( uint32_t x { 0 }; x < BrickSamples; ++x )
+                    {
+                        const XMFLOAT3 position { m_Origin.x + ( coordinates[0] * BrickSize + x ) * m_VoxelSize,
+                                                  m_Origin.y + ( coordinates[1] * BrickSize + y ) * m_VoxelSize,
+                                                  m_Origin.z + ( coordinates[2] * BrickSize + z ) * m_VoxelSize };
+                        samples[( z * BrickSamples + y ) * BrickSamples + x] = bvh.GetSignedDistance( position );
+                    }
+                }
+            }
+        }
+    } );
+}
+
+bool SignedDistanceField::Load( const std::wstring& fileName )
+{
+    std::ifstream file { std::filesystem::path { fileName }, std::ios::binary };
+    if ( !file ) return false;
+
+    Header header {};
+    file.read( reinterpret_cast<char*>( &header ), sizeof( Header ) );
+    if ( !file || !std::equal( std::begin( m_Magic ), std::end( m_Magic ), header.Magic ) ) return false;
+    if ( header.Version != m_Version || header.BrickSize != BrickSize ) return false;
+
+    const size_t brickCount { static_cast<size_t>( header.Bricks[0] ) * header.Bricks[1] * header.Bricks[2] };
+    m_BrickSlots.resize( brickCount );
+    m_BrickDistances.resize( brickCount );
+    m_Samples.resize( static_cast<size_t>( header.StoredBricks ) * BrickSamples * BrickSamples * BrickSamples );
+
+    file.read( reinterpret_cast<char*>( m_BrickSlots.data() ), m_BrickSlots.size() * sizeof( int32_t ) );
+    file.read( reinterpret_cast<char*>( m_BrickDistances.data() ), m_BrickDistances.size() * sizeof( float ) );
+    file.read( reinterpret_cast<char*>( m_Samples.data() ), m_Samples.size() * sizeof( float ) );
+    if ( !file || brickCount == 0 ) return false;
+
+    for ( const int32_t slot: m_BrickSlots )
+    {
+        if ( slot >= static_cast<int32_t>( header.StoredBricks ) ) return false;
+    }
+
+    std::copy( std::begin( header.Bricks ), std::end( header.Bricks ), m_Bricks );
+    m_Origin    = XMFLOAT3 { header.Origin[0], header.Origin[1], header.Origin[2] };
+    m_VoxelSize = header.VoxelSize;
+    return true;
+}
+
+bool SignedDistanceField::Save( const std::wstring& fileName ) const
+{
+    const std::filesystem::path path { fileName };
+    std::error_code             error {};
+    std::filesystem::create_directories( path.parent_path(), error );
+
+    std::ofstream file { path, std::ios::binary | std::ios::trunc };
+    if ( !file ) return false;
+
+    Header header {};
+    std::copy( std::begin( m_Magic ), std::end( m_Magic ), header.Magic );
+    header.Version   = m_Version;
+    header.BrickSize = BrickSize;
+    std::copy( std::begin( m_Bricks ), std::end( m_Bricks ), header.Bricks );
+    header.Origin[0]    = m_Origin.x;
+    header.Origin[1]    = m_Origin.y;
+    header.Origin[2]    = m_Origin.z;
+    header.VoxelSize    = m_VoxelSize;
+    header.StoredBricks = static_cast<uint32_t>( GetStoredBrickCount() );
+
+    file.write( reinterpret_cast<const char*>( &header ), sizeof( Header ) );
+    file.write( reinterpret_cast<const char*>( m_BrickSlots.data() ), m_BrickSlots.size() * sizeof( int32_t ) );
+    file.write( reinterpret_cast<const char*>( m_BrickDistances.data() ), m_BrickDistances.size() * sizeof( float ) );
+    file.write( reinterpret_cast<const char*>( m_Samples.data() ), m_Samples.size() * sizeof( float ) );
+    return static_cast<bool>( file );
+}
+
+float SignedDistanceField::GetDistance( const XMFLOAT3& position ) const
+{
+    const float worldPosition[3] { position.x, position.y, position.z };
+    const float origin[3] { m_Origin.x, m_Origin.y, m_Origin.z };
+
+    float    inBrick[3] {};
+    uint32_t brick[3] {};
+    float    outsideSq { 0.0f };
+    for ( int axis { 0 }; axis < 3; ++axis )
+    {
+        const float cells { static_cast<float>( m_Bricks[axis] * BrickSize ) };
+        const float local { ( worldPosition[axis] - origin[axis] ) / m_VoxelSize };
+        const float clamped { std::clamp( local, 0.0f, cells ) };
+        outsideSq += ( local - clamped ) * ( local - clamped );
+
+        brick[axis]   = std::min( static_cast<uint32_t>( clamped ) / BrickSize, m_Bricks[axis] - 1 );
+        inBrick[axis] = clamped - static_cast<float>( brick[axis] * BrickSize );
+    }
+
+    const size_t brickIndex { GetBrickIndex( brick[0], brick[1], brick[2] ) };
+    const int32_t slot { m_BrickSlots[brickIndex] };
+
+    float distance { m_BrickDistances[brickIndex] };
+    if ( slot >= 0 )
+    {
+        uint32_t base[3] {};
+        float    weight[3] {};
+        for ( int axis { 0 }; axis < 3; ++axis )
+        {
+            base[axis]   = std::min( static_cast<uint32_t>( inBrick[axis] ), BrickSize - 1 );
+            weight[axis] = inBrick[axis] - static_cast<float>( base[axis] );
+        }
+
+        const float* samples { m_Samples.data() + slot * static_cast<size_t>( BrickSamples * BrickSamples * BrickSamples ) };
+        const auto   sample = [samples]( uint32_t x, uint32_t y, uint32_t z ) {
+            return samples[( z * BrickSamples + y ) * BrickSamples + x];
+        };
+        const auto lerp = []( float a, float b, float t ) { return a + ( b - a ) * t; };
+
+        const float x00 { lerp( sample( base[0], base[1], base[2] ), sample( base[0] + 1, base[1], base[2] ), weight[0] ) };
+        const float x10 { lerp( sample( base[0], base[1] + 1, base[2] ), sample( base[0] + 1, base[1] + 1, base[2] ), weight[0] ) };
+        const float x01 { lerp( sample( base[0], base[1], base[2] + 1 ), sample( base[0] + 1, base[1], base[2] + 1 ), weight[0] ) };
+        const float x11 { lerp( sample( base[0], base[1] + 1, base[2] + 1 ), sample( base[0] + 1, base[1] + 1, base[2] + 1 ), weight[0] ) };
+        distance = lerp( lerp( x00, x10, weight[1] ), lerp( x01, x11, weight[1] ), weight[2] );
+    }
+
+    // Outside the volume: add the distance to the volume.
+    return outsideSq > 0.0f ? distance + std::sqrt( outsideSq ) * m_VoxelSize : distance;
+}
+
+XMFLOAT3 SignedDistanceField::GetNormal( const XMFLOAT3& position ) const
+{
+    const float h { m_VoxelSize * 0.5f };
+    const auto  distance = [this, &position]( float x, float y, float z ) {
+        return GetDistance( XMFLOAT3 { position.x + x, position.y + y, position.z + z } );
+    };
+
+    const XMVECTOR gradient { XMVectorSet( distance( h, 0, 0 ) - distance( -h, 0, 0 ), distance( 0, h, 0 ) - distance( 0, -h, 0 ),
+                                           distance( 0, 0, h ) - distance( 0, 0, -h ), 0.0f ) };
+
+    XMFLOAT3 normal { 0.0f, 1.0f, 0.0f };
+    if ( XMVectorGetX( XMVector3LengthSq( gradient ) ) > 0.0f )
+    {
+        XMStoreFloat3( &normal, XMVector3Normalize( gradient ) );
+    }
+    return normal;
+}
+
+bool SignedDistanceField::Collide( XMFLOAT3& position, XMFLOAT3& velocity, float radius, float bounce,
+                                   float friction, XMFLOAT3* contactNormal ) const
+{
+    const float distance { GetDistance( position ) };
+    if ( distance >= radius ) return false;
+
+    const XMFLOAT3 normalValue { GetNormal( position ) };
+    const XMVECTOR normal { XMLoadFloat3( &normalValue ) };
+    if ( contactNormal ) *contactNormal = normalValue;
+
+    // Push the sphere back on the surface
+    XMStoreFloat3( &position, XMLoadFloat3( &position ) + normal * ( radius - distance ) );
+
+    // Reflect the part of the velocity going into the surface and damp the part sliding along it
+    const XMVECTOR v { XMLoadFloat3( &velocity ) };
+    const float    normalSpeed { XMVectorGetX( XMVector3Dot( v, normal ) ) };
+    const XMVECTOR tangent { v - normal * normalSpeed };
+    const float    newNormalSpeed { normalSpeed < 0.0f ? -normalSpeed * bounce : normalSpeed };
+
+    XMStoreFloat3( &velocity, normal * newNormalSpeed + tangent * ( 1.0f - friction ) );
+    return true;
+}
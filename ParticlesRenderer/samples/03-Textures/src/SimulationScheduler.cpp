@@ -0,0 +1,80 @@
+#include <SimulationScheduler.h>
+
+#include <Camera.h>
+#include <FrustumCulling.h>
+#include <ParticleSystem.h>
+#include <Profiler.h>
+
+#include <algorithm>
+
+using namespace DirectX;
+
+void SimulationScheduler::Register( ParticleSystem& system, int priority )
+{
+    m_Entries.emplace_back( Entry { &system, priority } );
+}
+
+void SimulationScheduler::Unregister( const ParticleSystem& system )
+{
+    m_Entries.erase( std::remove_if( m_Entries.begin(), m_Entries.end(),
+                                     [&system]( const Entry& entry ) { return entry.System == &system; } ),
+                     m_Entries.end() );
+}
+
+bool SimulationScheduler::IsRegistered( const ParticleSystem& system ) const
+{
+    return std::any_of( m_Entries.begin(), m_Entries.end(), [&system]( const Entry& entry ) { return entry.System == &system; } );
+}
+
+void SimulationScheduler::Update( const Camera& camera, Profiler& profiler )
+{
+    // Systems sharing a rate take the next phase of that rate
+    uint32_t nextPhases[MaxLevel + 1] {};
+
+    double simulatedParticles { 0.0 };
+    double skippedParticles { 0.0 };
+    for ( const Entry& entry: m_Entries )
+    {
+        const uint32_t level { ComputeLevel( entry, camera ) };
+        const uint32_t period { 1u << level };
+        const uint32_t phase { nextPhases[level]++ % period };
+
+        const bool isSimulationFrame { ( m_Frame + phase ) % period == 0 };
+        entry.System->ScheduleSimulation( period, isSimulationFrame );
+
+        const double particleCount { static_cast<double>( entry.System->GetParticleCount() ) };
+        ( isSimulationFrame ? simulatedParticles : skippedParticles ) += particleCount;
+    }
+    ++m_Frame;
+
+    const double totalParticles { simulatedParticles + skippedParticles };
+    profiler.AddCount( "SimulationLOD/SimulatedParticles", simulatedParticles );
+    profiler.AddCount( "SimulationLOD/SkippedParticles", skippedParticles );
+    profiler.AddCount( "SimulationLOD/Savings", totalParticles > 0.0 ? skippedParticles / totalParticles : 0.0 );
+}
+
+uint32_t SimulationScheduler::ComputeLevel( const Entry& entry, const Camera& camera ) const
+{
+    const XMMATRIX projectionMatrix { camera.get_ProjectionMatrix() };
+    const XMMATRIX viewProjectionMatrix { camera.get_ViewMatrix() * projectionMatrix };
+
+    uint32_t level { 0 };
+    if ( FrustumPlanes::FromViewProjection( viewProjectionMatrix ).Contains( entry.System->GetBounds() ) == DISJOINT )
+    {
+        level = MaxLevel;
+    }
+    else
+    {
+        // Fraction of the screen height covered by the bounding sphere
+        const BoundingSphere sphere { entry.System->GetBoundingSphere() };
+        const float          distance { XMVectorGetX( XMVector3Length( XMLoadFloat3( &sphere.Center ) - camera.get_Translation() ) ) };
+        const float          screenSize { distance <= sphere.Radius ? 1.0f
+                                                                    : sphere.Radius * XMVectorGetY( projectionMatrix.r[1] ) / distance };
+        while ( level < MaxLevel && screenSize < m_LevelScreenSizes[level] )
+        {
+            ++level;
+        }
+    }
+
+    return static_cast<uint32_t>( std::clamp( static_cast<int>( level + m_LevelBias ) - entry.Priority, 0, static_cast<int>( MaxLevel ) ) );
+}
@@ -2,7 +2,9 @@
 
 #include <TestApplication.h>
 
-#include <SceneVisitor.h>
+#include <D3D12InstanceBufferBackend.h>
+#include <SignedDistanceField.h>
+#include <VectorFieldVolume.h>
 
 #include <GameFramework/GameFramework.h>
 #include <GameFramework/Window.h>
@@ -28,8 +30,11 @@ using namespace dx12lib;
 using namespace DirectX;
 
 #include <algorithm>  // For std::min, std::max, and std::clamp.
+#include <chrono>
+#include <fstream>
 #include <functional>  // For std::bind
 #include <string>// For std::wstring
+#include <thread>
 
 
 struct LightProperties
@@ -132,6 +137,30 @@ bool TestApplication::LoadContent()
 
     //Init particles
     m_ParticleSystem.Initialize(*m_CommandList);
+    m_ParticleSystem.SetReorderInterval( m_ReorderInterval );
+    m_ParticleSystem.SetCullingEnabled( m_IsCullingEnabled );
+    m_ParticleSystem.SetBoundsInterval( m_BoundsInterval );
+    m_ParticleSystem.SetViewportSize( static_cast<float>( m_Width ), static_cast<float>( m_Height ) );
+    m_ParticleSystem.SetCoverageEnabled( m_IsCoverageEnabled );
+    m_ParticleSystem.SetPackingEnabled( m_IsUsingMeshShaders && m_IsUsingPackedParticles, m_IsValidatingPackedParticles );
+    m_ParticleSystem.SetFusedKernelEnabled( m_IsUsingFusedKernel );
+    m_ParticleSystem.SetInstancedDrawsEnabled( !m_IsUsingMeshShaders && m_IsUsingInstancedDraws );
+    if ( ( m_IsUsingMeshShaders || m_IsUsingInstancedDraws ) && m_IsUsingInstanceBufferRing )
+    {
+        m_ParticleSystem.SetInstanceBufferBackend( std::make_unique<D3D12InstanceBufferBackend>( *m_Device, m_Device->GetCommandQueue( D3D12_COMMAND_LIST_TYPE_DIRECT ) ) );
+    }
+    if ( m_IsBudgetEnabled || m_IsQualityGovernorEnabled )
+    {
+        m_BudgetManager.Register( m_ParticleSystem, "Particles" );
+    }
+    if ( m_IsQualityGovernorEnabled )
+    {
+        ApplyGovernorKnobs();
+    }
+    ApplyQuality();
+    InitializeForceFields();
+    InitializeCollider();
+    InitializeInstances();
 
     //init pipeline
     if (!m_IsUsingMeshShaders)
@@ -145,6 +174,7 @@ bool TestApplication::LoadContent()
     
 
     InitializeColors();
+    InitializeTuning();
 
 
     commandQueue.Flush();  // Wait for loading operations to complete before rendering the first frame.
@@ -161,6 +191,7 @@ void TestApplication::OnResize( const ResizeEventArgs& event )
 
     float aspectRatio = static_cast<float>(m_Width) / static_cast<float>(m_Height);
     m_Camera.set_Projection( 45.0f, aspectRatio, 0.1f, 100.0f );
+    m_ParticleSystem.SetViewportSize( static_cast<float>( m_Width ), static_cast<float>( m_Height ) );
 
     m_Viewport = CD3DX12_VIEWPORT( 0.0f, 0.0f, static_cast<float>( m_Width ), static_cast<float>( m_Height ) );
 
@@ -174,7 +205,8 @@ void TestApplication::CreateGeometryShaderPipeline( CommandQueue& commandQueue )
 
     // Load the vertex shader.
     ComPtr<ID3DBlob> vertexShaderBlob{};
-    ThrowIfFailed( D3DReadFileToBlob( L"data/shaders/03-Textures/VertexShader.cso", &vertexShaderBlob ) );
+    ThrowIfFailed( D3DReadFileToBlob( m_IsUsingInstancedDraws ? L"data/shaders/03-Textures/VertexShaderInstanced.cso"
+                                                               : L"data/shaders/03-Textures/VertexShader.cso", &vertexShaderBlob ) );
 
     // Load the pixel shader.
     ComPtr<ID3DBlob> pixelShaderBlob{};
@@ -182,7 +214,8 @@ void TestApplication::CreateGeometryShaderPipeline( CommandQueue& commandQueue )
 
     // Load the pixel shader.
     ComPtr<ID3DBlob> geometryShaderBlob {};
-    ThrowIfFailed( D3DReadFileToBlob( L"data/shaders/03-Textures/GeometryShader.cso", &geometryShaderBlob ) );
+    ThrowIfFailed( D3DReadFileToBlob( m_IsUsingInstancedDraws ? L"data/shaders/03-Textures/GeometryShaderInstanced.cso"
+                                                               : L"data/shaders/03-Textures/GeometryShader.cso", &geometryShaderBlob ) );
 
     CreateRootSignature(D3D12_SHADER_VISIBILITY_ALL, D3D12_SHADER_VISIBILITY_GEOMETRY, D3D12_SHADER_VISIBILITY_VERTEX);
 
@@ -224,10 +257,6 @@ void TestApplication::CreateMeshShaderPipeline( dx12lib::CommandQueue& commandQu
 {
     commandQueue.ExecuteCommandList( m_CommandList );
 
-    // Load the vertex shader.
-    ComPtr<ID3DBlob> meshShaderBlob{};
-    ThrowIfFailed( D3DReadFileToBlob( L"data/shaders/03-Textures/MeshShader.cso", &meshShaderBlob ) );
-
     // Load the pixel shader.
     ComPtr<ID3DBlob> pixelShaderBlob{};
     ThrowIfFailed( D3DReadFileToBlob( L"data/shaders/03-Textures/PixelShader.cso", &pixelShaderBlob ) );
@@ -257,14 +286,24 @@ void TestApplication::CreateMeshShaderPipeline( dx12lib::CommandQueue& commandQu
     pipelineStateStream.pRootSignature = m_RootSignature->GetD3D12RootSignature().Get();
     pipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
     pipelineStateStream.PS         = CD3DX12_SHADER_BYTECODE( pixelShaderBlob.Get() );
-    pipelineStateStream.MS         = CD3DX12_SHADER_BYTECODE( meshShaderBlob.Get() );  // Mesh shader
     pipelineStateStream.DSVFormat  = m_DepthBufferFormat;
     pipelineStateStream.RTVFormats = rtvFormats;
     pipelineStateStream.SampleDesc = m_SampleDesc;
 
+    // One pipeline per group size variant of the mesh shader, 64 particles per group by default
+    for ( const uint32_t groupSize: { 64u, 32u, 16u } )
+    {
+        const std::wstring fileName { std::wstring { m_IsUsingPackedParticles ? L"data/shaders/03-Textures/MeshShaderPacked"
+                                                                               : L"data/shaders/03-Textures/MeshShader" } +
+                                      ( groupSize == 64 ? L"" : std::to_wstring( groupSize ) ) + L".cso" };
+        ComPtr<ID3DBlob> meshShaderBlob {};
+        ThrowIfFailed( D3DReadFileToBlob( fileName.c_str(), &meshShaderBlob ) );
+
+        pipelineStateStream.MS = CD3DX12_SHADER_BYTECODE( meshShaderBlob.Get() );  // Mesh shader
+        m_GroupSizePipelineStates[groupSize] = m_Device->CreatePipelineStateObject( pipelineStateStream );
+    }
 
-    
-    m_PipelineState = m_Device->CreatePipelineStateObject( pipelineStateStream );
+    m_PipelineState = m_GroupSizePipelineStates[m_ParticleSystem.GetTuning().ParticlesPerGroup];
     m_CommandList->SetPipelineState( m_PipelineState );
     m_CommandList->SetGraphicsRootSignature( m_RootSignature );
 }
@@ -314,6 +353,51 @@ void TestApplication::InitializeColors()
     m_RenderTarget.AttachTexture( AttachmentPoint::DepthStencil, depthTexture );
 }
 
+void TestApplication::InitializeForceFields()
+{
+    if (!m_IsForceFieldsEnabled) return;
+
+    ForceFieldSet& forceFields { m_ParticleSystem.GetForceFields() };
+    forceFields.AddAttractor( PointAttractor { XMFLOAT3 { 0.0f, 3.0f, 0.0f }, 2.0f, 1.0f } );
+    forceFields.AddVortex( Vortex { XMFLOAT3 { 0.0f, 3.0f, 0.0f }, XMFLOAT3 { 0.0f, 0.0f, 1.0f }, 1.5f, 0.5f } );
+    forceFields.AddDrag( LinearDrag { 0.1f } );
+    forceFields.AddWind( Wind { XMFLOAT3 { 0.5f, 0.0f, 0.0f }, 0.05f } );
+    forceFields.AddCurlNoise( CurlNoise { 0.5f, 0.5f, 0.25f } );
+
+    if ( *m_VectorFieldFile != L'\0' )
+    {
+        forceFields.AddVolume( VolumeField { VectorFieldVolume::Load( m_VectorFieldFile ), XMFLOAT3 { 0.0f, 3.0f, 0.0f }, 1.0f, 1.0f, 0.0f } );
+    }
+}
+
+void TestApplication::InitializeCollider()
+{
+    if ( *m_ColliderSceneFile == L'\0' ) return;
+
+    //only the collider keeps a CPU copy of its geometry, to bake the field
+    std::shared_ptr<Scene> colliderScene { m_CommandList->LoadSceneFromFile( m_ColliderSceneFile, {}, true ) };
+    if (!colliderScene) return;
+
+    const SignedDistanceField::BakeSettings bakeSettings { 0.25f, 1.0f, 1.0f, L"Cache/SDF" };
+    m_ParticleSystem.SetCollider( SignedDistanceField::Bake( *colliderScene, bakeSettings ) );
+}
+
+void TestApplication::InitializeInstances()
+{
+    //placements on a grid around the emitter, with time offsets cycling over 4 placements
+    const float center { static_cast<float>( m_InstanceGridSize - 1 ) * 0.5f };
+    for ( int x { 0 }; x < m_InstanceGridSize; ++x )
+    {
+        for ( int z { 0 }; z < m_InstanceGridSize; ++z )
+        {
+            XMFLOAT4X4 transform {};
+            XMStoreFloat4x4( &transform, XMMatrixTranslation( ( static_cast<float>( x ) - center ) * m_InstanceSpacing, 0.0f,
+                                                              ( static_cast<float>( z ) - center ) * m_InstanceSpacing ) );
+            m_ParticleSystem.AddInstance( transform, static_cast<float>( ( x * m_InstanceGridSize + z ) % 4 ) * m_InstanceTimeOffset );
+        }
+    }
+}
+
 void TestApplication::CreateRootSignature( const D3D12_SHADER_VISIBILITY& matricesVisibility,
                                      const D3D12_SHADER_VISIBILITY& fovSizeParticlesVisibility,
                                      const D3D12_SHADER_VISIBILITY& matrixVisibility )
@@ -340,6 +424,10 @@ void TestApplication::CreateRootSignature( const D3D12_SHADER_VISIBILITY& matric
     rootParameters[RootParameters::FOVSizeAndNBParticles].InitAsConstants( 3, 1, 0, fovSizeParticlesVisibility );
     rootParameters[RootParameters::MatricesSRV].InitAsShaderResourceView( 0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE,
                                                                           matrixVisibility );
+    rootParameters[RootParameters::PackedParticlesCB].InitAsConstantBufferView( 2, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE,
+                                                                                matrixVisibility );
+    rootParameters[RootParameters::InstanceOffset].InitAsConstants( 1, 3, 0, matrixVisibility );
+    rootParameters[RootParameters::MeshDispatchCB].InitAsConstants( 4, 4, 0, matrixVisibility );
 
     CD3DX12_STATIC_SAMPLER_DESC linearRepeatSampler( 0, D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR );
 
@@ -351,10 +439,13 @@ void TestApplication::CreateRootSignature( const D3D12_SHADER_VISIBILITY& matric
 
 void TestApplication::UnloadContent()
 {
+    //waits for the frames still using the instance buffers
+    m_ParticleSystem.SetInstanceBufferBackend( nullptr );
     m_RenderTarget.Reset();
 
     m_RootSignature.reset();
     m_PipelineState.reset();
+    m_GroupSizePipelineStates.clear();
 
     //m_GUI.reset();
     m_SwapChain.reset();
@@ -369,18 +460,161 @@ void TestApplication::OnUpdate( UpdateEventArgs& e )
     };
 
     m_SwapChain->WaitForSwapChain();
-    m_ParticleSystem.Update(e.DeltaTime, m_Camera, m_FPSCounter, m_MemoryCounter);
+    const auto frameStart { std::chrono::high_resolution_clock::now() };
+
+    m_BudgetManager.Update( m_Camera, m_Profiler );
+    m_SimulationScheduler.Update( m_Camera, m_Profiler );
+    m_ParticleSystem.Update(e.DeltaTime, m_Camera, m_FPSCounter, m_MemoryCounter, m_Profiler);
 
     OnRender();
     UpdateCamera( static_cast<float>( e.DeltaTime ) );
+
+    //the cpu time of the frame, without the wait for the swap chain
+    const double frameMilliseconds { std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - frameStart ).count() };
+    if ( m_IsQualityGovernorEnabled && m_QualityGovernor.Update( frameMilliseconds, m_Profiler ) )
+    {
+        ApplyGovernorKnobs();
+        ApplyQuality();
+    }
+    if ( m_Autotuner )
+    {
+        //the whole frame period: the gpu cost of the parameters only shows in the wait for the swap chain
+        UpdateAutotuning( e.DeltaTime * 1000.0 );
+    }
+    m_Profiler.EndFrame();
+}
+
+void TestApplication::InitializeTuning()
+{
+    m_MachineName = ConvertString( m_Device->GetDescription() ) + ", " + std::to_string( std::thread::hardware_concurrency() ) + " threads";
+
+    if ( !m_IsAutotuning )
+    {
+        //tuned by an earlier run on this machine, the defaults otherwise
+        Autotuner::Configuration configuration {};
+        if ( Autotuner::LoadConfiguration( m_TuningFile, m_MachineName, configuration ) )
+        {
+            m_Logger->info( "Tuning loaded from {}", m_TuningFile );
+            ApplyTuning( configuration );
+        }
+        return;
+    }
+
+    //only the parameters of the current path, the others would multiply the candidates for nothing
+    std::vector<Autotuner::Parameter> parameters { { "UpdateChunkSize", { 1024, 256, 4096, 16384 } } };
+    if ( m_IsUsingMeshShaders )
+    {
+        parameters.push_back( { "ParticlesPerGroup", { 64, 32, 16 } } );
+    }
+    else if ( m_IsUsingInstancedDraws )
+    {
+        parameters.push_back( { "InstancesPerDraw", { 1 << 18, 1 << 12, 1 << 16 } } );
+    }
+    m_Autotuner = std::make_unique<Autotuner>( std::move( parameters ), m_AutotuneSettings );
+
+    //the same load for every trial
+    m_ParticleSystem.SetSampleGrowthEnabled( false );
+    m_ParticleSystem.AddParticleAmount( m_AutotuneParticleCount - static_cast<int>( m_ParticleSystem.GetRequestedParticleCount() ) );
+    ApplyTuning( m_Autotuner->GetCurrentConfiguration() );
+
+    m_Logger->info( "Autotuning {} trials of {} frames", m_Autotuner->GetTrialCount(), m_AutotuneTrialFrames );
+}
+
+void TestApplication::UpdateAutotuning( double frameMilliseconds )
+{
+    //the first frames after a change still pay for the previous configuration
+    ++m_AutotuneFrame;
+    if ( m_AutotuneFrame <= m_AutotuneSettleFrames ) return;
+
+    m_AutotuneMilliseconds += frameMilliseconds;
+    if ( m_AutotuneFrame < m_AutotuneSettleFrames + m_AutotuneTrialFrames ) return;
+
+    m_Autotuner->AddTrial( m_AutotuneMilliseconds / m_AutotuneTrialFrames );
+    m_AutotuneFrame        = 0;
+    m_AutotuneMilliseconds = 0.0;
+    if ( !m_Autotuner->IsDone() )
+    {
+        ApplyTuning( m_Autotuner->GetCurrentConfiguration() );
+        return;
+    }
+
+    m_Autotuner->WriteReport( "logAutotune.txt", m_MachineName );
+    Autotuner::SaveConfiguration( m_TuningFile, m_MachineName, m_Autotuner->GetBestConfiguration() );
+    m_Autotuner.reset();
+    GameFramework::Get().Stop();
+}
+
+void TestApplication::EndCommandCapture()
+{
+    //the stream can be replayed anywhere, the report is the same replay done right away
+    m_CommandStream->Save( L"commands.dxcs" );
+
+    dx12lib::NullCommandBackend backend {};
+    dx12lib::Replay( *m_CommandStream, backend );
+    if ( std::ofstream logFile { "logCommands.txt", std::ios::trunc } )
+    {
+        logFile << m_CommandCaptureFrames << " frames, " << m_CommandStream->GetCommandCount() << " commands, "
+                << m_CommandStream->GetSizeInBytes() << " bytes\n";
+        backend.WriteReport( logFile );
+    }
+    m_Logger->info( "{} commands captured, {} redundant state changes", backend.GetCommandCount(), backend.GetRedundantCount() );
+
+    m_CommandStream.reset();
+}
+
+void TestApplication::ApplyTuning( const Autotuner::Configuration& configuration )
+{
+    //the parameters missing from the configuration keep their value
+    ParticleSystem::Tuning tuning { m_ParticleSystem.GetTuning() };
+    const auto             getValue { [&configuration]( const char* name, int currentValue ) {
+        const auto value { configuration.find( name ) };
+        return value != configuration.end() ? value->second : currentValue;
+    } };
+    tuning.UpdateChunkSize   = static_cast<size_t>( getValue( "UpdateChunkSize", static_cast<int>( tuning.UpdateChunkSize ) ) );
+    tuning.ParticlesPerGroup = static_cast<uint32_t>( getValue( "ParticlesPerGroup", static_cast<int>( tuning.ParticlesPerGroup ) ) );
+    tuning.InstancesPerDraw  = static_cast<size_t>( getValue( "InstancesPerDraw", static_cast<int>( tuning.InstancesPerDraw ) ) );
+
+    //the group size must match the bound mesh shader
+    if ( m_IsUsingMeshShaders )
+    {
+        const auto pipelineState { m_GroupSizePipelineStates.find( tuning.ParticlesPerGroup ) };
+        if ( pipelineState == m_GroupSizePipelineStates.end() )
+        {
+            tuning.ParticlesPerGroup = m_ParticleSystem.GetTuning().ParticlesPerGroup;
+        }
+        else
+        {
+            m_PipelineState = pipelineState->second;
+        }
+    }
+    m_ParticleSystem.SetTuning( tuning );
+}
+
+void TestApplication::ApplyGovernorKnobs()
+{
+    const QualityGovernor::Knobs& knobs { m_QualityGovernor.GetKnobs() };
+    m_ParticleBudget.MaxParticles    = static_cast<size_t>( static_cast<double>( m_ParticleBudgetLimit.MaxParticles ) * knobs.BudgetScale );
+    m_IsSimulationLODEnabled         = knobs.IsSimulationLODEnabled;
+    m_SimulationLODBias              = knobs.SimulationLODBias;
+    m_RenderLODSettings.IsEnabled    = knobs.IsRenderLODEnabled;
+    m_RenderLODSettings.MinPixelSize = knobs.RenderLODMinPixelSize;
+    m_DepthSortMode                  = knobs.SortMode;
 }
 
-void XM_CALLCONV Math::ComputeMatrices(const FXMMATRIX& model, CXMMATRIX view, CXMMATRIX viewProjection, Mat& mat )
+void TestApplication::ApplyQuality()
 {
-    mat.ModelMatrix                     = model;
-    mat.ModelViewMatrix                 = model * view;
-    mat.InverseTransposeModelViewMatrix = XMMatrixTranspose( XMMatrixInverse( nullptr, mat.ModelViewMatrix ) );
-    mat.ModelViewProjectionMatrix       = model * viewProjection;
+    m_BudgetManager.SetBudget( m_ParticleBudget );
+    m_SimulationScheduler.SetLevelBias( m_SimulationLODBias );
+    if ( m_IsSimulationLODEnabled && !m_SimulationScheduler.IsRegistered( m_ParticleSystem ) )
+    {
+        m_SimulationScheduler.Register( m_ParticleSystem );
+    }
+    else if ( !m_IsSimulationLODEnabled )
+    {
+        m_SimulationScheduler.Unregister( m_ParticleSystem );
+    }
+    m_ParticleSystem.SetRenderLOD( m_RenderLODSettings );
+    m_ParticleSystem.SetDepthSortMode( m_DepthSortMode );
 }
 
 void TestApplication::OnRender()
@@ -388,8 +622,13 @@ void TestApplication::OnRender()
     auto& commandQueue = m_Device->GetCommandQueue( D3D12_COMMAND_LIST_TYPE_DIRECT );
     auto  commandList  = commandQueue.GetCommandList();
 
-    // Create a scene visitor that is used to perform the actual rendering of the meshes in the scenes.
-    SceneVisitor visitor( *commandList );
+    //records the high level commands of the first frames
+    const bool isCapturing { m_CapturedFrames < m_CommandCaptureFrames };
+    if ( isCapturing )
+    {
+        if ( !m_CommandStream ) m_CommandStream = std::make_shared<dx12lib::CommandStream>();
+        commandList->SetCommandStream( m_CommandStream );
+    }
 
     // Clear the render targets.
     {
@@ -409,7 +648,7 @@ void TestApplication::OnRender()
 
     commandList->SetRenderTarget( m_RenderTarget );
 
-    m_ParticleSystem.Render(*m_Device, *commandList, visitor,m_Camera, m_IsUsingMeshShaders);
+    m_ParticleSystem.Render( *m_Device, *commandList, m_Camera, m_IsUsingMeshShaders, m_Profiler );
 
 
     // Resolve the MSAA render target to the swapchain's backbuffer.
@@ -419,8 +658,18 @@ void TestApplication::OnRender()
 
     commandList->ResolveSubresource( swapChainBackBuffer, msaaRenderTarget );
 
+    //state changes the command list dropped because the state was already bound
+    const dx12lib::StateFilter& stateFilter { commandList->GetStateFilter() };
+    m_Profiler.AddCount( "StateFilter/Calls", static_cast<double>( stateFilter.GetCallCount() ) );
+    m_Profiler.AddCount( "StateFilter/Filtered", static_cast<double>( stateFilter.GetFilteredCount() ) );
 
     commandQueue.ExecuteCommandList( commandList );
+    m_ParticleSystem.EndFrame();
+
+    if ( isCapturing && ++m_CapturedFrames == m_CommandCaptureFrames )
+    {
+        EndCommandCapture();
+    }
 
     m_SwapChain->Present();
 }
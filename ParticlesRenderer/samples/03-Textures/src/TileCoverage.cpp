@@ -0,0 +1,90 @@
+#include <TileCoverage.h>
+
+#include <cmath>
+
+void TileCoverage::SetViewportSize( float width, float height )
+{
+    m_Width      = std::max( width, 1.0f );
+    m_Height     = std::max( height, 1.0f );
+    m_TileCountX = static_cast<uint32_t>( std::ceil( m_Width / TileSize ) );
+    m_TileCountY = static_cast<uint32_t>( std::ceil( m_Height / TileSize ) );
+    Clear();
+}
+
+void TileCoverage::Clear()
+{
+    m_TileOverdraw.assign( static_cast<size_t>( m_TileCountX ) * m_TileCountY, 0.0f );
+    m_CoveredPixels   = 0.0;
+    m_AverageOverdraw = 0.0;
+    m_MaxTileOverdraw = 0.0f;
+}
+
+void TileCoverage::SumChunks( size_t chunkCount )
+{
+    // Tiles are summed in parallel over the chunk histograms
+    const size_t        tileCount { m_TileOverdraw.size() };
+    const size_t        tileChunkSize { 256 };
+    std::vector<double> chunkCovered( Parallel::GetChunkCount( tileCount, tileChunkSize ) );
+    std::vector<float>  chunkMax( chunkCovered.size() );
+    Parallel::ForEachChunk( tileCount, tileChunkSize, [&]( size_t tileChunk, size_t begin, size_t end ) {
+        double covered { 0.0 };
+        float  maxOverdraw { 0.0f };
+        for ( size_t tile { begin }; tile < end; ++tile )
+        {
+            float area { 0.0f };
+            for ( size_t chunk { 0 }; chunk < chunkCount; ++chunk )
+            {
+                area += m_ChunkTiles[chunk][tile];
+            }
+
+            // Tiles on the right and bottom edges can be cut by the screen
+            const float tileX { static_cast<float>( tile % m_TileCountX ) * TileSize };
+            const float tileY { static_cast<float>( tile / m_TileCountX ) * TileSize };
+            const float tileArea { ( std::min( tileX + TileSize, m_Width ) - tileX ) * ( std::min( tileY + TileSize, m_Height ) - tileY ) };
+
+            m_TileOverdraw[tile] = area / tileArea;
+            covered += area;
+            maxOverdraw = std::max( maxOverdraw, m_TileOverdraw[tile] );
+        }
+        chunkCovered[tileChunk] = covered;
+        chunkMax[tileChunk]     = maxOverdraw;
+    } );
+
+    for ( size_t tileChunk { 0 }; tileChunk < chunkCovered.size(); ++tileChunk )
+    {
+        m_CoveredPixels += chunkCovered[tileChunk];
+        m_MaxTileOverdraw = std::max( m_MaxTileOverdraw, chunkMax[tileChunk] );
+    }
+    m_AverageOverdraw = m_CoveredPixels / ( static_cast<double>( m_Width ) * m_Height );
+}
+
+void TileCoverage::AddQuad( std::vector<float>& tiles, const Quad& quad ) const
+{
+    const float minX { std::max( quad.MinX, 0.0f ) };
+    const float minY { std::max( quad.MinY, 0.0f ) };
+    const float maxX { std::min( quad.MaxX, m_Width ) };
+    const float maxY { std::min( quad.MaxY, m_Height ) };
+    if ( minX >= maxX || minY >= maxY ) return;
+
+    const uint32_t firstTileX { static_cast<uint32_t>( minX ) / TileSize };
+    const uint32_t firstTileY { static_cast<uint32_t>( minY ) / TileSize };
+    const uint32_t lastTileX { std::min( static_cast<uint32_t>( std::ceil( maxX ) ) / TileSize, m_TileCountX - 1 ) };
+    const uint32_t lastTileY { std::min( static_cast<uint32_t>( std::ceil( maxY ) ) / TileSize, m_TileCountY - 1 ) };
+
+    for ( uint32_t tileY { firstTileY }; tileY <= lastTileY; ++tileY )
+    {
+        const float tileMinY { static_cast<float>( tileY * TileSize ) };
+        const float overlapY { std::min( maxY, tileMinY + TileSize ) - std::max( minY, tileMinY ) };
+        if ( overlapY <= 0.0f ) continue;
+
+        for ( uint32_t tileX { firstTileX }; tileX <= lastTileX; ++tileX )
+        {
+            const float tileMinX { static_cast<float>( tileX * TileSize ) };
+            const float overlapX { std::min( maxX, tileMinX + TileSize ) - std::max( minX, tileMinX ) };
+            if ( overlapX > 0.0f )
+            {
+                tiles[static_cast<size_t>( tileY ) * m_TileCountX + tileX] += overlapX * overlapY;
+            }
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#include <TimingWheel.h>
+
+#include <algorithm>
+
+void TimingWheel::Schedule( uint32_t id, uint64_t tick )
+{
+    Insert( Entry { id, std::max( tick, m_CurrentTick + 1 ) } );
+    ++m_ScheduledCount;
+}
+
+void TimingWheel::Advance( std::vector<uint32_t>& expired )
+{
+    ++m_CurrentTick;
+
+    // Cascade from the highest level that wrapped around, entries moved down can be cascaded again right after
+    uint32_t wrappedLevels { 0 };
+    while ( wrappedLevels + 1 < m_LevelCount &&
+            ( m_CurrentTick & ( ( uint64_t { 1 } << ( ( wrappedLevels + 1 ) * m_SlotBits ) ) - 1 ) ) == 0 )
+    {
+        ++wrappedLevels;
+    }
+    for ( uint32_t level { wrappedLevels }; level > 0; --level )
+    {
+        std::vector<Entry>& bucket { m_Levels[level][( m_CurrentTick >> ( level * m_SlotBits ) ) & ( m_SlotCount - 1 )] };
+        m_Cascade.swap( bucket );
+        for ( const Entry& entry: m_Cascade )
+        {
+            Insert( entry );
+        }
+        m_Cascade.clear();
+    }
+
+    std::vector<Entry>& bucket { m_Levels[0][m_CurrentTick & ( m_SlotCount - 1 )] };
+    for ( const Entry& entry: bucket )
+    {
+        expired.push_back( entry.Id );
+    }
+    m_ScheduledCount -= bucket.size();
+    bucket.clear();
+}
+
+void TimingWheel::Clear()
+{
+    for ( auto& level: m_Levels )
+    {
+        for ( std::vector<Entry>& bucket: level )
+        {
+            bucket.clear();
+        }
+    }
+    m_ScheduledCount = 0;
+}
+
+void TimingWheel::Insert( const Entry& entry )
+{
+    // The level is given by the highest group of slot bits where the tick differs from the current tick
+    const uint64_t difference { entry.Tick ^ m_CurrentTick };
+    uint32_t       level { 0 };
+    while ( level + 1 < m_LevelCount && ( difference >> ( ( level + 1 ) * m_SlotBits ) ) != 0 )
+    {
+        ++level;
+    }
+
+    m_Levels[level][( entry.Tick >> ( level * m_SlotBits ) ) & ( m_SlotCount - 1 )].push_back( entry );
+}
@@ -0,0 +1,319 @@
+#include <VectorFieldVolume.h>
+
+#include <windows.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+using namespace DirectX;
+
+namespace
+{
+    // Spreads the 2 bits of a coordinate inside a brick so 3 of them can be interleaved.
+    constexpr uint32_t g_BrickMorton[VectorFieldVolume::BrickSize] { 0, 1, 8, 9 };
+
+    uint32_t GetBrickCount( uint32_t size )
+    {
+        return ( size + VectorFieldVolume::BrickSize - 1 ) / VectorFieldVolume::BrickSize;
+    }
+
+    size_t GetBrickedIndex( uint32_t x, uint32_t y, uint32_t z, uint32_t bricksX, uint32_t bricksY )
+    {
+        const size_t brick { ( static_cast<size_t>( z >> 2 ) * bricksY + ( y >> 2 ) ) * bricksX + ( x >> 2 ) };
+        const uint32_t voxel { g_BrickMorton[x & 3] | ( g_BrickMorton[y & 3] << 1 ) | ( g_BrickMorton[z & 3] << 2 ) };
+        return brick * VectorFieldVolume::VoxelsPerBrick + voxel;
+    }
+
+    std::mutex                                                 g_VolumesMutex;
+    std::map<std::wstring, std::weak_ptr<VectorFieldVolume>> g_Volumes;
+}
+
+std::shared_ptr<VectorFieldVolume> VectorFieldVolume::Load( const std::wstring& fileName )
+{
+    std::filesystem::path path { fileName };
+    if ( path.extension() == L".fga" || path.extension() == L".FGA" )
+    {
+        const std::filesystem::path fgaPath { path };
+        path.replace_extension( L".vfb" );
+
+        if ( !std::filesystem::exists( path ) ||
+             std::filesystem::last_write_time( fgaPath ) > std::filesystem::last_write_time( path ) )
+        {
+            if ( !ImportFGA( fgaPath.wstring(), path.wstring() ) ) return nullptr;
+        }
+    }
+
+    std::error_code      error {};
+    const std::wstring   key { std::filesystem::absolute( path, error ).wstring() };
+    std::lock_guard      lock { g_VolumesMutex };
+
+    if ( std::shared_ptr<VectorFieldVolume> volume { g_Volumes[key].lock() } )
+    {
+        return volume;
+    }
+
+    std::shared_ptr<VectorFieldVolume> volume { new VectorFieldVolume() };
+    if ( !volume->Map( key ) ) return nullptr;
+
+    g_Volumes[key] = volume;
+    return volume;
+}
+
+bool VectorFieldVolume::Save( const std::wstring& fileName, uint32_t sizeX, uint32_t sizeY, uint32_t sizeZ,
+                              const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, const std::vector<XMFLOAT3>& voxels )
+{
+    if ( sizeX == 0 || sizeY == 0 || sizeZ == 0 ) return false;
+    if ( voxels.size() < static_cast<size_t>( sizeX ) * sizeY * sizeZ ) return false;
+
+    Header header {};
+    std::copy( std::begin( m_Magic ), std::end( m_Magic ), header.Magic );
+    header.Version      = m_Version;
+    header.SizeX        = sizeX;
+    header.SizeY        = sizeY;
+    header.SizeZ        = sizeZ;
+    header.BricksX      = GetBrickCount( sizeX );
+    header.BricksY      = GetBrickCount( sizeY );
+    header.BricksZ      = GetBrickCount( sizeZ );
+    header.BoundsMin[0] = boundsMin.x;
+    header.BoundsMin[1] = boundsMin.y;
+    header.BoundsMin[2] = boundsMin.z;
+    header.BoundsMax[0] = boundsMax.x;
+    header.BoundsMax[1] = boundsMax.y;
+    header.BoundsMax[2] = boundsMax.z;
+
+    std::vector<XMFLOAT3> bricked( static_cast<size_t>( header.BricksX ) * header.BricksY * header.BricksZ * VoxelsPerBrick,
+                                   XMFLOAT3 { 0.0f, 0.0f, 0.0f } );
+    for ( uint32_t z { 0 }; z < sizeZ; ++z )
+    {
+        for ( uint32_t y { 0 }; y < sizeY; ++y )
+        {
+            for ( uint32_t x { 0 }; x < sizeX; ++x )
+            {
+                bricked[GetBrickedIndex( x, y, z, header.BricksX, header.BricksY )] =
+                    voxels[( static_cast<size_t>( z ) * sizeY + y ) * sizeX + x];
+            }
+        }
+    }
+
+    std::ofstream file { std::filesystem::path { fileName }, std::ios::binary | std::ios::trunc };
+    if ( !file ) return false;
+
+    file.write( reinterpret_cast<const char*>( &header ), sizeof( Header ) );
+    file.write( reinterpret_cast<const char*>( bricked.data() ), bricked.size() * sizeof( XMFLOAT3 ) );
+    return static_cast<bool>( file );
+}
+
+// FGA is a comma separated text format: size, bounds min, bounds max, then the vectors, x first.
+bool VectorFieldVolume::ImportFGA( const std::wstring& fgaFileName, const std::wstring& fileName )
+{
+    std::ifstream fgaFile { std::filesystem::path { fgaFileName } };
+    if ( !fgaFile ) return false;
+
+    std::string content { std::istreambuf_iterator<char> { fgaFile }, std::istreambuf_iterator<char> {} };
+    std::replace( content.begin(), content.end(), ',', ' ' );
+    std::istringstream stream { content };
+
+    float    size[3] {};
+    XMFLOAT3 boundsMin {};
+    XMFLOAT3 boundsMax {};
+    stream >> size[0] >> size[1] >> size[2];
+    stream >> boundsMin.x >> boundsMin.y >> boundsMin.z;
+    stream >> boundsMax.x >> boundsMax.y >> boundsMax.z;
+    if ( !stream || size[0] < 1.0f || size[1] < 1.0f || size[2] < 1.0f ) return false;
+
+    const uint32_t sizeX { static_cast<uint32_t>( size[0] ) };
+    const uint32_t sizeY { static_cast<uint32_t>( size[1] ) };
+    const uint32_t sizeZ { static_cast<uint32_t>( size[2] ) };
+
+    std::vector<XMFLOAT3> voxels( static_cast<size_t>( sizeX ) * sizeY * sizeZ );
+    for ( XMFLOAT3& voxel: voxels )
+    {
+        stream >> voxel.x >> voxel.y >> voxel.z;
+    }
+    if ( !stream ) return false;
+
+    return Save( fileName, sizeX, sizeY, sizeZ, boundsMin, boundsMax, voxels );
+}
+
+VectorFieldVolume::~VectorFieldVolume()
+{
+    if ( m_View ) UnmapViewOfFile( m_View );
+    if ( m_Mapping ) CloseHandle( m_Mapping );
+    if ( m_File ) CloseHandle( m_File );
+}
+
+bool VectorFieldVolume::Map( const std::wstring& fileName )
+{
+    const HANDLE file { CreateFileW( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                     FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr ) };
+    if ( file == INVALID_HANDLE_VALUE ) return false;
+    m_File = file;
+
+    LARGE_INTEGER fileSize {};
+    if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart < static_cast<LONGLONG>( sizeof( Header ) ) ) return false;
+
+    m_Mapping = CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if ( !m_Mapping ) return false;
+
+    m_View = MapViewOfFile( m_Mapping, FILE_MAP_READ, 0, 0, 0 );
+    if ( !m_View ) return false;
+
+    const Header& header { *static_cast<const Header*>( m_View ) };
+    if ( !std::equal( std::begin( m_Magic ), std::end( m_Magic ), header.Magic ) || header.Version != m_Version ) return false;
+    if ( header.SizeX == 0 || header.SizeY == 0 || header.SizeZ == 0 ) return false;
+    if ( header.BricksX != GetBrickCount( header.SizeX ) || header.BricksY != GetBrickCount( header.SizeY ) ||
+         header.BricksZ != GetBrickCount( header.SizeZ ) )
+        return false;
+
+    const size_t voxelCount { static_cast<size_t>( header.BricksX ) * header.BricksY * header.BricksZ * VoxelsPerBrick };
+    if ( static_cast<size_t>( fileSize.QuadPart ) < sizeof( Header ) + voxelCount * sizeof( XMFLOAT3 ) ) return false;
+
+    m_Voxels    = reinterpret_cast<const XMFLOAT3*>( static_cast<const char*>( m_View ) + sizeof( Header ) );
+    m_Size[0]   = header.SizeX;
+    m_Size[1]   = header.SizeY;
+    m_Size[2]   = header.SizeZ;
+    m_BricksX   = header.BricksX;
+    m_BricksY   = header.BricksY;
+    m_BoundsMin = XMFLOAT3 { header.BoundsMin[0], header.BoundsMin[1], header.BoundsMin[2] };
+    m_BoundsMax = XMFLOAT3 { header.BoundsMax[0], header.BoundsMax[1], header.BoundsMax[2] };
+    return true;
+}
+
+size_t VectorFieldVolume::GetVoxelIndex( uint32_t x, uint32_t y, uint32_t z ) const
+{
+    return GetBrickedIndex( x, y, z, m_BricksX, m_BricksY );
+}
+
+XMFLOAT3 VectorFieldVolume::Sample( const XMFLOAT3& position, const XMFLOAT3& origin, float scale ) const
+{
+    const float worldPosition[3] { position.x, position.y, position.z };
+    const float worldOrigin[3] { origin.x, origin.y, origin.z };
+    const float boundsMin[3] { m_BoundsMin.x, m_BoundsMin.y, m_BoundsMin.z };
+    const float boundsMax[3] { m_BoundsMax.x, m_BoundsMax.y, m_BoundsMax.z };
+
+    uint32_t base[3] {};
+    uint32_t next[3] {};
+    float    weight[3] {};
+    for ( int axis { 0 }; axis < 3; ++axis )
+    {
+        const float extent { ( boundsMax[axis] - boundsMin[axis] ) * scale };
+        const float maxCoord { static_cast<float>( m_Size[axis] - 1 ) };
+        const float start { worldOrigin[axis] + boundsMin[axis] * scale };
+
+        float coord { extent > 0.0f ? ( worldPosition[axis] - start ) / extent * maxCoord : 0.0f };
+        coord = std::clamp( coord, 0.0f, maxCoord );
+
+        base[axis]   = static_cast<uint32_t>( std::min( std::floor( coord ), std::max( maxCoord - 1.0f, 0.0f ) ) );
+        next[axis]   = std::min( base[axis] + 1, m_Size[axis] - 1 );
+        weight[axis] = coord - static_cast<float>( base[axis] );
+    }
+
+    XMVECTOR corners[8];
+    for ( uint32_t corner { 0 }; corner < 8; ++corner )
+    {
+        corners[corner] = XMLoadFloat3( &m_Voxels[GetVoxelIndex( corner & 1 ? next[0] : base[0],
+                                                                 corner & 2 ? next[1] : base[1],
+                                                                 corner & 4 ? next[2] : base[2] )] );
+    }
+
+    const XMVECTOR x00 { XMVectorLerp( corners[0], corners[1], weight[0] ) };
+    const XMVECTOR x10 { XMVectorLerp( corners[2], corners[3], weight[0] ) };
+    const XMVECTOR x01 { XMVectorLerp( corners[4], corners[5], weight[0] ) };
+    const XMVECTOR x11 { XMVectorLerp( corners[6], corners[7], weight[0] ) };
+    const XMVECTOR y0 { XMVectorLerp( x00, x10, weight[1] ) };
+    const XMVECTOR y1 { XMVectorLerp( x01, x11, weight[1] ) };
+
+    XMFLOAT3 result {};
+    XMStoreFloat3( &result, XMVectorLerp( y0, y1, weight[2] ) );
+    return result;
+}
+
+void VectorFieldVolume::SampleBatch( const float* x, const float* y, const float* z, float* outX, float* outY,
+                                     float* outZ, size_t count, const XMFLOAT3& origin, float scale ) const
+{
+    const auto load4 = []( const float* source ) { return XMLoadFloat4A( reinterpret_cast<const XMFLOAT4A*>( source ) ); };
+    const auto store4 = []( float* destination, const XMVECTOR& value ) {
+        XMStoreFloat4A( reinterpret_cast<XMFLOAT4A*>( destination ), value );
+    };
+
+    // World position -> grid coordinate: ( position - start ) * toGrid
+    const XMVECTOR startVector { XMLoadFloat3( &origin ) + XMLoadFloat3( &m_BoundsMin ) * scale };
+    const XMVECTOR extent { ( XMLoadFloat3( &m_BoundsMax ) - XMLoadFloat3( &m_BoundsMin ) ) * scale };
+    const XMVECTOR maxCoord { XMVectorSet( static_cast<float>( m_Size[0] - 1 ), static_cast<float>( m_Size[1] - 1 ),
+                                           static_cast<float>( m_Size[2] - 1 ), 0.0f ) };
+    const XMVECTOR maxBase { XMVectorMax( maxCoord - XMVectorSplatOne(), XMVectorZero() ) };
+    const XMVECTOR toGridVector { XMVectorSelect( XMVectorZero(), maxCoord / extent,
+                                                  XMVectorGreater( extent, XMVectorZero() ) ) };
+
+    const XMVECTOR startX { XMVectorSplatX( startVector ) };
+    const XMVECTOR startY { XMVectorSplatY( startVector ) };
+    const XMVECTOR startZ { XMVectorSplatZ( startVector ) };
+    const XMVECTOR toGridX { XMVectorSplatX( toGridVector ) };
+    const XMVECTOR toGridY { XMVectorSplatY( toGridVector ) };
+    const XMVECTOR toGridZ { XMVectorSplatZ( toGridVector ) };
+
+    struct Axis
+    {
+        XMVECTOR Weight;
+        alignas( 16 ) float Base[4];
+    };
+
+    const auto toGrid = []( const XMVECTOR& position, const XMVECTOR& start, const XMVECTOR& factor,
+                            const XMVECTOR& axisMax, const XMVECTOR& axisMaxBase, Axis& axis ) {
+        const XMVECTOR coord { XMVectorClamp( ( position - start ) * factor, XMVectorZero(), axisMax ) };
+        const XMVECTOR base { XMVectorMin( XMVectorFloor( coord ), axisMaxBase ) };
+        axis.Weight = coord - base;
+        XMStoreFloat4A( reinterpret_cast<XMFLOAT4A*>( axis.Base ), base );
+    };
+
+    alignas( 16 ) float cornersX[8][4];
+    alignas( 16 ) float cornersY[8][4];
+    alignas( 16 ) float cornersZ[8][4];
+
+    const auto trilinear = []( const float ( &corners )[8][4], const XMVECTOR& wx, const XMVECTOR& wy,
+                               const XMVECTOR& wz ) {
+        const auto load = []( const float* source ) { return XMLoadFloat4A( reinterpret_cast<const XMFLOAT4A*>( source ) ); };
+        const XMVECTOR x00 { XMVectorLerpV( load( corners[0] ), load( corners[1] ), wx ) };
+        const XMVECTOR x10 { XMVectorLerpV( load( corners[2] ), load( corners[3] ), wx ) };
+        const XMVECTOR x01 { XMVectorLerpV( load( corners[4] ), load( corners[5] ), wx ) };
+        const XMVECTOR x11 { XMVectorLerpV( load( corners[6] ), load( corners[7] ), wx ) };
+        return XMVectorLerpV( XMVectorLerpV( x00, x10, wy ), XMVectorLerpV( x01, x11, wy ), wz );
+    };
+
+    for ( size_t i { 0 }; i < count; i += 4 )
+    {
+        Axis axisX, axisY, axisZ;
+        toGrid( load4( x + i ), startX, toGridX, XMVectorSplatX( maxCoord ), XMVectorSplatX( maxBase ), axisX );
+        toGrid( load4( y + i ), startY, toGridY, XMVectorSplatY( maxCoord ), XMVectorSplatY( maxBase ), axisY );
+        toGrid( load4( z + i ), startZ, toGridZ, XMVectorSplatZ( maxCoord ), XMVectorSplatZ( maxBase ), axisZ );
+
+        // Gather the 8 corners of every lane, the interpolation is done 4 lanes at a time.
+        for ( int lane { 0 }; lane < 4; ++lane )
+        {
+            const uint32_t x0 { static_cast<uint32_t>( axisX.Base[lane] ) };
+            const uint32_t y0 { static_cast<uint32_t>( axisY.Base[lane] ) };
+            const uint32_t z0 { static_cast<uint32_t>( axisZ.Base[lane] ) };
+            const uint32_t x1 { std::min( x0 + 1, m_Size[0] - 1 ) };
+            const uint32_t y1 { std::min( y0 + 1, m_Size[1] - 1 ) };
+            const uint32_t z1 { std::min( z0 + 1, m_Size[2] - 1 ) };
+
+            for ( uint32_t corner { 0 }; corner < 8; ++corner )
+            {
+                const XMFLOAT3& voxel { m_Voxels[GetVoxelIndex( corner & 1 ? x1 : x0, corner & 2 ? y1 : y0,
+                                                                corner & 4 ? z1 : z0 )] };
+                cornersX[corner][lane] = voxel.x;
+                cornersY[corner][lane] = voxel.y;
+                cornersZ[corner][lane] = voxel.z;
+            }
+        }
+
+        store4( outX + i, trilinear( cornersX, axisX.Weight, axisY.Weight, axisZ.Weight ) );
+        store4( outY + i, trilinear( cornersY, axisX.Weight, axisY.Weight, axisZ.Weight ) );
+        store4( outZ + i, trilinear( cornersZ, axisX.Weight, axisY.Weight, axisZ.Weight ) );
+    }
+}
@@ -0,0 +1,206 @@
+#include <FusedParticleKernel.h>
+
+#include <FrustumCulling.h>
+#include <ParallelFor.h>
+#include <Particle.h>
+#include <ParticlePacker.h>
+#include <Profiler.h>
+#include <TestCheck.h>
+
+#include <DirectXCollision.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    constexpr float Radius { 0.5f };
+    constexpr float MaxScale { 0.5f };
+
+    // Deterministic particles in a cube around the camera, about half of them out of the frustum, with sizes up to
+    // MaxScale.
+    std::vector<Particle> MakeParticles( size_t count )
+    {
+        std::vector<Particle> particles {};
+        particles.reserve( count );
+
+        uint32_t   seed { 12345 };
+        const auto random = [&seed]( float min, float max ) {
+            seed = seed * 1664525u + 1013904223u;
+            return min + ( max - min ) * static_cast<float>( seed >> 8 ) / static_cast<float>( 1u << 24 );
+        };
+        for ( size_t i { 0 }; i < count; ++i )
+        {
+            const Vec3 position { random( -20.0f, 20.0f ), random( -20.0f, 20.0f ), random( -20.0f, 20.0f ) };
+            particles.emplace_back( position, random( 0.05f, MaxScale ) );
+        }
+        return particles;
+    }
+
+    BoundingBox GetBounds( const std::vector<Particle>& particles )
+    {
+        std::vector<XMFLOAT3> positions {};
+        for ( const Particle& particle: particles )
+        {
+            positions.push_back( particle.GetPosition() );
+        }
+
+        BoundingBox bounds {};
+        BoundingBox::CreateFromPoints( bounds, positions.size(), positions.data(), sizeof( XMFLOAT3 ) );
+        return bounds;
+    }
+
+    XMMATRIX GetViewProjection()
+    {
+        const XMMATRIX view { XMMatrixLookAtLH( XMVectorSet( 0.0f, 0.0f, -10.0f, 1.0f ), XMVectorZero(), XMVectorSet( 0.0f, 1.0f, 0.0f, 0.0f ) ) };
+        return view * XMMatrixPerspectiveFovLH( XM_PIDIV4, 16.0f / 9.0f, 0.1f, 25.0f );
+    }
+
+    // Scalar reference of the kernel cull, one plane at a time.
+    bool IsVisible( const FrustumPlanes& frustum, const XMFLOAT3& position )
+    {
+        for ( const XMFLOAT4& plane: frustum.Planes )
+        {
+            if ( plane.x * position.x + plane.y * position.y + plane.z * position.z + plane.w <= -Radius ) return false;
+        }
+        return true;
+    }
+
+    using RecordKey = std::tuple<uint16_t, uint16_t, uint16_t, uint8_t, uint8_t>;
+
+    RecordKey GetKey( const PackedParticle& record )
+    {
+        return RecordKey { record.X, record.Y, record.Z, record.Size, record.Life };
+    }
+
+    // Runs the kernel on the chunks in parallel like the update does, returns the record count.
+    size_t RunKernel( FusedParticleKernel& kernel, HostPackedParticleTarget& target, const std::vector<Particle>& particles,
+                      size_t chunkSize, const FrustumPlanes* frustum, const PackedParticleEncoder& encoder )
+    {
+        Profiler profiler {};
+        kernel.Begin( target, particles.size(), chunkSize, frustum, Radius, encoder );
+        Parallel::ForEachChunk( particles.size(), chunkSize, [&]( size_t, size_t begin, size_t end ) {
+            kernel.WriteChunk( particles.data(), begin, end, 1.0f );
+        } );
+        return kernel.End( profiler );
+    }
+
+    // The records are the visible particles encoded in any order plus empty padding records, and they decode
+    // within half a step of the particles.
+    void CheckRecords( const HostPackedParticleTarget& target, const FusedParticleKernel& kernel, const std::vector<Particle>& particles,
+                       const FrustumPlanes* frustum, const PackedParticleEncoder& encoder )
+    {
+        CHECK_EQUAL( target.GetCount(), kernel.GetRecordCount() );
+        CHECK_EQUAL( kernel.GetRecordCount() % FusedParticleKernel::BlockSize, size_t { 0 } );
+
+        //scalar reference, the encoded visible particles sorted by record
+        std::vector<std::pair<RecordKey, XMFLOAT3>> expected {};
+        for ( const Particle& particle: particles )
+        {
+            const XMFLOAT3 position { particle.GetPosition() };
+            if ( frustum && !IsVisible( *frustum, position ) ) continue;
+
+            const PackedParticle record { encoder.Encode( XMLoadFloat3( &position ), particle.GetSize(), particle.GetDeathTick() ) };
+            expected.emplace_back( GetKey( record ), position );
+        }
+        std::sort( expected.begin(), expected.end(), []( const auto& a, const auto& b ) { return a.first < b.first; } );
+
+        std::vector<PackedParticle> records {};
+        size_t                      paddingCount { 0 };
+        for ( size_t i { 0 }; i < target.GetCount(); ++i )
+        {
+            const PackedParticle& record { target.GetData()[i] };
+            if ( record.Size == 0 )
+            {
+                CHECK( ( GetKey( record ) == RecordKey { 0, 0, 0, 0, 0 } ) );
+                ++paddingCount;
+                continue;
+            }
+            records.push_back( record );
+        }
+        std::sort( records.begin(), records.end(), []( const PackedParticle& a, const PackedParticle& b ) { return GetKey( a ) < GetKey( b ); } );
+
+        CHECK_EQUAL( records.size(), expected.size() );
+        CHECK_EQUAL( paddingCount, target.GetCount() - expected.size() );
+        if ( records.size() != expected.size() ) return;
+
+        const PackedParticleHeader& header { kernel.GetHeader() };
+        const XMVECTOR              halfStep { XMLoadFloat3( &header.BoundsStep ) * 0.5f + XMVectorReplicate( 1e-4f ) };
+        for ( size_t i { 0 }; i < records.size(); ++i )
+        {
+            CHECK( GetKey( records[i] ) == expected[i].first );
+
+            float          scale { 0.0f };
+            const XMVECTOR position { ParticlePacker::Decode( records[i], header, scale ) };
+            const XMVECTOR error { XMVectorAbs( position - XMLoadFloat3( &expected[i].second ) ) };
+            CHECK( XMVector3LessOrEqual( error, halfStep ) );
+        }
+    }
+
+    void TestCulled()
+    {
+        const std::vector<Particle>  particles { MakeParticles( 10000 ) };
+        const XMMATRIX               viewProjection { GetViewProjection() };
+        const FrustumPlanes          frustum { FrustumPlanes::FromViewProjection( viewProjection ) };
+        const PackedParticleEncoder  encoder { MaxScale, GetBounds( particles ), viewProjection, 0, 0 };
+        FusedParticleKernel          kernel {};
+        HostPackedParticleTarget     target {};
+
+        //chunks which are not a multiple of the block size, every chunk pads its last block
+        for ( const size_t chunkSize: { size_t { 1000 }, size_t { 64 }, size_t { 37 } } )
+        {
+            RunKernel( kernel, target, particles, chunkSize, &frustum, encoder );
+            CheckRecords( target, kernel, particles, &frustum, encoder );
+        }
+
+        //the frame really culls, neither nothing nor everything is visible
+        size_t visibleCount { 0 };
+        for ( const Particle& particle: particles )
+        {
+            visibleCount += IsVisible( frustum, particle.GetPosition() ) ? 1 : 0;
+        }
+        CHECK( visibleCount > 0 && visibleCount < particles.size() );
+    }
+
+    void TestNotCulled()
+    {
+        const std::vector<Particle> particles { MakeParticles( 1000 ) };
+        const PackedParticleEncoder encoder { MaxScale, GetBounds( particles ), GetViewProjection(), 0, 0 };
+        FusedParticleKernel         kernel {};
+        HostPackedParticleTarget    target {};
+
+        //one chunk of a multiple of the block size has no padding
+        CHECK_EQUAL( RunKernel( kernel, target, particles, 1000, nullptr, encoder ), size_t { 1024 } );
+        CheckRecords( target, kernel, particles, nullptr, encoder );
+
+        CHECK_EQUAL( RunKernel( kernel, target, particles, 640, nullptr, encoder ), size_t { 1024 } );
+        CheckRecords( target, kernel, particles, nullptr, encoder );
+
+        CHECK_EQUAL( RunKernel( kernel, target, particles, 100, nullptr, encoder ), size_t { 10 * 128 } );
+        CheckRecords( target, kernel, particles, nullptr, encoder );
+    }
+
+    void TestNoParticles()
+    {
+        const std::vector<Particle> particles {};
+        const PackedParticleEncoder encoder { MaxScale, BoundingBox {}, GetViewProjection(), 0, 0 };
+        FusedParticleKernel         kernel {};
+        HostPackedParticleTarget    target {};
+
+        CHECK_EQUAL( RunKernel( kernel, target, particles, 1000, nullptr, encoder ), size_t { 0 } );
+        CHECK_EQUAL( target.GetCount(), size_t { 0 } );
+    }
+}
+
+int main()
+{
+    TestCulled();
+    TestNotCulled();
+    TestNoParticles();
+    return GetFailedCheckCount();
+}
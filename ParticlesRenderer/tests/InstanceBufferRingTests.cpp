@@ -0,0 +1,228 @@
+#include <InstanceBufferRing.h>
+
+#include <TestCheck.h>
+
+#include <memory>
+#include <vector>
+
+namespace
+{
+    enum class EventType
+    {
+        Create,
+        Destroy,
+        Wait
+    };
+
+    struct Event
+    {
+        EventType Type;
+        uint64_t  Value;  // size of a created buffer, id of a destroyed buffer or waited fence
+
+        bool operator==( const Event& other ) const
+        {
+            return Type == other.Type && Value == other.Value;
+        }
+    };
+
+    // Host backend completed by hand which logs the calls of the ring. The log outlives the backend, the ring
+    // destroys it when it is released.
+    class LoggingBackend : public HostInstanceBufferBackend
+    {
+    public:
+        explicit LoggingBackend( std::vector<Event>& events )
+        : HostInstanceBufferBackend { false }
+        , m_Events { events }
+        {}
+
+        Buffer Create( size_t size ) override
+        {
+            m_Events.push_back( Event { EventType::Create, size } );
+            return HostInstanceBufferBackend::Create( size );
+        }
+        void Destroy( const Buffer& buffer ) override
+        {
+            m_Events.push_back( Event { EventType::Destroy, buffer.Id } );
+            HostInstanceBufferBackend::Destroy( buffer );
+        }
+        void Wait( uint64_t fenceValue ) override
+        {
+            m_Events.push_back( Event { EventType::Wait, fenceValue } );
+            HostInstanceBufferBackend::Wait( fenceValue );
+        }
+
+    private:
+        std::vector<Event>& m_Events;
+    };
+
+    size_t CountEvents( const std::vector<Event>& events, EventType type )
+    {
+        size_t count { 0 };
+        for ( const Event& event: events )
+        {
+            count += event.Type == type ? 1 : 0;
+        }
+        return count;
+    }
+
+    constexpr size_t MinSize { InstanceBufferRing::MinSize };
+
+    void TestFenceWaits()
+    {
+        std::vector<Event> events {};
+        InstanceBufferRing ring {};
+        auto               backend { std::make_unique<LoggingBackend>( events ) };
+        LoggingBackend&    host { *backend };
+        ring.SetBackend( std::move( backend ) );
+
+        //one buffer per frame in flight, the first use of a slot never waits
+        std::vector<void*> data {};
+        for ( uint32_t frame { 0 }; frame < InstanceBufferRing::FramesInFlight; ++frame )
+        {
+            data.push_back( ring.Allocate( 100 ) );
+            ring.EndFrame();
+        }
+        CHECK_EQUAL( CountEvents( events, EventType::Create ), size_t { InstanceBufferRing::FramesInFlight } );
+        CHECK_EQUAL( CountEvents( events, EventType::Wait ), size_t { 0 } );
+        CHECK_EQUAL( host.GetLiveBufferCount(), size_t { InstanceBufferRing::FramesInFlight } );
+        CHECK( data[0] != data[1] && data[1] != data[2] && data[0] != data[2] );
+
+        //the GPU is still on the first frame, its slot waits for its fence
+        events.clear();
+        CHECK( ring.Allocate( 100 ) == data[0] );
+        CHECK( ( events == std::vector<Event> { Event { EventType::Wait, 1 } } ) );
+        ring.EndFrame();
+
+        //the GPU finished the second frame, its slot is reused without waiting and keeps its buffer
+        events.clear();
+        host.Complete( 2 );
+        CHECK( ring.Allocate( 100 ) == data[1] );
+        CHECK( events.empty() );
+        ring.EndFrame();
+    }
+
+    void TestGrowth()
+    {
+        std::vector<Event> events {};
+        InstanceBufferRing ring {};
+        auto               backend { std::make_unique<LoggingBackend>( events ) };
+        LoggingBackend&    host { *backend };
+        ring.SetBackend( std::move( backend ) );
+
+        //the first buffer is at least MinSize
+        ring.Allocate( 10 );
+        CHECK( ( events == std::vector<Event> { Event { EventType::Create, MinSize } } ) );
+
+        //a slightly larger use doubles the buffer, the old one is destroyed
+        events.clear();
+        ring.Allocate( MinSize + 1 );
+        CHECK( ( events == std::vector<Event> { Event { EventType::Destroy, 1 }, Event { EventType::Create, 2 * MinSize } } ) );
+
+        //a much larger use takes the size it needs
+        events.clear();
+        ring.Allocate( 5 * MinSize );
+        CHECK( ( events == std::vector<Event> { Event { EventType::Destroy, 2 }, Event { EventType::Create, 5 * MinSize } } ) );
+
+        //a smaller use keeps the buffer
+        events.clear();
+        ring.Allocate( MinSize );
+        CHECK( events.empty() );
+        CHECK_EQUAL( host.GetLiveBufferCount(), size_t { 1 } );
+    }
+
+    void TestShrink()
+    {
+        std::vector<Event> events {};
+        InstanceBufferRing ring {};
+        auto               backend { std::make_unique<LoggingBackend>( events ) };
+        LoggingBackend&    host { *backend };
+        ring.SetBackend( std::move( backend ) );
+
+        const auto runFrame = [&]( size_t size ) {
+            ring.Allocate( size );
+            ring.EndFrame();
+            host.Complete( UINT64_MAX );
+        };
+
+        //the first window saw the large use, nothing shrinks
+        const size_t largeSize { 16 * MinSize };
+        for ( uint32_t frame { 0 }; frame < InstanceBufferRing::ShrinkWindowFrames; ++frame )
+        {
+            runFrame( frame < InstanceBufferRing::FramesInFlight ? largeSize : MinSize );
+        }
+        CHECK_EQUAL( CountEvents( events, EventType::Destroy ), size_t { 0 } );
+
+        //the second window only sees small uses, the buffers shrink once it is over
+        for ( uint32_t frame { 0 }; frame < InstanceBufferRing::ShrinkWindowFrames; ++frame )
+        {
+            runFrame( MinSize );
+        }
+        CHECK_EQUAL( CountEvents( events, EventType::Destroy ), size_t { 0 } );
+
+        events.clear();
+        for ( uint32_t frame { 0 }; frame < InstanceBufferRing::FramesInFlight; ++frame )
+        {
+            runFrame( MinSize );
+        }
+        CHECK_EQUAL( CountEvents( events, EventType::Destroy ), size_t { InstanceBufferRing::FramesInFlight } );
+        CHECK_EQUAL( CountEvents( events, EventType::Create ), size_t { InstanceBufferRing::FramesInFlight } );
+        for ( const Event& event: events )
+        {
+            if ( event.Type == EventType::Create )
+            {
+                CHECK_EQUAL( event.Value, 2 * MinSize );
+            }
+        }
+
+        //a buffer at most four times the largest use is kept
+        events.clear();
+        for ( uint32_t frame { 0 }; frame < 2 * InstanceBufferRing::ShrinkWindowFrames; ++frame )
+        {
+            runFrame( MinSize );
+        }
+        CHECK( events.empty() );
+        CHECK_EQUAL( host.GetLiveBufferCount(), size_t { InstanceBufferRing::FramesInFlight } );
+    }
+
+    void TestRelease()
+    {
+        std::vector<Event> events {};
+        {
+            InstanceBufferRing ring {};
+            ring.SetBackend( std::make_unique<LoggingBackend>( events ) );
+            for ( uint32_t frame { 0 }; frame < InstanceBufferRing::FramesInFlight; ++frame )
+            {
+                ring.Allocate( 100 );
+                ring.EndFrame();
+            }
+
+            //every buffer is destroyed after the fence of its last frame, in slot order
+            events.clear();
+            ring.SetBackend( nullptr );
+            CHECK( !ring.HasBackend() );
+            CHECK( ( events == std::vector<Event> { Event { EventType::Wait, 1 }, Event { EventType::Destroy, 1 },
+                                                    Event { EventType::Wait, 2 }, Event { EventType::Destroy, 2 },
+                                                    Event { EventType::Wait, 3 }, Event { EventType::Destroy, 3 } } ) );
+        }
+
+        //the destructor releases the same way, a slot never allocated has nothing to wait for
+        events.clear();
+        {
+            InstanceBufferRing ring {};
+            ring.SetBackend( std::make_unique<LoggingBackend>( events ) );
+            ring.Allocate( 100 );
+            ring.EndFrame();
+        }
+        CHECK( ( events == std::vector<Event> { Event { EventType::Create, MinSize }, Event { EventType::Wait, 1 },
+                                                Event { EventType::Destroy, 1 } } ) );
+    }
+}
+
+int main()
+{
+    TestFenceWaits();
+    TestGrowth();
+    TestShrink();
+    TestRelease();
+    return GetFailedCheckCount();
+}
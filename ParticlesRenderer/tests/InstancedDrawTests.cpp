@@ -0,0 +1,91 @@
+#include <InstancedDraw.h>
+
+#include <TestCheck.h>
+
+namespace
+{
+    using CommandType = RecordingInstancedDrawBackend::CommandType;
+
+    // Every draw sets its offset first, the offsets follow each other and the draws are never larger than the maximum.
+    void CheckDraws( const RecordingInstancedDrawBackend& backend, size_t maxInstancesPerDraw )
+    {
+        const auto& commands { backend.GetCommands() };
+        CHECK_EQUAL( commands.size() % 2, size_t { 0 } );
+
+        uint32_t expectedOffset { 0 };
+        for ( size_t i { 0 }; i + 1 < commands.size(); i += 2 )
+        {
+            CHECK( commands[i].Type == CommandType::SetInstanceOffset );
+            CHECK( commands[i + 1].Type == CommandType::DrawInstanced );
+            CHECK_EQUAL( commands[i].Value, expectedOffset );
+            CHECK( commands[i + 1].Value >= 1 && commands[i + 1].Value <= maxInstancesPerDraw );
+            expectedOffset += commands[i + 1].Value;
+        }
+    }
+
+    void TestNoInstances()
+    {
+        RecordingInstancedDrawBackend backend {};
+        CHECK_EQUAL( SubmitInstancedDraws( backend, 0, 1024 ), size_t { 0 } );
+        CHECK( backend.GetCommands().empty() );
+        CHECK_EQUAL( backend.GetInstanceCount(), size_t { 0 } );
+    }
+
+    void TestOneFullDraw()
+    {
+        RecordingInstancedDrawBackend backend {};
+        CHECK_EQUAL( SubmitInstancedDraws( backend, 1024, 1024 ), size_t { 1 } );
+        CHECK_EQUAL( backend.GetCount( CommandType::SetInstanceOffset ), size_t { 1 } );
+        CHECK_EQUAL( backend.GetCount( CommandType::DrawInstanced ), size_t { 1 } );
+        CHECK_EQUAL( backend.GetInstanceCount(), size_t { 1024 } );
+        CheckDraws( backend, 1024 );
+    }
+
+    void TestRemainder()
+    {
+        RecordingInstancedDrawBackend backend {};
+        CHECK_EQUAL( SubmitInstancedDraws( backend, 2500, 1024 ), size_t { 3 } );
+        CHECK_EQUAL( backend.GetCount( CommandType::DrawInstanced ), size_t { 3 } );
+        CHECK_EQUAL( backend.GetInstanceCount(), size_t { 2500 } );
+        CheckDraws( backend, 1024 );
+
+        const auto& commands { backend.GetCommands() };
+        CHECK_EQUAL( commands.size(), size_t { 6 } );
+        if ( commands.size() == 6 )
+        {
+            CHECK_EQUAL( commands[4].Value, 2048u );
+            CHECK_EQUAL( commands[5].Value, 452u );
+        }
+
+        //the backend keeps its commands until cleared
+        SubmitInstancedDraws( backend, 1, 1024 );
+        CHECK_EQUAL( backend.GetInstanceCount(), size_t { 2501 } );
+        backend.Clear();
+        CHECK_EQUAL( backend.GetInstanceCount(), size_t { 0 } );
+    }
+
+    void TestSeveralSizes()
+    {
+        for ( const size_t maxInstancesPerDraw: { size_t { 1 }, size_t { 7 }, size_t { 64 } } )
+        {
+            for ( size_t instanceCount { 0 }; instanceCount < 200; ++instanceCount )
+            {
+                RecordingInstancedDrawBackend backend {};
+                const size_t drawCount { SubmitInstancedDraws( backend, instanceCount, maxInstancesPerDraw ) };
+                CHECK_EQUAL( drawCount, ( instanceCount + maxInstancesPerDraw - 1 ) / maxInstancesPerDraw );
+                CHECK_EQUAL( backend.GetCount( CommandType::DrawInstanced ), drawCount );
+                CHECK_EQUAL( backend.GetInstanceCount(), instanceCount );
+                CheckDraws( backend, maxInstancesPerDraw );
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestNoInstances();
+    TestOneFullDraw();
+    TestRemainder();
+    TestSeveralSizes();
+    return GetFailedCheckCount();
+}
@@ -0,0 +1,153 @@
+#include <MeshDispatchPlanner.h>
+
+#include <TestCheck.h>
+
+#include <vector>
+
+namespace
+{
+    // Runs the groups of every dispatch like the mesh shaders and counts how many times every item is drawn.
+    // Also checks the limits of every dispatch.
+    std::vector<uint32_t> DrawItems( const std::vector<MeshDispatch>& dispatches, uint64_t itemCount, uint32_t itemsPerGroup,
+                                     uint32_t maxGroupsPerDimension, uint32_t maxGroupsPerDispatch )
+    {
+        std::vector<uint32_t> drawCounts( itemCount );
+        for ( const MeshDispatch& dispatch: dispatches )
+        {
+            CHECK( dispatch.X >= 1 && dispatch.X <= maxGroupsPerDimension );
+            CHECK( dispatch.Y >= 1 && dispatch.Y <= maxGroupsPerDimension );
+            CHECK( dispatch.Z >= 1 && dispatch.Z <= maxGroupsPerDimension );
+            CHECK( uint64_t { dispatch.X } * dispatch.Y * dispatch.Z <= maxGroupsPerDispatch );
+            CHECK_EQUAL( dispatch.Constants.GroupsX, dispatch.X );
+            CHECK_EQUAL( dispatch.Constants.GroupsY, dispatch.Y );
+            CHECK( dispatch.Constants.ItemEnd <= itemCount );
+
+            for ( uint32_t z { 0 }; z < dispatch.Z; ++z )
+            {
+                for ( uint32_t y { 0 }; y < dispatch.Y; ++y )
+                {
+                    for ( uint32_t x { 0 }; x < dispatch.X; ++x )
+                    {
+                        const uint64_t group { dispatch.Constants.GroupOffset +
+                                               ( uint64_t { z } * dispatch.Constants.GroupsY + y ) * dispatch.Constants.GroupsX + x };
+                        const uint64_t end { std::min( ( group + 1 ) * itemsPerGroup, uint64_t { dispatch.Constants.ItemEnd } ) };
+                        for ( uint64_t item { group * itemsPerGroup }; item < end; ++item )
+                        {
+                            ++drawCounts[item];
+                        }
+                    }
+                }
+            }
+        }
+        return drawCounts;
+    }
+
+    // Every item is drawn exactly once.
+    void CheckCoverage( uint64_t itemCount, uint32_t itemsPerGroup, uint32_t maxGroupsPerDimension = MaxMeshGroupsPerDimension,
+                        uint32_t maxGroupsPerDispatch = MaxMeshGroupsPerDispatch )
+    {
+        const std::vector<MeshDispatch> dispatches { PlanMeshDispatches( itemCount, itemsPerGroup, maxGroupsPerDimension,
+                                                                         maxGroupsPerDispatch ) };
+        const std::vector<uint32_t>     drawCounts { DrawItems( dispatches, itemCount, itemsPerGroup, maxGroupsPerDimension,
+                                                                maxGroupsPerDispatch ) };
+
+        uint64_t wrongItems { 0 };
+        for ( const uint32_t drawCount: drawCounts )
+        {
+            wrongItems += drawCount != 1 ? 1 : 0;
+        }
+        if ( wrongItems != 0 )
+        {
+            std::printf( "%llu items of %llu not drawn once, %u per group\n", static_cast<unsigned long long>( wrongItems ),
+                         static_cast<unsigned long long>( itemCount ), itemsPerGroup );
+        }
+        CHECK_EQUAL( wrongItems, 0u );
+    }
+
+    void TestNoItems()
+    {
+        CHECK( PlanMeshDispatches( 0, 64 ).empty() );
+    }
+
+    void TestOneItem()
+    {
+        const std::vector<MeshDispatch> dispatches { PlanMeshDispatches( 1, 64 ) };
+        CHECK_EQUAL( dispatches.size(), 1u );
+        CHECK_EQUAL( dispatches[0].X, 1u );
+        CHECK_EQUAL( dispatches[0].Y, 1u );
+        CHECK_EQUAL( dispatches[0].Z, 1u );
+        CHECK_EQUAL( dispatches[0].Constants.GroupOffset, 0u );
+        CHECK_EQUAL( dispatches[0].Constants.ItemEnd, 1u );
+        CheckCoverage( 1, 64 );
+    }
+
+    void TestMultiplesAndRemainders()
+    {
+        // Exact multiple: every group is full
+        const std::vector<MeshDispatch> exact { PlanMeshDispatches( 64 * 100, 64 ) };
+        CHECK_EQUAL( exact.size(), 1u );
+        CHECK_EQUAL( uint64_t { exact[0].X } * exact[0].Y * exact[0].Z, 100u );
+        CHECK_EQUAL( exact[0].Constants.ItemEnd, 6400u );
+
+        // Remainder: one more group, cut by ItemEnd
+        const std::vector<MeshDispatch> remainder { PlanMeshDispatches( 64 * 100 + 5, 64 ) };
+        CHECK_EQUAL( remainder.size(), 1u );
+        CHECK_EQUAL( uint64_t { remainder[0].X } * remainder[0].Y * remainder[0].Z, 101u );
+        CHECK_EQUAL( remainder[0].Constants.ItemEnd, 6405u );
+
+        for ( const uint64_t itemCount: { 63u, 64u, 65u, 127u, 128u, 6400u, 6405u } )
+        {
+            CheckCoverage( itemCount, 64 );
+            CheckCoverage( itemCount, 1 );
+            CheckCoverage( itemCount, 3 );
+        }
+    }
+
+    void TestDimensionLimit()
+    {
+        // One group past the X limit goes to Y, the tile can hold a few more groups than needed
+        const std::vector<MeshDispatch> dispatches { PlanMeshDispatches( uint64_t { MaxMeshGroupsPerDimension } + 1, 1 ) };
+        CHECK_EQUAL( dispatches.size(), 1u );
+        CHECK_EQUAL( dispatches[0].Y, 2u );
+        CHECK( dispatches[0].X <= MaxMeshGroupsPerDimension );
+        CheckCoverage( uint64_t { MaxMeshGroupsPerDimension } + 1, 1 );
+        CheckCoverage( uint64_t { MaxMeshGroupsPerDimension } * 3 + 7, 2 );
+
+        // Small limits reach Z and several dispatches with few items
+        CheckCoverage( 1000, 1, 7, 1u << 22 );
+        CheckCoverage( 1000, 3, 4, 50 );
+        CheckCoverage( 12345, 5, 16, 1000 );
+    }
+
+    void TestDispatchLimit()
+    {
+        // Twice the groups of a dispatch and a remainder: three dispatches. 2^22 groups do not tile exactly in
+        // 65535 wide rows, so a dispatch takes a few groups less than the limit and the next one starts there.
+        const uint64_t                  itemCount { uint64_t { MaxMeshGroupsPerDispatch } * 2 + 3 };
+        const std::vector<MeshDispatch> dispatches { PlanMeshDispatches( itemCount, 1 ) };
+        CHECK_EQUAL( dispatches.size(), 3u );
+        CHECK_EQUAL( dispatches[0].Constants.GroupOffset, 0u );
+        for ( size_t i { 0 }; i < dispatches.size(); ++i )
+        {
+            // One item per group: ItemEnd is the end of the groups of the dispatch
+            const MeshDispatchConstants& constants { dispatches[i].Constants };
+            CHECK( constants.ItemEnd - constants.GroupOffset <= MaxMeshGroupsPerDispatch );
+            if ( i + 1 < dispatches.size() )
+            {
+                CHECK_EQUAL( dispatches[i + 1].Constants.GroupOffset, constants.ItemEnd );
+            }
+        }
+        CHECK_EQUAL( dispatches.back().Constants.ItemEnd, itemCount );
+        CheckCoverage( itemCount, 1 );
+    }
+}
+
+int main()
+{
+    TestNoItems();
+    TestOneItem();
+    TestMultiplesAndRemainders();
+    TestDimensionLimit();
+    TestDispatchLimit();
+    return GetFailedCheckCount();
+}
@@ -0,0 +1,189 @@
+#include <dx12lib/StateFilter.h>
+
+#include <TestCheck.h>
+
+#include <array>
+#include <cstdint>
+
+using namespace dx12lib;
+
+namespace
+{
+    // Same layout as a vertex buffer view, the filter only sees its bytes.
+    struct BufferView
+    {
+        uint64_t Location;
+        uint32_t Size;
+        uint32_t Stride;
+    };
+
+    void TestRepeatedSet()
+    {
+        StateFilter filter {};
+        const uint64_t pipeline { 0x1000 };
+        const uint64_t otherPipeline { 0x2000 };
+
+        CHECK( filter.Set( CommandType::SetPipelineState, 0, pipeline ) );
+        CHECK( !filter.Set( CommandType::SetPipelineState, 0, pipeline ) );
+        CHECK( !filter.Set( CommandType::SetPipelineState, 0, pipeline ) );
+        CHECK( filter.Set( CommandType::SetPipelineState, 0, otherPipeline ) );
+        CHECK( filter.Set( CommandType::SetPipelineState, 0, pipeline ) );
+
+        //other slots and elements are other bindings
+        const uint32_t constant { 7 };
+        CHECK( filter.Set( CommandType::SetGraphics32BitConstants, 1, constant ) );
+        CHECK( filter.Set( CommandType::SetGraphics32BitConstants, 2, constant ) );
+        CHECK( filter.Set( CommandType::SetShaderResourceView, 3, 0, &constant, sizeof( constant ) ) );
+        CHECK( filter.Set( CommandType::SetShaderResourceView, 3, 1, &constant, sizeof( constant ) ) );
+        CHECK( !filter.Set( CommandType::SetShaderResourceView, 3, 1, &constant, sizeof( constant ) ) );
+
+        //the same bytes with another size are another state
+        const uint64_t wideConstant { 7 };
+        CHECK( filter.Set( CommandType::SetGraphics32BitConstants, 1, wideConstant ) );
+
+        //larger data is never filtered
+        const std::array<uint8_t, StateFilter::MaxFilteredSize + 1> buffer {};
+        CHECK( filter.Set( CommandType::SetGraphicsDynamicConstantBuffer, 4, buffer ) );
+        CHECK( filter.Set( CommandType::SetGraphicsDynamicConstantBuffer, 4, buffer ) );
+    }
+
+    void TestSetRange()
+    {
+        StateFilter filter {};
+        std::array<BufferView, 3> views { BufferView { 0x100, 64, 16 }, BufferView { 0x200, 64, 16 },
+                                          BufferView { 0x300, 64, 16 } };
+
+        CHECK( filter.SetRange( CommandType::SetVertexBuffers, 0, views.data(), sizeof( BufferView ), views.size() ) );
+        CHECK( !filter.SetRange( CommandType::SetVertexBuffers, 0, views.data(), sizeof( BufferView ), views.size() ) );
+
+        //one changed slot sets the range, the slots are still bound one by one
+        views[2].Location = 0x400;
+        CHECK( filter.SetRange( CommandType::SetVertexBuffers, 0, views.data(), sizeof( BufferView ), views.size() ) );
+        CHECK( !filter.SetRange( CommandType::SetVertexBuffers, 0, views.data(), sizeof( BufferView ), views.size() ) );
+        CHECK( !filter.SetRange( CommandType::SetVertexBuffers, 1, &views[1], sizeof( BufferView ), 2 ) );
+        CHECK( !filter.Set( CommandType::SetVertexBuffers, 2, views[2] ) );
+
+        //a range overlapping the bound slots is set when it goes past them
+        const std::array<BufferView, 2> shifted { views[2], BufferView { 0x500, 64, 16 } };
+        CHECK( filter.SetRange( CommandType::SetVertexBuffers, 2, shifted.data(), sizeof( BufferView ), shifted.size() ) );
+
+        //an empty range binds nothing and is never filtered
+        CHECK( filter.SetRange( CommandType::SetVertexBuffers, 0, views.data(), sizeof( BufferView ), 0 ) );
+    }
+
+    void TestRootSignatureChange()
+    {
+        StateFilter filter {};
+        const uint64_t rootSignature { 0x1000 };
+        const uint64_t bufferLocation { 0x2000 };
+        const uint32_t constant { 3 };
+        const BufferView vertexBuffer { 0x3000, 64, 16 };
+
+        CHECK( filter.Set( CommandType::SetGraphicsRootSignature, 0, rootSignature ) );
+        CHECK( filter.Set( CommandType::SetConstantBufferView, 0, bufferLocation ) );
+        CHECK( filter.Set( CommandType::SetGraphics32BitConstants, 1, constant ) );
+        CHECK( filter.Set( CommandType::SetVertexBuffers, 0, vertexBuffer ) );
+        CHECK( !filter.Set( CommandType::SetConstantBufferView, 0, bufferLocation ) );
+
+        //the command list forgets the root parameters when the root signature changes, not the other state
+        filter.InvalidateRootParameters();
+        CHECK( !filter.Set( CommandType::SetGraphicsRootSignature, 0, rootSignature ) );
+        CHECK( filter.Set( CommandType::SetConstantBufferView, 0, bufferLocation ) );
+        CHECK( filter.Set( CommandType::SetGraphics32BitConstants, 1, constant ) );
+        CHECK( !filter.Set( CommandType::SetVertexBuffers, 0, vertexBuffer ) );
+
+        //all root parameter commands share the slots, another command on a slot replaces its state
+        CHECK( filter.Set( CommandType::SetShaderResourceView, 0, bufferLocation ) );
+        CHECK( filter.Set( CommandType::SetConstantBufferView, 0, bufferLocation ) );
+    }
+
+    void TestGraphicsAndCompute()
+    {
+        StateFilter filter {};
+        const uint64_t rootSignature { 0x1000 };
+        const uint32_t constant { 5 };
+
+        //the same bytes bound by the graphics and compute commands are not the same state
+        CHECK( filter.Set( CommandType::SetGraphicsRootSignature, 0, rootSignature ) );
+        CHECK( filter.Set( CommandType::SetComputeRootSignature, 0, rootSignature ) );
+        CHECK( filter.Set( CommandType::SetGraphicsRootSignature, 0, rootSignature ) );
+        CHECK( !filter.Set( CommandType::SetGraphicsRootSignature, 0, rootSignature ) );
+
+        CHECK( filter.Set( CommandType::SetGraphics32BitConstants, 2, constant ) );
+        CHECK( filter.Set( CommandType::SetCompute32BitConstants, 2, constant ) );
+        CHECK( !filter.Set( CommandType::SetCompute32BitConstants, 2, constant ) );
+        CHECK( filter.Set( CommandType::SetGraphics32BitConstants, 2, constant ) );
+    }
+
+    void TestInvalidate()
+    {
+        StateFilter filter {};
+        const BufferView vertexBuffer { 0x1000, 64, 16 };
+        const BufferView indexBuffer { 0x2000, 12, 0 };
+
+        CHECK( filter.Set( CommandType::SetVertexBuffers, 0, vertexBuffer ) );
+        CHECK( filter.Set( CommandType::SetVertexBuffers, 1, vertexBuffer ) );
+        CHECK( filter.Set( CommandType::SetIndexBuffer, 0, indexBuffer ) );
+
+        //a dynamic vertex and index buffer is bound without the filter, the next set of the buffers goes through
+        filter.Invalidate( CommandType::SetVertexBuffers, 0 );
+        filter.Invalidate( CommandType::SetIndexBuffer, 0 );
+        CHECK( filter.Set( CommandType::SetVertexBuffers, 0, vertexBuffer ) );
+        CHECK( !filter.Set( CommandType::SetVertexBuffers, 1, vertexBuffer ) );
+        CHECK( filter.Set( CommandType::SetIndexBuffer, 0, indexBuffer ) );
+        CHECK( !filter.Set( CommandType::SetIndexBuffer, 0, indexBuffer ) );
+
+        //an element of a descriptor table
+        const uint64_t descriptor { 0x3000 };
+        CHECK( filter.Set( CommandType::SetUnorderedAccessView, 1, 4, &descriptor, sizeof( descriptor ) ) );
+        CHECK( filter.Set( CommandType::SetUnorderedAccessView, 1, 5, &descriptor, sizeof( descriptor ) ) );
+        filter.Invalidate( CommandType::SetUnorderedAccessView, 1, 4 );
+        CHECK( filter.Set( CommandType::SetUnorderedAccessView, 1, 4, &descriptor, sizeof( descriptor ) ) );
+        CHECK( !filter.Set( CommandType::SetUnorderedAccessView, 1, 5, &descriptor, sizeof( descriptor ) ) );
+    }
+
+    void TestCounters()
+    {
+        StateFilter filter {};
+        const uint64_t pipeline { 0x1000 };
+        const std::array<BufferView, 2> views { BufferView { 0x100, 64, 16 }, BufferView { 0x200, 64, 16 } };
+
+        filter.Set( CommandType::SetPipelineState, 0, pipeline );
+        filter.Set( CommandType::SetPipelineState, 0, pipeline );
+        filter.Set( CommandType::SetPipelineState, 0, pipeline );
+        filter.SetRange( CommandType::SetVertexBuffers, 0, views.data(), sizeof( BufferView ), views.size() );
+        filter.SetRange( CommandType::SetVertexBuffers, 0, views.data(), sizeof( BufferView ), views.size() );
+
+        CHECK_EQUAL( filter.GetCounters( CommandType::SetPipelineState ).Calls, 3u );
+        CHECK_EQUAL( filter.GetCounters( CommandType::SetPipelineState ).Filtered, 2u );
+        //a range is one call
+        CHECK_EQUAL( filter.GetCounters( CommandType::SetVertexBuffers ).Calls, 2u );
+        CHECK_EQUAL( filter.GetCounters( CommandType::SetVertexBuffers ).Filtered, 1u );
+        CHECK_EQUAL( filter.GetCounters( CommandType::SetIndexBuffer ).Calls, 0u );
+        CHECK_EQUAL( filter.GetCallCount(), 5u );
+        CHECK_EQUAL( filter.GetFilteredCount(), 3u );
+
+        //invalidating keeps the counters, a reset clears them and the bound state
+        filter.InvalidateRootParameters();
+        filter.Invalidate( CommandType::SetPipelineState, 0 );
+        CHECK_EQUAL( filter.GetCallCount(), 5u );
+
+        filter.Reset();
+        CHECK_EQUAL( filter.GetCallCount(), 0u );
+        CHECK_EQUAL( filter.GetFilteredCount(), 0u );
+        CHECK( filter.Set( CommandType::SetPipelineState, 0, pipeline ) );
+        CHECK( filter.SetRange( CommandType::SetVertexBuffers, 0, views.data(), sizeof( BufferView ), views.size() ) );
+        CHECK_EQUAL( filter.GetFilteredCount(), 0u );
+    }
+}
+
+int main()
+{
+    TestRepeatedSet();
+    TestSetRange();
+    TestRootSignatureChange();
+    TestGraphicsAndCompute();
+    TestInvalidate();
+    TestCounters();
+    return GetFailedCheckCount();
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdio>
+
+// Minimal checks of the CPU side tests. A failed check prints its expression and its line, the test keeps running
+// and returns the amount of failed checks from main, so ctest reports it.
+inline int& GetFailedCheckCount()
+{
+    static int count { 0 };
+    return count;
+}
+
+#define CHECK( condition )                                                                   \
+    do                                                                                       \
+    {                                                                                        \
+        if ( !( condition ) )                                                                \
+        {                                                                                    \
+            std::printf( "%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition );     \
+            ++GetFailedCheckCount();                                                         \
+        }                                                                                    \
+    } while ( false )
+
+#define CHECK_EQUAL( actual, expected )                                                      \
+    do                                                                                       \
+    {                                                                                        \
+        const auto actualValue { actual };                                                   \
+        const auto expectedValue { expected };                                               \
+        if ( !( actualValue == expectedValue ) )                                             \
+        {                                                                                    \
+            std::printf( "%s(%d): check failed: %s == %s (%g, expected %g)\n", __FILE__, __LINE__, #actual, \
+                         #expected, static_cast<double>( actualValue ), static_cast<double>( expectedValue ) ); \
+            ++GetFailedCheckCount();                                                         \
+        }                                                                                    \
+    } while ( false )
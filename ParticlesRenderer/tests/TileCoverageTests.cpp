@@ -0,0 +1,134 @@
+#include <TileCoverage.h>
+
+#include <TestCheck.h>
+
+#include <vector>
+
+namespace
+{
+    // 4 x 2 tiles of 32 pixels.
+    constexpr float Width { 128.0f };
+    constexpr float Height { 64.0f };
+
+    void EstimateQuads( TileCoverage& coverage, const std::vector<TileCoverage::Quad>& quads )
+    {
+        coverage.EstimateQuads( quads.size(), [&]( size_t i, TileCoverage::Quad& quad ) {
+            quad = quads[i];
+            return true;
+        } );
+    }
+
+    float GetTileOverdraw( const TileCoverage& coverage, uint32_t tileX, uint32_t tileY )
+    {
+        return coverage.GetTileOverdraw()[tileY * coverage.GetTileCountX() + tileX];
+    }
+
+    void TestNoQuads()
+    {
+        TileCoverage coverage {};
+        coverage.SetViewportSize( Width, Height );
+        EstimateQuads( coverage, {} );
+
+        CHECK_EQUAL( coverage.GetTileCountX(), 4u );
+        CHECK_EQUAL( coverage.GetTileCountY(), 2u );
+        CHECK_EQUAL( coverage.GetTileOverdraw().size(), size_t { 8 } );
+        CHECK_EQUAL( coverage.GetCoveredPixels(), 0.0 );
+        CHECK_EQUAL( coverage.GetMaxTileOverdraw(), 0.0f );
+    }
+
+    void TestQuadOnOneTile()
+    {
+        TileCoverage coverage {};
+        coverage.SetViewportSize( Width, Height );
+        EstimateQuads( coverage, { TileCoverage::Quad { 32.0f, 32.0f, 64.0f, 64.0f } } );
+
+        for ( uint32_t tileY { 0 }; tileY < 2; ++tileY )
+        {
+            for ( uint32_t tileX { 0 }; tileX < 4; ++tileX )
+            {
+                CHECK_EQUAL( GetTileOverdraw( coverage, tileX, tileY ), tileX == 1 && tileY == 1 ? 1.0f : 0.0f );
+            }
+        }
+        CHECK_EQUAL( coverage.GetCoveredPixels(), 1024.0 );
+        CHECK_EQUAL( coverage.GetAverageOverdraw(), 1024.0 / ( 128.0 * 64.0 ) );
+        CHECK_EQUAL( coverage.GetMaxTileOverdraw(), 1.0f );
+    }
+
+    void TestQuadOnFourTiles()
+    {
+        TileCoverage coverage {};
+        coverage.SetViewportSize( Width, Height );
+
+        //a tile of area centered on the corner of four tiles, a quarter of it on each
+        EstimateQuads( coverage, { TileCoverage::Quad { 48.0f, 16.0f, 80.0f, 48.0f } } );
+
+        for ( uint32_t tileY { 0 }; tileY < 2; ++tileY )
+        {
+            for ( uint32_t tileX { 0 }; tileX < 4; ++tileX )
+            {
+                CHECK_EQUAL( GetTileOverdraw( coverage, tileX, tileY ), tileX == 1 || tileX == 2 ? 0.25f : 0.0f );
+            }
+        }
+        CHECK_EQUAL( coverage.GetCoveredPixels(), 1024.0 );
+        CHECK_EQUAL( coverage.GetMaxTileOverdraw(), 0.25f );
+    }
+
+    void TestCoincidentQuads()
+    {
+        TileCoverage coverage {};
+        coverage.SetViewportSize( Width, Height );
+
+        //enough quads for several chunks, the chunk histograms add up
+        for ( const size_t quadCount: { size_t { 1 }, size_t { 7 }, size_t { 10000 } } )
+        {
+            const std::vector<TileCoverage::Quad> quads( quadCount, TileCoverage::Quad { 96.0f, 0.0f, 128.0f, 32.0f } );
+            EstimateQuads( coverage, quads );
+
+            const float overdraw { static_cast<float>( quadCount ) };
+            CHECK_EQUAL( GetTileOverdraw( coverage, 3, 0 ), overdraw );
+            CHECK_EQUAL( GetTileOverdraw( coverage, 2, 0 ), 0.0f );
+            CHECK_EQUAL( GetTileOverdraw( coverage, 3, 1 ), 0.0f );
+            CHECK_EQUAL( coverage.GetMaxTileOverdraw(), overdraw );
+            CHECK_EQUAL( coverage.GetCoveredPixels(), 1024.0 * quadCount );
+        }
+    }
+
+    void TestScreenEdges()
+    {
+        //the last column and row of tiles are cut by the screen to 4 x 8 pixels
+        TileCoverage coverage {};
+        coverage.SetViewportSize( 100.0f, 40.0f );
+        CHECK_EQUAL( coverage.GetTileCountX(), 4u );
+        CHECK_EQUAL( coverage.GetTileCountY(), 2u );
+
+        //the quad is clipped by the screen, the cut tile is fully covered
+        EstimateQuads( coverage, { TileCoverage::Quad { 96.0f, 32.0f, 140.0f, 80.0f }, TileCoverage::Quad { -20.0f, -20.0f, -1.0f, 10.0f } } );
+        CHECK_EQUAL( GetTileOverdraw( coverage, 3, 1 ), 1.0f );
+        CHECK_EQUAL( coverage.GetCoveredPixels(), 32.0 );
+        CHECK_EQUAL( coverage.GetMaxTileOverdraw(), 1.0f );
+    }
+
+    void TestSkippedQuads()
+    {
+        TileCoverage coverage {};
+        coverage.SetViewportSize( Width, Height );
+        coverage.EstimateQuads( 10, []( size_t i, TileCoverage::Quad& quad ) {
+            quad = TileCoverage::Quad { 0.0f, 0.0f, 32.0f, 32.0f };
+            return i % 2 == 0;
+        } );
+
+        CHECK_EQUAL( GetTileOverdraw( coverage, 0, 0 ), 5.0f );
+        CHECK_EQUAL( coverage.GetCoveredPixels(), 5.0 * 1024.0 );
+    }
+}
+
+int main()
+{
+    TestNoQuads();
+    TestQuadOnOneTile();
+    TestQuadOnFourTiles();
+    TestCoincidentQuads();
+    TestScreenEdges();
+    TestSkippedQuads();
+    return GetFailedCheckCount();
+}
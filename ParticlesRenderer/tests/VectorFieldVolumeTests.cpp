@@ -0,0 +1,210 @@
+#include <VectorFieldVolume.h>
+
+#include <TestCheck.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    // Sizes which are not a multiple of the brick size, the last bricks are partial.
+    constexpr uint32_t SizeX { 9 };
+    constexpr uint32_t SizeY { 6 };
+    constexpr uint32_t SizeZ { 5 };
+
+    constexpr XMFLOAT3 BoundsMin { -1.0f, -2.0f, -0.5f };
+    constexpr XMFLOAT3 BoundsMax { 3.0f, 1.0f, 2.0f };
+
+    // The volume is placed like an emitter does, moved and scaled.
+    constexpr XMFLOAT3 Origin { 10.0f, -5.0f, 2.0f };
+    constexpr float    Scale { 2.0f };
+
+    // Non-linear field, so a wrong corner or weight changes the interpolated value.
+    XMFLOAT3 GetVoxel( uint32_t x, uint32_t y, uint32_t z )
+    {
+        const float fx { static_cast<float>( x ) };
+        const float fy { static_cast<float>( y ) };
+        const float fz { static_cast<float>( z ) };
+        return XMFLOAT3 { 0.5f * fx + std::sin( fy ), fy * fz - fx, fx * fx - 2.0f * fz };
+    }
+
+    std::filesystem::path SaveVolume()
+    {
+        std::vector<XMFLOAT3> voxels {};
+        for ( uint32_t z { 0 }; z < SizeZ; ++z )
+        {
+            for ( uint32_t y { 0 }; y < SizeY; ++y )
+            {
+                for ( uint32_t x { 0 }; x < SizeX; ++x )
+                {
+                    voxels.push_back( GetVoxel( x, y, z ) );
+                }
+            }
+        }
+
+        const std::filesystem::path path { std::filesystem::temp_directory_path() / L"VectorFieldVolumeTests.vfb" };
+        CHECK( VectorFieldVolume::Save( path.wstring(), SizeX, SizeY, SizeZ, BoundsMin, BoundsMax, voxels ) );
+        return path;
+    }
+
+    bool IsClose( float a, float b )
+    {
+        return std::abs( a - b ) <= 1e-4f * std::max( 1.0f, std::abs( b ) );
+    }
+
+    bool IsClose( const XMFLOAT3& a, const XMFLOAT3& b )
+    {
+        return IsClose( a.x, b.x ) && IsClose( a.y, b.y ) && IsClose( a.z, b.z );
+    }
+
+    // Positions as separate 16 byte aligned x, y and z arrays, like the particle update gives them to SampleBatch.
+    struct Positions
+    {
+        explicit Positions( size_t count )
+        : Count { count }
+        , X( count / 4 )
+        , Y( count / 4 )
+        , Z( count / 4 )
+        {}
+
+        float* GetX()
+        {
+            return &X.data()->x;
+        }
+        float* GetY()
+        {
+            return &Y.data()->x;
+        }
+        float* GetZ()
+        {
+            return &Z.data()->x;
+        }
+
+        size_t                 Count;
+        std::vector<XMFLOAT4A> X;
+        std::vector<XMFLOAT4A> Y;
+        std::vector<XMFLOAT4A> Z;
+    };
+
+    // Deterministic positions in the placed bounds and a margin around them, the margin is clamped to the border.
+    Positions MakePositions( size_t count )
+    {
+        uint32_t   seed { 12345 };
+        const auto random = [&seed]( float min, float max ) {
+            seed = seed * 1664525u + 1013904223u;
+            return min + ( max - min ) * static_cast<float>( seed >> 8 ) / static_cast<float>( 1u << 24 );
+        };
+
+        Positions positions { count };
+        for ( size_t i { 0 }; i < count; ++i )
+        {
+            positions.GetX()[i] = random( Origin.x + ( BoundsMin.x - 1.0f ) * Scale, Origin.x + ( BoundsMax.x + 1.0f ) * Scale );
+            positions.GetY()[i] = random( Origin.y + ( BoundsMin.y - 1.0f ) * Scale, Origin.y + ( BoundsMax.y + 1.0f ) * Scale );
+            positions.GetZ()[i] = random( Origin.z + ( BoundsMin.z - 1.0f ) * Scale, Origin.z + ( BoundsMax.z + 1.0f ) * Scale );
+        }
+        return positions;
+    }
+
+    void TestVoxels( const VectorFieldVolume& volume )
+    {
+        CHECK( IsClose( volume.GetBoundsMin(), BoundsMin ) );
+        CHECK( IsClose( volume.GetBoundsMax(), BoundsMax ) );
+
+        //a position on a voxel gives the voxel, through the bricks and the placement
+        for ( uint32_t z { 0 }; z < SizeZ; ++z )
+        {
+            for ( uint32_t y { 0 }; y < SizeY; ++y )
+            {
+                for ( uint32_t x { 0 }; x < SizeX; ++x )
+                {
+                    const XMFLOAT3 position {
+                        Origin.x + ( BoundsMin.x + ( BoundsMax.x - BoundsMin.x ) * x / ( SizeX - 1 ) ) * Scale,
+                        Origin.y + ( BoundsMin.y + ( BoundsMax.y - BoundsMin.y ) * y / ( SizeY - 1 ) ) * Scale,
+                        Origin.z + ( BoundsMin.z + ( BoundsMax.z - BoundsMin.z ) * z / ( SizeZ - 1 ) ) * Scale,
+                    };
+                    CHECK( IsClose( volume.Sample( position, Origin, Scale ), GetVoxel( x, y, z ) ) );
+                }
+            }
+        }
+    }
+
+    void TestBatchMatchesScalar( const VectorFieldVolume& volume )
+    {
+        Positions positions { MakePositions( 4096 ) };
+        Positions batch { positions.Count };
+        volume.SampleBatch( positions.GetX(), positions.GetY(), positions.GetZ(), batch.GetX(), batch.GetY(), batch.GetZ(),
+                            positions.Count, Origin, Scale );
+
+        size_t mismatchCount { 0 };
+        for ( size_t i { 0 }; i < positions.Count; ++i )
+        {
+            const XMFLOAT3 position { positions.GetX()[i], positions.GetY()[i], positions.GetZ()[i] };
+            const XMFLOAT3 scalar { volume.Sample( position, Origin, Scale ) };
+            mismatchCount += IsClose( XMFLOAT3 { batch.GetX()[i], batch.GetY()[i], batch.GetZ()[i] }, scalar ) ? 0 : 1;
+        }
+        CHECK_EQUAL( mismatchCount, size_t { 0 } );
+    }
+
+    // Not a check, reports the sampling throughput of both paths headless. The best of a few runs is kept.
+    void ReportThroughput( const VectorFieldVolume& volume )
+    {
+        using Clock = std::chrono::steady_clock;
+
+        constexpr int RunCount { 5 };
+        Positions     positions { MakePositions( size_t { 1 } << 20 ) };
+        Positions     results { positions.Count };
+
+        double scalarSeconds { 1e9 };
+        double batchSeconds { 1e9 };
+        for ( int run { 0 }; run < RunCount; ++run )
+        {
+            const Clock::time_point scalarStart { Clock::now() };
+            for ( size_t i { 0 }; i < positions.Count; ++i )
+            {
+                const XMFLOAT3 sample { volume.Sample( XMFLOAT3 { positions.GetX()[i], positions.GetY()[i], positions.GetZ()[i] }, Origin, Scale ) };
+                results.GetX()[i] = sample.x;
+                results.GetY()[i] = sample.y;
+                results.GetZ()[i] = sample.z;
+            }
+            const Clock::time_point batchStart { Clock::now() };
+            volume.SampleBatch( positions.GetX(), positions.GetY(), positions.GetZ(), results.GetX(), results.GetY(), results.GetZ(),
+                                positions.Count, Origin, Scale );
+            const Clock::time_point batchEnd { Clock::now() };
+
+            scalarSeconds = std::min( scalarSeconds, std::chrono::duration<double>( batchStart - scalarStart ).count() );
+            batchSeconds  = std::min( batchSeconds, std::chrono::duration<double>( batchEnd - batchStart ).count() );
+        }
+
+        const double count { static_cast<double>( positions.Count ) };
+        std::printf( "Sample:      %8.2f M samples/s\n", count / scalarSeconds * 1e-6 );
+        std::printf( "SampleBatch: %8.2f M samples/s (%.2fx)\n", count / batchSeconds * 1e-6, scalarSeconds / batchSeconds );
+    }
+}
+
+int main()
+{
+    const std::filesystem::path path { SaveVolume() };
+    {
+        const std::shared_ptr<VectorFieldVolume> volume { VectorFieldVolume::Load( path.wstring() ) };
+        CHECK( volume != nullptr );
+        if ( volume )
+        {
+            TestVoxels( *volume );
+            TestBatchMatchesScalar( *volume );
+            ReportThroughput( *volume );
+        }
+    }
+
+    //the volume is unmapped, the file can go
+    std::error_code error {};
+    std::filesystem::remove( path, error );
+    return GetFailedCheckCount();
+}